@@ -12,7 +12,17 @@
 
 
 #include <iostream>         // cout, cerr
+#include <algorithm>        // min, max, lower_bound
+#include <chrono>
+#include <cmath>            // ceil, sqrt
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <map>
+#include <memory>           // unique_ptr
+#include <sstream>          // ostringstream
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 #include <GL/glew.h>        // GLEW library
 #include <GLFW/glfw3.h>     // GLFW library
 
@@ -27,6 +37,16 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "meshes.h"
+#include "framedata.h"
+#include "glstate.h"
+#include "indirectbuffer.h"
+#include "instancebuffer.h"
+#include "meshcompute.h"
+#include "meshimport.h"
+#include "meshnormals.h"
+#include "meshstream.h"
+#include "renderqueue.h"
+#include "ringbuffer.h"
 #include "../includes/learnOpengl/camera.h"
 
 using namespace std; // Standard namespace
@@ -36,6 +56,11 @@ using namespace std; // Standard namespace
 #define GLSL(Version, Source) "#version " #Version " core \n" #Source
 #endif
 
+/*Shader code without the version line, compiled after a GLSL() source*/
+#ifndef GLSL_BODY
+#define GLSL_BODY(Source) #Source
+#endif
+
 // Unnamed namespace
 namespace
 {
@@ -71,10 +96,27 @@ namespace
 	// Shader program
 	GLuint gProgramId;
 	GLuint gLampProgramId;
+	GLuint gTessProgramId;	// Main shaders with tessellation stages, for the patch meshes
 
 	//Shape Meshes from Professor Brian
 	Meshes meshes;
 
+	// Meshes drawn by URender, acquired from the mesh registry by UAcquireMeshes();
+	// the patch meshes only with --tessellation
+	const Meshes::GLMesh* gPlaneMesh = nullptr;
+	const Meshes::GLMesh* gBoxMesh = nullptr;
+	const Meshes::GLMesh* gCylinderMesh = nullptr;
+	const Meshes::GLMesh* gSmallCylinderMesh = nullptr;	// Low tessellation cylinder for small props
+	const Meshes::GLMesh* gTaperedCylinderMesh = nullptr;
+	const Meshes::GLMesh* gPyramid4Mesh = nullptr;
+	const Meshes::GLMesh* gTorusMesh = nullptr;
+	const Meshes::GLMesh* gCylinderPatchMesh = nullptr;
+	const Meshes::GLMesh* gTaperedCylinderPatchMesh = nullptr;
+	const Meshes::GLMesh* gTorusPatchMesh = nullptr;
+
+	// Slices of gSmallCylinderMesh
+	const float SMALL_CYLINDER_SLICES = 12.0f;
+
 	// camera
 	Camera gCamera(glm::vec3(0.0f, 0.0f, 3.0f));
 
@@ -89,12 +131,222 @@ namespace
 	// Cube and light color
 	glm::vec3 gLightColor(0.7f, 1.0f, 0.0f);
 
+	// Material of one part of a mesh drawn with UDrawMeshMaterials
+	struct PartMaterial
+	{
+		bool hasTexture;	// Use the bound uTexture, otherwise color
+		glm::vec4 color;
+	};
+
+	// Size of the per part material arrays in the fragment shader
+	const int MAX_MATERIAL_PARTS = 3;
+
+	// Clusters (meshlets) and triangles submitted and culled this frame
+	struct ClusterStats
+	{
+		GLuint clusters;
+		GLuint clustersCulled;
+		GLuint triangles;
+		GLuint trianglesCulled;
+	};
+	ClusterStats gClusterStats = {};
+	bool gClusterCulling = true;
+
+	// Cull the back faces of closed meshes (Meshes::GLMesh::cullBackFaces); through
+	// gGLState, GL_CULL_FACE only changes between open and closed meshes
+	bool gFaceCulling = true;
+
+	// Draw the curved primitives from coarse patch meshes refined by the
+	// tessellation shaders, with refined edges about TESS_EDGE_PIXELS long and
+	// within TESS_ERROR_PIXELS of the surface on the screen
+	bool gTessellation = false;
+	const float TESS_EDGE_PIXELS = 12.0f;
+	const float TESS_ERROR_PIXELS = 0.5f;
+
+	// Torus generator parameters requested with the number keys (see UKeyCallback),
+	// regenerated on a worker thread while the current torus is drawn
+	Meshes::TorusParams gTorusRequest;
+	const int TORUS_SEGMENT_STEP = 2;
+	const int TORUS_MIN_SEGMENTS = 4;
+	const int TORUS_MAX_SEGMENTS = 256;
+	const float TORUS_RADIUS_STEP = 0.05f;
+	const float TORUS_MIN_RADIUS = 0.05f;
+
+	// Surface the tessellation evaluation shader puts the vertices of a patch on (uSurface)
+	enum PatchSurface
+	{
+		SURFACE_DISK = 0,		// Flat cap around the Y axis with a round rim
+		SURFACE_REVOLVED = 1,	// Sides of a (tapered) cylinder around the Y axis
+		SURFACE_TORUS = 2		// Torus around the Z axis
+	};
+
+	// Surface of each part of the patch meshes
+	const PatchSurface CYLINDER_PATCH_SURFACES[] = { SURFACE_DISK, SURFACE_DISK, SURFACE_REVOLVED };	// MeshGen::CylinderPart order
+	const PatchSurface TORUS_PATCH_SURFACES[] = { SURFACE_TORUS };
+
+	// Draw of the scene, collected by URender and sorted and executed by UDrawQueue
+	struct DrawItem
+	{
+		const Meshes::GLMesh* mesh;
+		glm::mat4 model;
+		GLint texture;					// Texture unit sampled as uTexture, NO_TEXTURE for a flat color
+		glm::vec4 color;				// Flat color without a texture
+		const PartMaterial* materials;	// Per part materials drawn in one call (UDrawMeshMaterials), or null
+		const PatchSurface* surfaces;	// Patch mesh drawn with the tessellation program, or null
+		int part;						// Single part drawn at lod, or ALL_PARTS for the culled LOD picked by USelectLod
+		int lod;
+		GLuint material;				// First entry of its material(s) in gFrameData, set by UDrawQueue
+	};
+
+	const GLint NO_TEXTURE = -1;
+	const int ALL_PARTS = -1;
+
+	// What draws share a material by: their per part materials, else whether
+	// they are textured, else their flat color (see UMaterialKey)
+	struct MaterialKey
+	{
+		const PartMaterial* materials;
+		bool textured;
+		glm::vec4 color;
+
+		bool operator==(const MaterialKey& other) const
+		{
+			return materials == other.materials && textured == other.textured && color == other.color;
+		}
+	};
+
+	struct MaterialKeyHash
+	{
+		size_t operator()(const MaterialKey& key) const
+		{
+			// FNV-1a over the pointer, the flag and the color bits
+			size_t hash = 2166136261u;
+			GLuint bits[4];
+			std::memcpy(bits, &key.color[0], sizeof(bits));
+			for (size_t word : { size_t(key.materials), size_t(key.textured), size_t(bits[0]), size_t(bits[1]), size_t(bits[2]), size_t(bits[3]) })
+			{
+				hash ^= word;
+				hash *= 16777619u;
+			}
+			return hash;
+		}
+	};
+
+	// Draws of the current frame; item n of gRenderQueue is gDrawItems[n]
+	std::vector<DrawItem> gDrawItems;
+	RenderQueue gRenderQueue;
+
+	// Camera, lights, objects and materials the shaders read, written once per
+	// frame into a persistently mapped ring buffer: the objects are the frame's
+	// draws, selected with uObject or, for instanced draws, through the instance
+	// attribute
+	FrameData gFrameData;
+
+	// Draw the draws of the same mesh range with the same texture or per part
+	// materials as one instanced draw, each copy an object in gFrameData named
+	// by gInstances. All instances draw the same LOD, without cluster culling.
+	bool gInstancing = false;
+	InstanceBuffer gInstances;
+
+	// Instances of an instanced draw in gInstances
+	struct InstanceRange
+	{
+		GLuint first;
+		GLuint count;
+	};
+
+	// With gInstancing, submit the instanced draws as commands of gDrawCommands:
+	// the groups sharing their GL state go out in one glMultiDrawElementsIndirect,
+	// each reaching its instances through its base instance
+	bool gIndirectDraws = false;
+	IndirectBuffer gDrawCommands;
+
+	// Draw executed by UDrawQueue: a single draw, or with gInstancing the first
+	// draw of a group standing for all its instances, and with gIndirectDraws
+	// the first of the groups drawn by its commands
+	struct DrawBatch
+	{
+		const DrawItem* item;
+		int lod;					// LOD of the instances
+		GLuint object;				// Object of a single draw in gFrameData
+		InstanceRange instances;	// Empty for a single draw
+		GLuint firstCommand;
+		GLuint nCommands;			// 0 unless drawn from gDrawCommands
+	};
+
+	// Draws made by UDrawQueue this frame, an instanced draw counting once
+	GLuint gDraws = 0;
+
+	// GL state set by the render loop, skipping the calls that change nothing
+	GLState gGLState;
+
+	// Far plane of both projections, the depth range of the sort keys
+	const float FAR_PLANE = 100.0f;
+
+	// Seconds between updates of the statistics in the window title
+	const double STATS_INTERVAL = 0.5;
+	double gLastStatsTime = 0.0;
+
 	// Light position and scale
 	glm::vec3 gLightPosition(0.0f, 4.5f, 4.0f);
 	glm::vec3 gLightScale(1.0f);
 
 	// variable to handle ortho change
 	bool perspective = false;
+
+	// LOD selection: largest tolerated projected error in pixels, and the
+	// nearest depth used so objects around the camera keep full detail
+	const float LOD_PIXEL_ERROR = 1.0f;
+	const float LOD_MIN_DEPTH = 0.1f;
+
+	// Size of the mesh timed by --bench-normals
+	const GLuint NORMALS_BENCHMARK_TRIANGLES = 1000000;
+
+	// Objects --bench-draws submits per frame, and the frames timed for each
+	// count and submission path (the fastest is reported)
+	const GLuint DRAW_BENCHMARK_OBJECTS[] = { 10000, 100000 };
+	const int DRAW_BENCHMARK_FRAMES = 5;
+
+	// Shapes --verify-compute generates on the GPU and compares with the CPU
+	// generators, in both vertex layouts: coarse, default and large enough for
+	// 32 bit indices in the packed layout
+	struct ComputeCase
+	{
+		MeshCompute::Shape shape;
+		float params[4];
+	};
+
+	const ComputeCase COMPUTE_VERIFY_CASES[] =
+	{
+		{ MeshCompute::SHAPE_TORUS, { 3.0f, 3.0f, 1.0f, 0.1f } },
+		{ MeshCompute::SHAPE_TORUS, { 30.0f, 30.0f, 1.0f, 0.1f } },
+		{ MeshCompute::SHAPE_TORUS, { 300.0f, 240.0f, 2.5f, 0.75f } },
+		{ MeshCompute::SHAPE_SPHERE, { 3.0f, 2.0f, 1.0f } },
+		{ MeshCompute::SHAPE_SPHERE, { 16.0f, 16.0f, 1.0f } },
+		{ MeshCompute::SHAPE_SPHERE, { 400.0f, 200.0f, 3.0f } }
+	};
+
+	// Meshes imported with --import stand in a row at the back of the desk,
+	// scaled so their largest side is IMPORT_SIZE, colored per material
+	const glm::vec3 IMPORT_POSITION(-2.5f, 0.0f, -3.5f);
+	const float IMPORT_SPACING = 2.5f;
+	const float IMPORT_SIZE = 2.0f;
+	const glm::vec4 IMPORT_NO_MATERIAL_COLOR(0.8f, 0.8f, 0.8f, 1.0f);
+	const glm::vec4 IMPORT_MATERIAL_COLORS[] =
+	{
+		glm::vec4(0.8f, 0.3f, 0.2f, 1.0f),
+		glm::vec4(0.3f, 0.6f, 0.3f, 1.0f),
+		glm::vec4(0.2f, 0.4f, 0.8f, 1.0f),
+		glm::vec4(0.8f, 0.7f, 0.2f, 1.0f),
+		glm::vec4(0.6f, 0.3f, 0.7f, 1.0f),
+		glm::vec4(0.2f, 0.7f, 0.7f, 1.0f)
+	};
+
+	// Meshes streamed with --stream stand in a row behind the imported ones
+	const glm::vec3 STREAM_POSITION(-2.5f, 0.0f, -6.5f);
+	const float STREAM_SPACING = 4.0f;
+	const float STREAM_SIZE = 3.5f;
+	const glm::vec4 STREAM_COLOR(0.75f, 0.7f, 0.6f, 1.0f);
 }
 
 /* User-defined Function prototypes to:
@@ -108,65 +360,156 @@ void UProcessInput(GLFWwindow* window);
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos); // Change the orientation of the camera
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset); // Adjust speed of movement
 void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods); // Get the input for mouse button use
+void UKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods); // Change the torus parameters
+bool UAcquireMeshes(); // Get the meshes drawn by URender from the mesh registry
+void UReleaseMeshes();
 void URender();
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
+int USelectLod(const Meshes::GLMesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection); // Pick a LOD by its screen space error
+void USetFaceCulling(const Meshes::GLMesh& mesh); // Cull back faces of closed meshes only
+void USetFaceCulling(bool closed);
+void UDrawMesh(const Meshes::GLMesh& mesh, int lod = 0, const InstanceRange* instances = nullptr); // Draw a whole mesh from the geometry heap
+void UDrawMeshPart(const Meshes::GLMesh& mesh, int part, int lod = 0, const InstanceRange* instances = nullptr); // Draw one index range of a mesh
+void UDrawMeshMaterials(const Meshes::GLMesh& mesh, int lod = 0, const InstanceRange* instances = nullptr); // Draw a whole mesh with a material per part
+void UDrawElements(const Meshes::GLMesh& mesh, GLuint firstIndex, GLuint nIndices, const InstanceRange* instances); // Draw an index range once or per instance
+MeshGen::MeshPart UIndexRange(const Meshes::GLMesh& mesh, int part, int lod); // Indices of a part, or of a whole LOD with ALL_PARTS
+void USetPartMaterials(const Meshes::GLMesh& mesh, int lod); // Set the parts of the next draws, each with its own material
+void UDrawIndirect(const DrawBatch& batch); // Draw the commands of a batch with glMultiDrawElementsIndirect
+void UDrawMeshCulled(const Meshes::GLMesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection); // Draw the visible clusters of a mesh
+bool UMeshletVisible(const MeshGen::Meshlet& meshlet, const glm::vec4* planes, const glm::vec3& camera, const glm::vec3& viewDirection, bool orthographic);
+void UDrawPatches(const Meshes::GLMesh& mesh, const PatchSurface* surfaces, const PartMaterial* materials); // Draw a patch mesh with the tessellation program
+void USubmitDraw(const Meshes::GLMesh& mesh, const glm::mat4& model, GLint texture, const glm::vec4& color, const PartMaterial* materials = nullptr, const PatchSurface* surfaces = nullptr); // Add a draw to the frame's render queue
+void USubmitMeshPart(const Meshes::GLMesh& mesh, const glm::mat4& model, const glm::vec4& color, int part, int lod);
+void USetFrameData(const glm::mat4& view, const glm::mat4& projection); // Start the frame data with the camera and lights
+MaterialKey UMaterialKey(const DrawItem& item); // Key of the material a draw shares with others
+void UDrawQueue(const glm::mat4& view, const glm::mat4& projection); // Sort and execute the frame's draws
+void UGatherInstances(const glm::mat4& view, const glm::mat4& projection, std::vector<DrawBatch>& batches); // Group the sorted draws into instanced draws
+void UBuildCommands(std::vector<DrawBatch>& batches); // Merge the instanced draws sharing their state into indirect draws
+void UBenchDraws(); // Time the draw submission paths on generated scenes for --bench-draws
+RingBuffer::Stats URingStats(); // Fence waits of the ring buffers of the per frame data
+bool UCompileShader(GLenum type, GLsizei count, const char* const* sources, const char* stage, GLuint& shaderId);
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId, const char* sharedSource = nullptr);
+bool UCreateTessShaderProgram(const char* vtxShaderSource, const char* tessSurfaceShaderSource, const char* tessControlShaderSource, const char* tessEvalShaderSource, const char* fragShaderSource, GLuint& programId, const char* sharedSource);
 void UDestroyShaderProgram(GLuint programId);
 
 //Make texture
 bool UCreateTexture(const char* filename, GLuint& textureId);
 //destroy texture
 void UDestroyTexture(GLuint textureId);
+bool UBuildStream(const char* sourceFilename, const char* streamFilename); // Write the stream file of an asset for --stream
+bool UVerifyCompute(); // Compare the compute shader meshes with the CPU generators for --verify-compute
 
 ////////////////////////////////////////////////////////////////////////////////////////
 // SHADER CODE
+/* Frame data: the first source string of the main shaders and the tessellation
+stages, with the blocks written by gFrameData (FrameData in framedata.h) */
+const GLchar* sceneDataShaderSource = GLSL(440,
+	// Camera and lights of the frame
+	layout(std140, binding = 0) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPosition;
+	float ambientStrength; // Set ambient or global lighting strength
+	vec3 ambientColor;
+	float specularIntensity1;
+	vec3 light1Color;
+	float highlightSize1;
+	vec3 light1Position;
+};
+
+// Object drawn this frame; material is its first entry in materials, followed
+// by one per part for draws with per part materials
+struct Object
+{
+	mat4 model;
+	mat3 normalMatrix; // Inverse transpose of the model's upper 3x3
+	int material;
+};
+
+layout(std430, binding = 1) readonly buffer ObjectBlock
+{
+	Object objects[];
+};
+
+struct Material
+{
+	vec4 color; // Flat color without a texture
+	int hasTexture; // The draw's uTexture replaces color
+};
+
+layout(std430, binding = 2) readonly buffer MaterialBlock
+{
+	Material materials[];
+};
+
+uniform int uObject; // Object of a single draw
+);
+
+
 /* Vertex Shader Source Code*/
-const GLchar* vertexShaderSource = GLSL(440,
+const GLchar* vertexShaderSource = GLSL_BODY(
 	layout(location = 0) in vec3 vertexPosition; // Vertex data from Vertex Attrib Pointer 0
 layout(location = 1) in vec3 vertexNormal; // VAP position 1 for normals
 layout(location = 2) in vec2 textureCoordinate;
+layout(location = 3) in uint instanceObject; // Instanced draws (ubInstanced): object of the instance
 
 out vec3 vertexFragmentNormal; // For outgoing normals to fragment shader
 out vec3 vertexFragmentPos; // For outgoing color / pixels to fragment shader
 out vec2 vertexTextureCoordinate;
+flat out int vertexMaterial;
 //out vec4 vertexColor; // variable to transfer color data to the fragment shader
 //out vec2 vertexTextureCoordinate;
 
-//Global variables for the  transform matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool ubOctNormals; // Packed vertex layout: normals arrive octahedral encoded in xy
+uniform bool ubInstanced; // The object comes from the instance attribute instead of uObject
+
+// Unfold an octahedral encoded normal back onto the unit sphere
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(vertexPosition, 1.0f); // Transforms vertices into clip coordinates
+	Object drawn = objects[ubInstanced ? int(instanceObject) : uObject];
+	gl_Position = projection * view * drawn.model * vec4(vertexPosition, 1.0f); // Transforms vertices into clip coordinates
 
-	vertexFragmentPos = vec3(model * vec4(vertexPosition, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
+	vertexFragmentPos = vec3(drawn.model * vec4(vertexPosition, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
 
-	vertexFragmentNormal = mat3(transpose(inverse(model))) * vertexNormal; // get normal vectors in world space only and exclude normal translation properties
+	vec3 normal = ubOctNormals ? octDecode(vertexNormal.xy) : vertexNormal;
+	vertexFragmentNormal = drawn.normalMatrix * normal; // get normal vectors in world space only and exclude normal translation properties
 	vertexTextureCoordinate = textureCoordinate;
+	vertexMaterial = drawn.material;
 }
 );
 
+// The vertex shader inputs above: every mesh layout must feed exactly these locations
+static_assert(Meshes::FloatLayout::UMatches<ShaderInput<0, 3>, ShaderInput<1, 3>, ShaderInput<2, 2>>(), "float vertex layout does not match the vertex shader");
+static_assert(Meshes::PackedLayout::UFeeds<ShaderInput<0, 3>, ShaderInput<1, 3>, ShaderInput<2, 2>>(), "packed vertex layout does not feed the vertex shader");
+static_assert(Meshes::PackedHalfUVLayout::UFeeds<ShaderInput<0, 3>, ShaderInput<1, 3>, ShaderInput<2, 2>>(), "packed vertex layout does not feed the vertex shader");
+static_assert(InstanceBuffer::Layout::UMatches<ShaderInput<3, 1>>(), "instance layout does not match the vertex shader");
+
 
 /* Fragment Shader Source Code*/
-const GLchar* fragmentShaderSource = GLSL(440,
+const GLchar* fragmentShaderSource = GLSL_BODY(
 	in vec3 vertexFragmentNormal; // For incoming normals
 in vec3 vertexFragmentPos; // For incoming fragment position
 in vec2 vertexTextureCoordinate;
+flat in int vertexMaterial; // Material of the object, the first of its parts
 
 out vec4 fragmentColor; // For outgoing cube color to the GPU
 
-// Uniform / Global variables for object color, light color, light position, and camera/view position
-uniform vec4 objectColor;
-uniform vec3 ambientColor;
-uniform vec3 light1Color = vec3(0.8f, 0.7f, 0.3f);;
-uniform vec3 light1Position;
-uniform vec3 viewPosition;
+// The light color, light position, and camera/view position come from FrameBlock
 uniform sampler2D uTexture; // Useful when working with multiple textures
-uniform bool ubHasTexture;
-uniform float ambientStrength = 0.1f; // Set ambient or global lighting strength
-uniform float specularIntensity1 = 0.8f;
-uniform float highlightSize1 = 16.0f;
+
+// Parts of draws covering several parts with a material each (MAX_MATERIAL_PARTS);
+// with uPartCount 0 the whole draw uses the object's material
+uniform int uPartCount = 0;
+uniform int uPartEnd[3]; // One past the last triangle of each part, counted from the start of the draw
 
 void main()
 {
@@ -193,13 +536,26 @@ void main()
 	vec4 textureColor = texture(uTexture, vertexTextureCoordinate);
 	vec3 phong1;
 
-	if (ubHasTexture == true)
+	// the parts are consecutive triangle ranges, so the primitive id selects the material
+	int part = 0;
+	for (int i = 0; i < uPartCount; i++)
+	{
+		if (gl_PrimitiveID < uPartEnd[i])
+		{
+			part = i;
+			break;
+		}
+	}
+	vec4 color = materials[vertexMaterial + part].color;
+	bool hasTexture = materials[vertexMaterial + part].hasTexture != 0;
+
+	if (hasTexture == true)
 	{
 		phong1 = (ambient + diffuse1 + specular1) * textureColor.xyz;
 	}
 	else
 	{
-		phong1 = (ambient + diffuse1 + specular1) * objectColor.xyz;
+		phong1 = (ambient + diffuse1 + specular1) * color.xyz;
 	}
 
 	fragmentColor = vec4(phong1, 1.0); // Send lighting results to GPU
@@ -208,6 +564,265 @@ void main()
 );
 ///////////////////////////////////////////////////////////////////////////////////////
 
+/* Tessellation Shader Source Code: the vertex shader hands the control points of a
+patch mesh on in object space, the control shader picks the refinement from the
+projected edge lengths and the evaluation shader places the new vertices on the
+exact surface before lighting them with fragmentShaderSource */
+const GLchar* tessVertexShaderSource = GLSL(440,
+	layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 textureCoordinate;
+
+out vec3 tessPosition;
+out vec3 tessNormal;
+out vec2 tessTextureCoordinate;
+
+uniform bool ubOctNormals; // Packed vertex layout: normals arrive octahedral encoded in xy
+
+// Unfold an octahedral encoded normal back onto the unit sphere
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	tessPosition = vertexPosition;
+	tessNormal = ubOctNormals ? octDecode(vertexNormal.xy) : vertexNormal;
+	tessTextureCoordinate = textureCoordinate;
+}
+);
+
+// The tessellation vertex shader reads the same inputs as the vertex shader
+static_assert(Meshes::FloatLayout::UMatches<ShaderInput<0, 3>, ShaderInput<1, 3>, ShaderInput<2, 2>>(), "float vertex layout does not match the tessellation vertex shader");
+static_assert(Meshes::PackedLayout::UFeeds<ShaderInput<0, 3>, ShaderInput<1, 3>, ShaderInput<2, 2>>(), "packed vertex layout does not feed the tessellation vertex shader");
+static_assert(Meshes::PackedHalfUVLayout::UFeeds<ShaderInput<0, 3>, ShaderInput<1, 3>, ShaderInput<2, 2>>(), "packed half float UV vertex layout does not feed the tessellation vertex shader");
+
+
+/* The surfaces of the patch meshes: compiled before the control and evaluation
+shaders, which find the same points on them */
+const GLchar* tessSurfaceShaderSource = GLSL_BODY(
+	uniform float uTorusMainRadius; // Distance of the torus tube center from its axis
+
+const float TWO_PI = 6.28318531f;
+
+// Angle moved by whole turns to within half a turn of reference
+float unwrap(float angle, float reference)
+{
+	return angle + TWO_PI * round((reference - angle) / TWO_PI);
+}
+
+// Flat cap: one control point is the center, the other two lie on the rim. Moving
+// along the arc between the rim points instead of the chord gives the barycentric
+// weights of a point on the round disk, which also place its texture coords.
+void disk(vec3 p[3], vec3 n[3], vec2 t[3], vec3 w, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	int center = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (length(p[i].xz) < length(p[center].xz))
+			center = i;
+	}
+	int rim1 = (center + 1) % 3;
+	int rim2 = (center + 2) % 3;
+
+	vec3 b = w;
+	float rimWeight = w[rim1] + w[rim2];
+	float arc = acos(clamp(dot(normalize(p[rim1].xz), normalize(p[rim2].xz)), -1.0f, 1.0f));
+	if (rimWeight > 0.0f && arc > 0.0f)
+	{
+		float along = w[rim2] / rimWeight;
+		b[rim1] = rimWeight * sin((1.0f - along) * arc) / sin(arc);
+		b[rim2] = rimWeight * sin(along * arc) / sin(arc);
+		b[center] = 1.0f - b[rim1] - b[rim2];
+	}
+
+	position = b.x * p[0] + b.y * p[1] + b.z * p[2];
+	normal = w.x * n[0] + w.y * n[1] + w.z * n[2];
+	uv = b.x * t[0] + b.y * t[1] + b.z * t[2];
+}
+
+// Sides around the Y axis: angle, distance from the axis and height are interpolated
+// instead of the position, and the normal in the same rotating frame. Control points
+// on the axis (a cone tip) have no angle and follow the others.
+void revolved(vec3 p[3], vec3 n[3], vec2 t[3], vec3 w, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	float angle = 0.0f;
+	float angleWeight = 0.0f;
+	float reference = 0.0f;
+	float radius = 0.0f;
+	float height = 0.0f;
+	vec2 radialNormal = vec2(0.0f);
+	for (int i = 0; i < 3; i++)
+	{
+		float r = length(p[i].xz);
+		radius += w[i] * r;
+		height += w[i] * p[i].y;
+		if (r > 1e-5f)
+		{
+			float a = atan(p[i].z, p[i].x);
+			reference = angleWeight > 0.0f ? reference : a;
+			angle += w[i] * unwrap(a, reference);
+			angleWeight += w[i];
+			radialNormal += w[i] * vec2(dot(n[i].xz, p[i].xz) / r, n[i].y);
+		}
+		else
+			radialNormal += w[i] * vec2(length(n[i].xz), n[i].y);
+	}
+	angle /= max(angleWeight, 1e-6f);
+
+	position = vec3(radius * cos(angle), height, radius * sin(angle));
+	normal = vec3(radialNormal.x * cos(angle), radialNormal.y, radialNormal.x * sin(angle));
+	uv = w.x * t[0] + w.y * t[1] + w.z * t[2];
+}
+
+// Torus around the Z axis: the angle around the axis and the polar coordinates
+// around the tube center are interpolated, then the torus is evaluated exactly
+void torus(vec3 p[3], vec2 t[3], vec3 w, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	float mainAngle = 0.0f;
+	float tubeAngle = 0.0f;
+	float tubeRadius = 0.0f;
+	float mainReference = atan(p[0].y, p[0].x);
+	float tubeReference = atan(p[0].z, length(p[0].xy) - uTorusMainRadius);
+	for (int i = 0; i < 3; i++)
+	{
+		vec2 tube = vec2(length(p[i].xy) - uTorusMainRadius, p[i].z);
+		mainAngle += w[i] * unwrap(atan(p[i].y, p[i].x), mainReference);
+		tubeAngle += w[i] * unwrap(atan(tube.y, tube.x), tubeReference);
+		tubeRadius += w[i] * length(tube);
+	}
+
+	float radius = uTorusMainRadius + tubeRadius * cos(tubeAngle);
+	position = vec3(radius * cos(mainAngle), radius * sin(mainAngle), tubeRadius * sin(tubeAngle));
+	normal = vec3(cos(tubeAngle) * cos(mainAngle), cos(tubeAngle) * sin(mainAngle), sin(tubeAngle));
+	uv = w.x * t[0] + w.y * t[1] + w.z * t[2];
+}
+
+// Point of a patch on surface (PatchSurface) at the barycentric weights w
+void surfacePoint(int surface, vec3 p[3], vec3 n[3], vec2 t[3], vec3 w, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	if (surface == 0)
+		disk(p, n, t, w, position, normal, uv);
+	else if (surface == 1)
+		revolved(p, n, t, w, position, normal, uv);
+	else
+		torus(p, t, w, position, normal, uv);
+}
+);
+
+
+const GLchar* tessControlShaderSource = GLSL_BODY(
+	layout(vertices = 3) out;
+
+in vec3 tessPosition[];
+in vec3 tessNormal[];
+in vec2 tessTextureCoordinate[];
+
+out vec3 controlPosition[];
+out vec3 controlNormal[];
+out vec2 controlTextureCoordinate[];
+
+uniform int uSurface; // PatchSurface of the drawn part
+uniform float uViewportHeight; // Pixels
+uniform float uTessEdgePixels; // Length of a refined edge on the screen
+uniform float uTessErrorPixels; // Largest distance of a refined edge from the surface on the screen
+
+// Pixels per view space unit at the depth of p
+float pixelScale(vec3 p)
+{
+	float scale = projection[1][1] * 0.5f * uViewportHeight;
+	if (projection[3][3] == 0.0f)
+		scale /= max(-p.z, 0.1f); // perspective, kept in front of the near plane
+	return scale;
+}
+
+// Refinement of the edge between control points a and b: short enough on the
+// screen, and split until the chord stays within uTessErrorPixels of the surface,
+// which shrinks with the square of the level. The patches sharing an edge find the
+// same surface point halfway along it, so their levels agree and they meet without cracks.
+float edgeLevel(int a, int b)
+{
+	vec3 p[3] = vec3[3](tessPosition[0], tessPosition[1], tessPosition[2]);
+	vec3 n[3] = vec3[3](tessNormal[0], tessNormal[1], tessNormal[2]);
+	vec2 t[3] = vec2[3](tessTextureCoordinate[0], tessTextureCoordinate[1], tessTextureCoordinate[2]);
+	vec3 w = vec3(0.0f);
+	w[a] = 0.5f;
+	w[b] = 0.5f;
+	vec3 middle;
+	vec3 normal;
+	vec2 uv;
+	surfacePoint(uSurface, p, n, t, w, middle, normal, uv);
+
+	mat4 modelView = view * objects[uObject].model;
+	vec3 viewA = vec3(modelView * vec4(p[a], 1.0f));
+	vec3 viewB = vec3(modelView * vec4(p[b], 1.0f));
+	vec3 viewMiddle = vec3(modelView * vec4(middle, 1.0f));
+	vec3 chordMiddle = 0.5f * (viewA + viewB);
+	float scale = pixelScale(chordMiddle);
+
+	float lengthLevel = distance(viewA, viewB) * scale / uTessEdgePixels;
+	float errorLevel = sqrt(distance(viewMiddle, chordMiddle) * scale / uTessErrorPixels);
+	return clamp(max(lengthLevel, errorLevel), 1.0f, 64.0f);
+}
+
+void main()
+{
+	controlPosition[gl_InvocationID] = tessPosition[gl_InvocationID];
+	controlNormal[gl_InvocationID] = tessNormal[gl_InvocationID];
+	controlTextureCoordinate[gl_InvocationID] = tessTextureCoordinate[gl_InvocationID];
+
+	if (gl_InvocationID == 0)
+	{
+		// outer level i refines the edge opposite control point i
+		gl_TessLevelOuter[0] = edgeLevel(1, 2);
+		gl_TessLevelOuter[1] = edgeLevel(2, 0);
+		gl_TessLevelOuter[2] = edgeLevel(0, 1);
+		gl_TessLevelInner[0] = max(gl_TessLevelOuter[0], max(gl_TessLevelOuter[1], gl_TessLevelOuter[2]));
+	}
+}
+);
+
+
+const GLchar* tessEvaluationShaderSource = GLSL_BODY(
+	layout(triangles, fractional_odd_spacing, ccw) in;
+
+in vec3 controlPosition[];
+in vec3 controlNormal[];
+in vec2 controlTextureCoordinate[];
+
+out vec3 vertexFragmentNormal;
+out vec3 vertexFragmentPos;
+out vec2 vertexTextureCoordinate;
+flat out int vertexMaterial;
+
+uniform int uSurface; // PatchSurface of the drawn part
+uniform int uMaterialOffset; // Material of the drawn part after the object's first one
+
+void main()
+{
+	vec3 p[3] = vec3[3](controlPosition[0], controlPosition[1], controlPosition[2]);
+	vec3 n[3] = vec3[3](controlNormal[0], controlNormal[1], controlNormal[2]);
+	vec2 t[3] = vec2[3](controlTextureCoordinate[0], controlTextureCoordinate[1], controlTextureCoordinate[2]);
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+	surfacePoint(uSurface, p, n, t, gl_TessCoord, position, normal, uv);
+
+	Object drawn = objects[uObject];
+	gl_Position = projection * view * drawn.model * vec4(position, 1.0f);
+	vertexFragmentPos = vec3(drawn.model * vec4(position, 1.0f));
+	vertexFragmentNormal = drawn.normalMatrix * normal;
+	vertexTextureCoordinate = uv;
+	vertexMaterial = drawn.material + uMaterialOffset;
+}
+);
+///////////////////////////////////////////////////////////////////////////////////////
+
 /* Lamp Shader Source Code*/
 const GLchar* lampVertexShaderSource = GLSL(440,
 
@@ -224,6 +839,9 @@ void main()
 }
 );
 
+// The lamp shader only reads the position
+static_assert(Meshes::FloatLayout::UHasLocation(0) && Meshes::PackedLayout::UHasLocation(0), "vertex layouts without a position");
+
 
 /* Fragment Shader Source Code*/
 const GLchar* lampFragmentShaderSource = GLSL(440,
@@ -257,20 +875,104 @@ void flipImageVertically(unsigned char* image, int width, int height, int channe
 
 int main(int argc, char* argv[])
 {
+	// Command line switches
+	bool verifyCompute = false;
+	bool benchDraws = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--packed-vertices") == 0)
+			meshes.vertexFormat = Meshes::VERTEX_PACKED;
+		else if (strcmp(argv[i], "--no-mesh-cache") == 0)
+			meshes.useMeshCache = false;
+		else if (strcmp(argv[i], "--no-cluster-culling") == 0)
+			gClusterCulling = false;
+		else if (strcmp(argv[i], "--no-face-culling") == 0)
+			gFaceCulling = false;
+		else if (strcmp(argv[i], "--tessellation") == 0)
+			gTessellation = true;
+		else if (strcmp(argv[i], "--unsorted-draws") == 0)
+			gRenderQueue.order = RenderQueue::SORT_NONE;
+		else if (strcmp(argv[i], "--front-to-back") == 0)
+			gRenderQueue.order = RenderQueue::SORT_FRONT_TO_BACK;
+		else if (strcmp(argv[i], "--instancing") == 0)
+			gInstancing = true;
+		else if (strcmp(argv[i], "--indirect-draws") == 0)
+			gInstancing = gIndirectDraws = true;
+		else if (strcmp(argv[i], "--bench-draws") == 0)
+			benchDraws = true;
+		else if (strcmp(argv[i], "--compute-meshes") == 0)
+			meshes.computeMeshes = true;
+		else if (strcmp(argv[i], "--verify-compute") == 0)
+			verifyCompute = true;
+		else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc)
+			meshes.importFiles.push_back(argv[++i]);
+		else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+			meshes.streamFiles.push_back(argv[++i]);
+		else if (strcmp(argv[i], "--stream-budget") == 0 && i + 1 < argc)
+			meshes.streamBudgetBytes = GLuint(std::max(1, atoi(argv[++i]))) << 20;
+		else if (strcmp(argv[i], "--build-stream") == 0 && i + 2 < argc)
+		{
+			// CPU only, runs without opening a window
+			const char* sourceFilename = argv[++i];
+			const char* streamFilename = argv[++i];
+			return UBuildStream(sourceFilename, streamFilename) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		else if (strcmp(argv[i], "--bench-normals") == 0)
+		{
+			// CPU only, runs without opening a window
+			MeshNormals::UBenchmark(NORMALS_BENCHMARK_TRIANGLES);
+			return EXIT_SUCCESS;
+		}
+	}
+
 	if (!UInitialize(argc, argv, &gWindow))
 		return EXIT_FAILURE;
 
+	// needs the GL context only, exits before the scene is set up
+	if (verifyCompute)
+	{
+		bool verified = UVerifyCompute();
+		glfwTerminate();
+		return verified ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	// Create the mesh
 	//UCreateMesh(gMesh); // Calls the function to create the Vertex Buffer Object
 	meshes.CreateMeshes();
+	if (!UAcquireMeshes())
+		return EXIT_FAILURE;
+	meshes.ReportMeshes();
+	gTorusRequest = meshes.torusParams;
 
 	// Create the shader program
-	if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId))
+	if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId, sceneDataShaderSource))
 		return EXIT_FAILURE;
 
 	if(!UCreateShaderProgram(lampVertexShaderSource, lampFragmentShaderSource, gLampProgramId))
 		return EXIT_FAILURE;
 
+	// the tessellation program lights with the same fragment shader, and reads the
+	// camera, lights and objects from the same frame data as gProgramId
+	if (gTessellation)
+	{
+		if (!UCreateTessShaderProgram(tessVertexShaderSource, tessSurfaceShaderSource, tessControlShaderSource, tessEvaluationShaderSource, fragmentShaderSource, gTessProgramId, sceneDataShaderSource))
+			return EXIT_FAILURE;
+		glUniform1i(glGetUniformLocation(gTessProgramId, "ubOctNormals"), meshes.vertexFormat == Meshes::VERTEX_PACKED);
+		glUniform1f(glGetUniformLocation(gTessProgramId, "uViewportHeight"), GLfloat(WINDOW_HEIGHT));
+		glUniform1f(glGetUniformLocation(gTessProgramId, "uTessEdgePixels"), TESS_EDGE_PIXELS);
+		glUniform1f(glGetUniformLocation(gTessProgramId, "uTessErrorPixels"), TESS_ERROR_PIXELS);
+		glUniform1f(glGetUniformLocation(gTessProgramId, "uTorusMainRadius"), meshes.torusParams.mainRadius);
+		glPatchParameteri(GL_PATCH_VERTICES, 3);
+	}
+
+	// every mesh winds its front faces counterclockwise (see MeshOpt::UOrientWinding)
+	glFrontFace(GL_CCW);
+	glCullFace(GL_BACK);
+
+	// the packed vertex layout stores normals octahedral encoded
+	gGLState.UseProgram(gProgramId);
+	gGLState.Uniform1i(glGetUniformLocation(gProgramId, "ubOctNormals"), meshes.vertexFormat == Meshes::VERTEX_PACKED);
+
 	// Load textures
 	const char* texFilename = "CubeTexture1.jpg";
 	if (!UCreateTexture(texFilename, gTexture1Id))
@@ -322,34 +1024,24 @@ int main(int argc, char* argv[])
 	}
 
 	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, gTexture2Id);
-
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, gTexture3Id);
-
-	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, gTexture4Id);
-
-	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_2D, gTexture5Id);
-
-	glActiveTexture(GL_TEXTURE5);
-	glBindTexture(GL_TEXTURE_2D, gTexture6Id);
-
-	glActiveTexture(GL_TEXTURE6);
-	glBindTexture(GL_TEXTURE_2D, gTexture7Id);
+	const GLuint textureIds[] = { gTexture1Id, gTexture2Id, gTexture3Id, gTexture4Id, gTexture5Id, gTexture6Id, gTexture7Id };
+	for (GLuint unit = 0; unit < sizeof(textureIds) / sizeof(textureIds[0]); unit++)
+		gGLState.BindTexture(unit, GL_TEXTURE_2D, textureIds[unit]);
 
 	// Sets the background color of the window to black (it will be implicitely used by glClear)
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	gGLState.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
 	gCamera.Position = glm::vec3(0.0f, 1.0f, 16.0f);
 	gCamera.Front = glm::vec3(0.0, 0.0, -1.0f);
 	gCamera.Up = glm::vec3(0.0, 1.0, 0.0);
 
+	// times generated scenes instead of rendering this one
+	if (benchDraws)
+	{
+		UBenchDraws();
+		glfwSetWindowShouldClose(gWindow, true);
+	}
+
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(gWindow))
@@ -363,18 +1055,37 @@ int main(int argc, char* argv[])
 		// -----
 		UProcessInput(gWindow);
 
+		// swap in meshes regenerated on the worker thread
+		if (meshes.UpdateMeshes() && gTessellation)
+			glProgramUniform1f(gTessProgramId, glGetUniformLocation(gTessProgramId, "uTorusMainRadius"), meshes.torusParams.mainRadius);
+
 		// Render this frame
 		URender();
 
 		glfwPollEvents();
 	}
 
+	for (const std::unique_ptr<MeshStream>& stream : meshes.gStreamedMeshes)
+	{
+		cout << "INFO: Mesh stream: " << stream->stats.uploads << " nodes uploaded, "
+			<< stream->stats.evictions << " evicted" << endl;
+	}
+	RingBuffer::Stats ringStats = URingStats();
+	cout << "INFO: Per frame data: " << ringStats.claims << " ring buffer regions written, " << ringStats.stalls
+		<< " waited for the GPU for " << ringStats.stallMs << " ms" << endl;
+
 	// Release mesh data
+	UReleaseMeshes();
 	meshes.DestroyMeshes();
+	gInstances.Destroy();
+	gDrawCommands.Destroy();
+	gFrameData.Destroy();
 
 	// Release shader program
 	UDestroyShaderProgram(gProgramId);
 	UDestroyShaderProgram(gLampProgramId);
+	if (gTessellation)
+		UDestroyShaderProgram(gTessProgramId);
 
 	// Release texture
 	UDestroyTexture(gTexture1Id);
@@ -418,6 +1129,7 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
 	glfwSetCursorPosCallback(*window, UMousePositionCallback);
 	glfwSetScrollCallback(*window, UMouseScrollCallback);
 	glfwSetMouseButtonCallback(*window, UMouseButtonCallback);
+	glfwSetKeyCallback(*window, UKeyCallback);
 
 	// Tells GLFW to capture the mouse:
 	glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -537,23 +1249,80 @@ void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 	}
 }
 
+//glfw: handle key presses that change settings once per press
+//	1/2: fewer/more torus main segments, 3/4: tube segments
+//	5/6: smaller/larger torus main radius, 7/8: tube radius
+void UKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	if (action != GLFW_PRESS)
+		return;
+
+	Meshes::TorusParams request = gTorusRequest;
+	switch (key) {
+	case GLFW_KEY_1: request.mainSegments -= TORUS_SEGMENT_STEP; break;
+	case GLFW_KEY_2: request.mainSegments += TORUS_SEGMENT_STEP; break;
+	case GLFW_KEY_3: request.tubeSegments -= TORUS_SEGMENT_STEP; break;
+	case GLFW_KEY_4: request.tubeSegments += TORUS_SEGMENT_STEP; break;
+	case GLFW_KEY_5: request.mainRadius -= TORUS_RADIUS_STEP; break;
+	case GLFW_KEY_6: request.mainRadius += TORUS_RADIUS_STEP; break;
+	case GLFW_KEY_7: request.tubeRadius -= TORUS_RADIUS_STEP; break;
+	case GLFW_KEY_8: request.tubeRadius += TORUS_RADIUS_STEP; break;
+	default:
+		return;
+	}
+
+	// keep the tube inside the main radius so the torus does not fold over its axis
+	request.mainSegments = std::min(std::max(request.mainSegments, TORUS_MIN_SEGMENTS), TORUS_MAX_SEGMENTS);
+	request.tubeSegments = std::min(std::max(request.tubeSegments, TORUS_MIN_SEGMENTS), TORUS_MAX_SEGMENTS);
+	request.tubeRadius = std::max(request.tubeRadius, TORUS_MIN_RADIUS);
+	request.mainRadius = std::max(request.mainRadius, request.tubeRadius + TORUS_MIN_RADIUS);
+	request.tubeRadius = std::min(request.tubeRadius, request.mainRadius - TORUS_MIN_RADIUS);
+
+	gTorusRequest = request;
+	meshes.RegenerateTorus(request);
+}
+
+
+// Acquires the meshes drawn by URender; only these are created
+bool UAcquireMeshes()
+{
+	gPlaneMesh = meshes.AcquireMesh("plane");
+	gBoxMesh = meshes.AcquireMesh("box");
+	gCylinderMesh = meshes.AcquireMesh("cylinder");
+	gSmallCylinderMesh = meshes.AcquireMesh("cylinder", { SMALL_CYLINDER_SLICES });
+	gTaperedCylinderMesh = meshes.AcquireMesh("tapered cylinder");
+	gPyramid4Mesh = meshes.AcquireMesh("pyramid", { 4.0f });
+	gTorusMesh = meshes.AcquireTorus();
+	bool acquired = gPlaneMesh && gBoxMesh && gCylinderMesh && gSmallCylinderMesh && gTaperedCylinderMesh && gPyramid4Mesh && gTorusMesh;
+
+	if (gTessellation)
+	{
+		gCylinderPatchMesh = meshes.AcquireMesh("cylinder patches");
+		gTaperedCylinderPatchMesh = meshes.AcquireMesh("tapered cylinder patches");
+		gTorusPatchMesh = meshes.AcquireTorus(true);
+		acquired = acquired && gCylinderPatchMesh && gTaperedCylinderPatchMesh && gTorusPatchMesh;
+	}
+	return acquired;
+}
+
+// Releases the meshes acquired by UAcquireMeshes
+void UReleaseMeshes()
+{
+	const Meshes::GLMesh** acquired[] =
+	{
+		&gPlaneMesh, &gBoxMesh, &gCylinderMesh, &gSmallCylinderMesh, &gTaperedCylinderMesh, &gPyramid4Mesh, &gTorusMesh,
+		&gCylinderPatchMesh, &gTaperedCylinderPatchMesh, &gTorusPatchMesh
+	};
+	for (const Meshes::GLMesh** mesh : acquired)
+	{
+		meshes.ReleaseMesh(*mesh);
+		*mesh = nullptr;
+	}
+}
+
 
 // Functioned called to render a frame
 void URender()
 {
-	GLint modelLoc;
-	GLint viewLoc;
-	GLint projLoc;
-	GLint viewPosLoc;
-	GLint ambStrLoc;
-	GLint ambColLoc;
-	GLint light1ColLoc;
-	GLint light1PosLoc;
-	GLint objColLoc;
-	GLint specInt1Loc;
-	GLint highlghtSz1Loc;
-	GLint uHasTextureLoc;
-	bool ubHasTextureVal;
 	glm::mat4 scale;
 	glm::mat4 rotation;
 	glm::mat4 rotation1;
@@ -563,11 +1332,15 @@ void URender()
 	glm::mat4 view;
 	glm::mat4 projection;
 
+	gClusterStats = {};
+	gDraws = 0;
+	gGLState.ResetStats();
+
 	// Enable z-depth
-	glEnable(GL_DEPTH_TEST);
+	gGLState.SetEnabled(GL_DEPTH_TEST, true);
 
 	// Clear the frame and z buffers
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	gGLState.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	//camera/view transformation
@@ -578,52 +1351,22 @@ void URender()
 		// P for Perspective 
 		//projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
 		//projection = glm::perspective(glm::radians(60.0f), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
-		projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, FAR_PLANE);
 	}
 	else {
 		// O for Orthographic
 		view = glm::translate(glm::vec3(0.0f, -3.8f, -12.0f)); // To not view plane the camera has to be adjusted 
-		projection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.9f, 100.0f);
+		projection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.9f, FAR_PLANE);
 	}
 
-	// Set the shader to be used
-	glUseProgram(gProgramId);
-
-	// Retrieves and passes transform matrices to the Shader program
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	viewLoc = glGetUniformLocation(gProgramId, "view");
-	projLoc = glGetUniformLocation(gProgramId, "projection");
-	viewPosLoc = glGetUniformLocation(gProgramId, "viewPosition");
-	ambStrLoc = glGetUniformLocation(gProgramId, "ambientStrength");
-	ambColLoc = glGetUniformLocation(gProgramId, "ambientColor");
-	light1ColLoc = glGetUniformLocation(gProgramId, "light1Color");
-	light1PosLoc = glGetUniformLocation(gProgramId, "light1Position");
-	objColLoc = glGetUniformLocation(gProgramId, "objectColor");
-	specInt1Loc = glGetUniformLocation(gProgramId, "specularIntensity1");
-	highlghtSz1Loc = glGetUniformLocation(gProgramId, "highlightSize1");
-	uHasTextureLoc = glGetUniformLocation(gProgramId, "ubHasTexture");
-
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-	//set the camera view location
-	glUniform3f(viewPosLoc, gCamera.Position.x, gCamera.Position.y, gCamera.Position.z);
-	//set ambient lighting strength
-	glUniform1f(ambStrLoc, 2.4f);
-	//set ambient color
-	glUniform3f(ambColLoc, 0.2f, 0.2f, 0.2f);
-	glUniform3f(light1ColLoc, 0.8f, 0.7f, 0.6f);
-	glUniform3f(light1PosLoc, 0.0f, 2.0f, 4.0f);
-	//set specular intensity
-	glUniform1f(specInt1Loc, .6f);
-	//set specular highlight size
-	glUniform1f(highlghtSz1Loc, 12.0f);
+	// Passes the transform matrices and lighting to the shaders with the frame data
+	USetFrameData(view, projection);
 
 
-	// ----- Start Plane ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPlaneMesh.vao);
+	// Each object below is submitted to the render queue with its model matrix and
+	// material; UDrawQueue then sorts the draws by state and executes them
 
+	// ----- Start Plane ------
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(6.0f, 1.0f, 6.0f));
 	// 2. Rotate the object
@@ -632,29 +1375,14 @@ void URender()
 	translation = glm::translate(glm::vec3(0.0f, 0.0f, 0.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	
-
-	// Make false for coin purse & use: glUniform4f(objColLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-	ubHasTextureVal = true;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	// Point to the texture variable to texture unit 4 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
-
-	// Draws the triangles for the plane
-	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
 
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles for the plane with texture unit 4
+	USubmitDraw(*gPlaneMesh, model, 4, glm::vec4(1.0f));
 	// ----- End Plane ------
 
 	
 
 	// ----- Start Cube ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gBoxMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(1.5f, 1.5f, 1.5f));
 	// 2. Rotate the object
@@ -663,28 +1391,15 @@ void URender()
 	translation = glm::translate(glm::vec3(-3.5f, 0.759f, 0.5f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	//glProgramUniform4f(gProgramId, objectColorLoc, 0.7f, 0.5f, 0.0f, 1.0f);
-
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
-
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(1);
+	// Draws the triangles with texture unit 0
+	USubmitDraw(*gBoxMesh, model, 0, glm::vec4(1.0f));
 	// ----- End Cube ------
 
 	
 
 
 	// Lip Balm Cap:
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.5f, 0.3f, 0.5f));
 	// 2. Rotate the object
@@ -693,45 +1408,20 @@ void URender()
 	translation = glm::translate(glm::vec3(-0.5f, 0.55f, 0.5f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-
 
-	// Draws the triangles
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	// Use colors: 
-	ubHasTextureVal = false;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	glUniform4f(objColLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	//GLint UVScaleLoc = glGetUniformLocation(gProgramId, "uvScale");
-	//glUniform2fv(UVScaleLoc, 1, glm::value_ptr(gUVScale));
-	// Use colors: 
-	ubHasTextureVal = true;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 1);
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	// Use colors: 
-	ubHasTextureVal = false;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	glUniform4f(objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles in one call: white bottom, top with texture unit 1, yellow sides
+	const PartMaterial capMaterials[] = {
+		{ false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) },	// CYLINDER_BOTTOM
+		{ true, glm::vec4(1.0f) },						// CYLINDER_TOP
+		{ false, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f) }		// CYLINDER_SIDES
+	};
+	if (gTessellation)
+		USubmitDraw(*gCylinderPatchMesh, model, 1, glm::vec4(1.0f), capMaterials, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gCylinderMesh, model, 1, glm::vec4(1.0f), capMaterials);
 	// --------------------END Lip Balm Cap--------------------------------
 
 	// ------- Lip Balm center: -------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.4f, 0.2f, 0.4f));
 	// 2. Rotate the object
@@ -740,26 +1430,15 @@ void URender()
 	translation = glm::translate(glm::vec3(-0.5f, 0.35f, 0.5f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	// Use colors: 
-	ubHasTextureVal = false;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	glUniform4f(objColLoc, 1.0f, 1.0f, 1.0f, 1.0f);
 
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles in white
+	if (gTessellation)
+		USubmitDraw(*gCylinderPatchMesh, model, NO_TEXTURE, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), nullptr, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gCylinderMesh, model, NO_TEXTURE, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 	// --------------------END Lip Balm center-------------------------------- 
 
 	// ----- Start Lip Balm Base: ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.5f, 0.5f, 0.5f));
 	// 2. Rotate the object
@@ -768,27 +1447,17 @@ void URender()
 	translation = glm::translate(glm::vec3(-0.5f, 0.001f, 0.5f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-	
-	// Draws the triangles
-	// Use colors: 
-	ubHasTextureVal = false;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	glUniform4f(objColLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	ubHasTextureVal = true;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-
-	glEnable(GL_TEXTURE_2D);
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 3);
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles in one call: white caps, sides with texture unit 3
+	const PartMaterial baseMaterials[] = {
+		{ false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) },	// CYLINDER_BOTTOM
+		{ false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) },	// CYLINDER_TOP
+		{ true, glm::vec4(1.0f) }						// CYLINDER_SIDES
+	};
+	if (gTessellation)
+		USubmitDraw(*gCylinderPatchMesh, model, 3, glm::vec4(1.0f), baseMaterials, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gCylinderMesh, model, 3, glm::vec4(1.0f), baseMaterials);
 	// ------------------- END Lip Balm Base:--------------------------------- 
 
 
@@ -796,9 +1465,6 @@ void URender()
 
 	//For the fidget Toy
 	// ----- Torus Start: -----
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTorusMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.5f, 0.5f, 1.5f));
 	// 2. Rotate the object
@@ -807,22 +1473,15 @@ void URender()
 	translation = glm::translate(glm::vec3(-1.8f, 0.2f, 3.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 5);
 
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles with texture unit 5
+	if (gTessellation)
+		USubmitDraw(*gTorusPatchMesh, model, 5, glm::vec4(1.0f), nullptr, TORUS_PATCH_SURFACES);
+	else
+		USubmitDraw(*gTorusMesh, model, 5, glm::vec4(1.0f));
 	// ----- END Torus -----
 
 	// ----- Start Left Cylinder: ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.09f, 0.4f, 0.09f));
 	// 2. Rotate the object
@@ -831,24 +1490,15 @@ void URender()
 	translation = glm::translate(glm::vec3(-1.9f, 0.2f, 3.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
 
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 5);
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles with texture unit 5
+	if (gTessellation)
+		USubmitDraw(*gCylinderPatchMesh, model, 5, glm::vec4(1.0f), nullptr, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gSmallCylinderMesh, model, 5, glm::vec4(1.0f));
 	// ------------------- END  Left Cylinder:--------------------------------- 
 
 	// ----- Start Right Cylinder: ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.09f, 0.4f, 0.09f));
 	// 2. Rotate the object
@@ -857,24 +1507,15 @@ void URender()
 	translation = glm::translate(glm::vec3(-1.3f, 0.2f, 3.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
 
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 5);
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles with texture unit 5
+	if (gTessellation)
+		USubmitDraw(*gCylinderPatchMesh, model, 5, glm::vec4(1.0f), nullptr, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gSmallCylinderMesh, model, 5, glm::vec4(1.0f));
 	// ------------------- END Right Cylinder:--------------------------------- 
 
 	// ----- Start Left Tapered Cylinder: ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTaperedCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.2003f, 0.06f, 0.2f));
 	// 2. Rotate the object
@@ -883,24 +1524,15 @@ void URender()
 	translation = glm::translate(glm::vec3(-1.87f, 0.2f, 3.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
 
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 5);
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 72);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles with texture unit 5
+	if (gTessellation)
+		USubmitDraw(*gTaperedCylinderPatchMesh, model, 5, glm::vec4(1.0f), nullptr, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gTaperedCylinderMesh, model, 5, glm::vec4(1.0f));
 	// ------------------- END Left Tapered Cylinder:--------------------------------- 
 
 	// ----- Start Right Tapered Cylinder: ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTaperedCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.2003f, 0.06f, 0.2f));
 	// 2. Rotate the object
@@ -909,27 +1541,18 @@ void URender()
 	translation = glm::translate(glm::vec3(-1.74f, 0.2f, 3.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 5);
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 72);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
 
-	// Deactivate the Vertex Array Object
-	//glBindVertexArray(0);
+	// Draws the triangles with texture unit 5
+	if (gTessellation)
+		USubmitDraw(*gTaperedCylinderPatchMesh, model, 5, glm::vec4(1.0f), nullptr, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gTaperedCylinderMesh, model, 5, glm::vec4(1.0f));
 	// ------------------- END Right Tapered Cylinder:--------------------------------- 
 	
 
 
 	// COIN PURSE:
 	// // ------------------- START Left Pyramid:--------------------------------- 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPyramid4Mesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.8f, 1.8f, 0.2f));
 	// 2. Rotate the object
@@ -938,24 +1561,12 @@ void URender()
 	translation = glm::translate(glm::vec3(1.0f, 0.901f, 0.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-	ubHasTextureVal = true;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	// Point to the texture variable to texture unit 4 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 6);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPyramid4Mesh.nVertices);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles with texture unit 6
+	USubmitDraw(*gPyramid4Mesh, model, 6, glm::vec4(1.0f));
 	// ---------------------- END Left Pyramid -------------------------------------
 
 	// ----- Start Back Plane ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPlaneMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.8f, 0.8f, 0.83f));
 	// 2. Rotate the object
@@ -964,21 +1575,12 @@ void URender()
 	translation = glm::translate(glm::vec3(1.8f, 0.8f, -0.222f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
 
-
-	// Draws the triangles for the plane
-	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles for the plane with texture unit 6
+	USubmitDraw(*gPlaneMesh, model, 6, glm::vec4(1.0f));
 	// ----- End Back Plane ------
 
 	// ----- Start Front Plane ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPlaneMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.8f, 0.8f, 0.83f));
 	// 2. Rotate the object
@@ -987,24 +1589,12 @@ void URender()
 	translation = glm::translate(glm::vec3(1.8f, 0.8f, 0.226f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	ubHasTextureVal = true;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	// Point to the texture variable to texture unit 4 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
 
-	// Draws the triangles for the plane
-	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles for the plane with texture unit 2
+	USubmitDraw(*gPlaneMesh, model, 2, glm::vec4(1.0f));
 	// ----- End Front Plane ------
 
 	// ----- Start Top Cylinder: ------
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.155f, 1.6f, 0.06f));
 	// 2. Rotate the object
@@ -1013,27 +1603,15 @@ void URender()
 	translation = glm::translate(glm::vec3(2.59f, 1.679f, 0.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	ubHasTextureVal = true;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-	// Point to the texture variable to texture unit 4 before drawing the shape mesh
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 6);
-
-	// Point to the texture variable to texture unit 0 before drawing the shape mesh
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
 
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles with texture unit 6
+	if (gTessellation)
+		USubmitDraw(*gCylinderPatchMesh, model, 6, glm::vec4(1.0f), nullptr, CYLINDER_PATCH_SURFACES);
+	else
+		USubmitDraw(*gCylinderMesh, model, 6, glm::vec4(1.0f));
 	// ------------------- END Top Cylinder:--------------------------------- 
 
 	// ------------------- START Right Pyramid:--------------------------------- 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPyramid4Mesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.8f, 1.8f, 0.2f));
 	// 2. Rotate the object
@@ -1042,15 +1620,103 @@ void URender()
 	translation = glm::translate(glm::vec3(2.58f, 0.901f, 0.0f));
 	// Model matrix: transformations are applied right-to-left order
 	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPyramid4Mesh.nVertices);
 
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	// Draws the triangles with texture unit 6
+	USubmitDraw(*gPyramid4Mesh, model, 6, glm::vec4(1.0f));
 	// ---------------------- END Right Pyramid -------------------------------------
 
+	// ------------------- START Imported Meshes:---------------------------------
+	for (size_t i = 0; i < meshes.gImportedMeshes.size(); i++)
+	{
+		const Meshes::ImportedMesh& imported = meshes.gImportedMeshes[i];
+
+		// stand the mesh on the desk: bottom center at its slot, largest side IMPORT_SIZE
+		glm::vec3 extent = imported.boundsMax - imported.boundsMin;
+		float largest = std::max(extent.x, std::max(extent.y, extent.z));
+		glm::vec3 bottomCenter(0.5f * (imported.boundsMin.x + imported.boundsMax.x), imported.boundsMin.y, 0.5f * (imported.boundsMin.z + imported.boundsMax.z));
+		scale = glm::scale(glm::vec3(largest > 0.0f ? IMPORT_SIZE / largest : 1.0f));
+		translation = glm::translate(IMPORT_POSITION + glm::vec3(IMPORT_SPACING * i, 0.0f, 0.0f));
+		model = translation * scale * glm::translate(-bottomCenter);
+
+		// one draw per material
+		int lod = USelectLod(imported.mesh, model, view, projection);
+		for (int part = 0; part < imported.mesh.PartsPerLod(); part++)
+		{
+			int material = imported.materialIds[part];
+			const int nColors = int(sizeof(IMPORT_MATERIAL_COLORS) / sizeof(IMPORT_MATERIAL_COLORS[0]));
+			glm::vec4 color = material == MeshImport::NO_MATERIAL ? IMPORT_NO_MATERIAL_COLOR : IMPORT_MATERIAL_COLORS[material % nColors];
+			USubmitMeshPart(imported.mesh, model, color, part, lod);
+		}
+	}
+	// ------------------- END Imported Meshes:---------------------------------
+
+	// ------------------- START Streamed Meshes:---------------------------------
+	// stand the meshes on the desk like the imported ones; their objects are
+	// uploaded with the queue's, and drawn after it
+	GLuint streamMaterial = gFrameData.AddMaterial(STREAM_COLOR, false);
+	GLuint firstStreamObject = GLuint(gFrameData.objects.size());
+	for (size_t i = 0; i < meshes.gStreamedMeshes.size(); i++)
+	{
+		const MeshStream& stream = *meshes.gStreamedMeshes[i];
+		glm::vec3 extent = stream.boundsMax - stream.boundsMin;
+		float largest = std::max(extent.x, std::max(extent.y, extent.z));
+		glm::vec3 bottomCenter(0.5f * (stream.boundsMin.x + stream.boundsMax.x), stream.boundsMin.y, 0.5f * (stream.boundsMin.z + stream.boundsMax.z));
+		scale = glm::scale(glm::vec3(largest > 0.0f ? STREAM_SIZE / largest : 1.0f));
+		translation = glm::translate(STREAM_POSITION + glm::vec3(STREAM_SPACING * i, 0.0f, 0.0f));
+		gFrameData.AddObject(translation * scale * glm::translate(-bottomCenter), streamMaterial);
+	}
+
+	UDrawQueue(view, projection);
+
+	// streams always hold the float layout and may be open, so their inside can show
+	gGLState.Uniform1i(glGetUniformLocation(gProgramId, "ubOctNormals"), false);
+	USetFaceCulling(false);
+	for (size_t i = 0; i < meshes.gStreamedMeshes.size(); i++)
+	{
+		MeshStream& stream = *meshes.gStreamedMeshes[i];
+		GLuint object = firstStreamObject + GLuint(i);
+		gGLState.Uniform1i(glGetUniformLocation(gProgramId, "uObject"), GLint(object));
+
+		// the stream binds its own vertex array; unbind it, as gGLState left it
+		stream.Update(gFrameData.objects[object].model, view, projection, GLfloat(WINDOW_HEIGHT), LOD_PIXEL_ERROR);
+		stream.Draw();
+		glBindVertexArray(0);
+	}
+	gGLState.Uniform1i(glGetUniformLocation(gProgramId, "ubOctNormals"), meshes.vertexFormat == Meshes::VERTEX_PACKED);
+	// ------------------- END Streamed Meshes:---------------------------------
+
+	// cluster culling and draw statistics of this frame, shown in the window title
+	double now = glfwGetTime();
+	if (now - gLastStatsTime >= STATS_INTERVAL)
+	{
+		std::ostringstream title;
+		// instanced draws skip cluster culling
+		title << WINDOW_TITLE << " - clusters culled ";
+		if (gInstancing)
+			title << "n/a, triangles culled n/a";
+		else
+		{
+			title << gClusterStats.clustersCulled << "/" << gClusterStats.clusters
+				<< ", triangles culled " << gClusterStats.trianglesCulled << "/" << gClusterStats.triangles;
+		}
+		title << ", draws " << gDraws;
+		if (gInstancing)
+			title << " (instances " << gInstances.instances.size() << ")";
+		if (gIndirectDraws)
+			title << " (commands " << gDrawCommands.commands.size() << ")";
+		title << ", GL state calls dropped " << gGLState.stats.TotalDropped() << "/" << gGLState.stats.TotalCalls()
+			<< " (uniforms " << gGLState.stats.dropped[GLState::CALL_UNIFORM] << "/" << gGLState.stats.calls[GLState::CALL_UNIFORM] << ")";
+		RingBuffer::Stats ringStats = URingStats();
+		title << ", fence stalls " << ringStats.stalls << "/" << ringStats.claims << " (" << ringStats.stallMs << " ms)";
+		for (const std::unique_ptr<MeshStream>& stream : meshes.gStreamedMeshes)
+		{
+			title << ", streamed nodes " << stream->stats.nodesDrawn << " drawn/" << stream->stats.nodesResident
+				<< " resident/" << stream->SlotCount() << " slots";
+		}
+		glfwSetWindowTitle(gWindow, title.str().c_str());
+		gLastStatsTime = now;
+	}
+
 	// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 
 	
@@ -1058,6 +1724,527 @@ void URender()
 	glfwSwapBuffers(gWindow);    // Flips the the back buffer with the front buffer every frame.
 }
 
+// Picks the coarsest LOD of a mesh whose error, projected to the screen at the
+// distance of the object, stays within LOD_PIXEL_ERROR pixels
+int USelectLod(const Meshes::GLMesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection)
+{
+	// largest scale of the model matrix, the errors are in object space
+	float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+	// pixels per world unit: divided by the view depth for a perspective
+	// projection (w row = -z), constant for an orthographic one
+	float pixelsPerUnit = projection[1][1] * WINDOW_HEIGHT * 0.5f;
+	if (projection[3][3] == 0.0f)
+	{
+		glm::vec4 center = view * model[3];	// the object's origin
+		pixelsPerUnit /= glm::max(-center.z, LOD_MIN_DEPTH);
+	}
+
+	int lod = 0;
+	while (lod + 1 < mesh.LodCount() && mesh.lodErrors[lod + 1] * scale * pixelsPerUnit <= LOD_PIXEL_ERROR)
+		lod++;
+	return lod;
+}
+
+// Enables back-face culling for closed meshes and disables it for open ones
+// (the plane), whose inside can be seen
+void USetFaceCulling(const Meshes::GLMesh& mesh)
+{
+	USetFaceCulling(mesh.cullBackFaces);
+}
+
+void USetFaceCulling(bool closed)
+{
+	gGLState.SetEnabled(GL_CULL_FACE, gFaceCulling && closed);
+}
+
+// Draws all indices of a LOD of a mesh, once or for each of instances
+void UDrawMesh(const Meshes::GLMesh& mesh, int lod, const InstanceRange* instances)
+{
+	USetFaceCulling(mesh);
+
+	MeshGen::MeshPart range = UIndexRange(mesh, ALL_PARTS, lod);
+	UDrawElements(mesh, range.firstIndex, range.nIndices, instances);
+}
+
+// Draws one part (index range) of an indexed mesh, e.g. the cap or the sides of a cylinder
+void UDrawMeshPart(const Meshes::GLMesh& mesh, int part, int lod, const InstanceRange* instances)
+{
+	USetFaceCulling(mesh);
+
+	const MeshGen::MeshPart& range = mesh.Part(lod, part);
+	UDrawElements(mesh, range.firstIndex, range.nIndices, instances);
+}
+
+// Index range of a part of a LOD, or with ALL_PARTS of the whole LOD, whose
+// parts are consecutive
+MeshGen::MeshPart UIndexRange(const Meshes::GLMesh& mesh, int part, int lod)
+{
+	if (part != ALL_PARTS)
+		return mesh.Part(lod, part);
+
+	const MeshGen::MeshPart& first = mesh.Part(lod, 0);
+	const MeshGen::MeshPart& last = mesh.Part(lod, mesh.PartsPerLod() - 1);
+	return MeshGen::MeshPart{ first.firstIndex, last.firstIndex + last.nIndices - first.firstIndex };
+}
+
+// Draws an index range of a mesh; its ranges in the shared geometry heap are
+// addressed with the byte offset of its indices and its base vertex, and the
+// instances of an instanced draw in gInstances with the base instance
+void UDrawElements(const Meshes::GLMesh& mesh, GLuint firstIndex, GLuint nIndices, const InstanceRange* instances)
+{
+	size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	size_t offset = mesh.allocation.indexOffset + indexSize * firstIndex;
+	if (instances)
+	{
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, nIndices, mesh.indexType, (void*)offset,
+			instances->count, mesh.allocation.baseVertex, instances->first);
+	}
+	else
+		glDrawElementsBaseVertex(GL_TRIANGLES, nIndices, mesh.indexType, (void*)offset, mesh.allocation.baseVertex);
+}
+
+// Draws all parts of a LOD of a mesh with one call, each with its own material;
+// the fragment shader picks the material following the object's first one from
+// the triangle's part, counted from the start of each instance
+void UDrawMeshMaterials(const Meshes::GLMesh& mesh, int lod, const InstanceRange* instances)
+{
+	USetPartMaterials(mesh, lod);
+	UDrawMesh(mesh, lod, instances);
+	gGLState.Uniform1i(glGetUniformLocation(gProgramId, "uPartCount"), 0);
+}
+
+// Sets the triangle ranges of the parts of a LOD for the next draws of gProgramId,
+// until uPartCount is set back to 0
+void USetPartMaterials(const Meshes::GLMesh& mesh, int lod)
+{
+	GLint partEnd[MAX_MATERIAL_PARTS];
+
+	int nParts = std::min(mesh.PartsPerLod(), MAX_MATERIAL_PARTS);
+	GLuint nTriangles = 0;
+	for (int i = 0; i < nParts; i++)
+	{
+		nTriangles += mesh.Part(lod, i).nIndices / 3;
+		partEnd[i] = GLint(nTriangles);
+	}
+
+	gGLState.Uniform1i(glGetUniformLocation(gProgramId, "uPartCount"), nParts);
+	gGLState.Uniform1iv(glGetUniformLocation(gProgramId, "uPartEnd"), nParts, partEnd);
+}
+
+// Draws the clusters of the LOD picked by USelectLod that overlap the view
+// frustum and can face the camera; adjacent visible clusters are merged into
+// one index range and all ranges go out in a single multi-draw
+void UDrawMeshCulled(const Meshes::GLMesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection)
+{
+	int lod = USelectLod(mesh, model, view, projection);
+	if (!gClusterCulling || mesh.meshlets.empty())
+	{
+		UDrawMesh(mesh, lod);
+		return;
+	}
+
+	// the tests run in object space, where the cluster bounds are: the frustum planes
+	// come from the rows of the model-view-projection matrix, and the camera position
+	// (view direction for an orthographic projection) from the inverse model-view
+	glm::mat4 clip = projection * view * model;
+	glm::vec4 planes[6];
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+		glm::vec4 w(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+		planes[2 * i] = w + row;
+		planes[2 * i + 1] = w - row;
+	}
+	glm::mat4 objectFromView = glm::inverse(view * model);
+	glm::vec3 camera(objectFromView[3]);
+	glm::vec3 viewDirection = glm::normalize(glm::vec3(objectFromView * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+	bool orthographic = projection[3][3] != 0.0f;
+
+	const MeshGen::MeshPart& first = mesh.Part(lod, 0);
+	const MeshGen::MeshPart& last = mesh.Part(lod, mesh.PartsPerLod() - 1);
+	GLuint lodEnd = last.firstIndex + last.nIndices;
+
+	static std::vector<GLsizei> counts;
+	static std::vector<const void*> offsets;
+	static std::vector<GLint> baseVertices;
+	counts.clear();
+	offsets.clear();
+
+	size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	GLuint rangeEnd = 0;
+	auto meshlet = std::lower_bound(mesh.meshlets.begin(), mesh.meshlets.end(), first.firstIndex,
+		[](const MeshGen::Meshlet& m, GLuint index) { return m.firstIndex < index; });
+	for (; meshlet != mesh.meshlets.end() && meshlet->firstIndex < lodEnd; ++meshlet)
+	{
+		gClusterStats.clusters++;
+		gClusterStats.triangles += meshlet->nIndices / 3;
+		if (!UMeshletVisible(*meshlet, planes, camera, viewDirection, orthographic))
+		{
+			gClusterStats.clustersCulled++;
+			gClusterStats.trianglesCulled += meshlet->nIndices / 3;
+			continue;
+		}
+
+		if (!counts.empty() && rangeEnd == meshlet->firstIndex)
+			counts.back() += meshlet->nIndices;
+		else
+		{
+			counts.push_back(meshlet->nIndices);
+			offsets.push_back((const void*)(mesh.allocation.indexOffset + indexSize * meshlet->firstIndex));
+		}
+		rangeEnd = meshlet->firstIndex + meshlet->nIndices;
+	}
+
+	if (counts.empty())
+		return;
+	baseVertices.assign(counts.size(), mesh.allocation.baseVertex);
+	USetFaceCulling(mesh);
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), mesh.indexType, offsets.data(), GLsizei(counts.size()), baseVertices.data());
+}
+
+// A cluster is culled when its bounding sphere is fully outside a frustum plane,
+// or when its normal cone faces away from the camera so every triangle is a back face
+bool UMeshletVisible(const MeshGen::Meshlet& meshlet, const glm::vec4* planes, const glm::vec3& camera, const glm::vec3& viewDirection, bool orthographic)
+{
+	glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+	for (int i = 0; i < 6; i++)
+	{
+		glm::vec3 normal(planes[i]);
+		if (glm::dot(normal, center) + planes[i].w < -meshlet.radius * glm::length(normal))
+			return false;
+	}
+
+	glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+	if (orthographic)
+		return glm::dot(viewDirection, axis) < meshlet.coneCutoff;
+
+	glm::vec3 toCenter = center - camera;
+	return glm::dot(toCenter, axis) < meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
+
+// Draws the parts of a patch mesh as triangle patches with the tessellation program,
+// each on its surface and, when materials is not null, with the material of the
+// part following the object's first one. The program and the mesh's vertex array
+// are bound by UDrawQueue, which also selected the object and texture.
+void UDrawPatches(const Meshes::GLMesh& mesh, const PatchSurface* surfaces, const PartMaterial* materials)
+{
+	GLint surfaceLoc = glGetUniformLocation(gTessProgramId, "uSurface");
+	GLint materialOffsetLoc = glGetUniformLocation(gTessProgramId, "uMaterialOffset");
+
+	USetFaceCulling(mesh);	// the evaluation shader emits the patches' counterclockwise winding
+	size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	for (int part = 0; part < mesh.PartsPerLod(); part++)
+	{
+		gGLState.Uniform1i(surfaceLoc, surfaces[part]);
+		gGLState.Uniform1i(materialOffsetLoc, materials ? part : 0);
+
+		const MeshGen::MeshPart& range = mesh.Part(0, part);
+		size_t offset = mesh.allocation.indexOffset + indexSize * range.firstIndex;
+		glDrawElementsBaseVertex(GL_PATCHES, range.nIndices, mesh.indexType, (void*)offset, mesh.allocation.baseVertex);
+	}
+}
+
+// Adds a draw of a whole mesh to the frame: its culled LOD, or all its parts in one
+// call with materials, or its patches with surfaces. texture is the unit sampled by
+// the draw or by its textured parts, color the flat color of an untextured draw.
+void USubmitDraw(const Meshes::GLMesh& mesh, const glm::mat4& model, GLint texture, const glm::vec4& color, const PartMaterial* materials, const PatchSurface* surfaces)
+{
+	gDrawItems.push_back({ &mesh, model, texture, color, materials, surfaces, ALL_PARTS, 0, 0 });
+}
+
+// Adds a draw of one part of a LOD of a mesh in a flat color
+void USubmitMeshPart(const Meshes::GLMesh& mesh, const glm::mat4& model, const glm::vec4& color, int part, int lod)
+{
+	gDrawItems.push_back({ &mesh, model, NO_TEXTURE, color, nullptr, nullptr, part, lod, 0 });
+}
+
+// Starts the frame data of the draws: the camera and lights in the frame block,
+// and no objects or materials yet. UDrawQueue adds the objects of the queued draws
+// and uploads it all.
+void USetFrameData(const glm::mat4& view, const glm::mat4& projection)
+{
+	FrameData::FrameBlock& frame = gFrameData.frame;
+	frame.view = view;
+	frame.projection = projection;
+	frame.viewPosition = gCamera.Position;	//set the camera view location
+	frame.ambientStrength = 2.4f;	//set ambient lighting strength
+	frame.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);	//set ambient color
+	frame.light1Color = glm::vec3(0.8f, 0.7f, 0.6f);
+	frame.light1Position = glm::vec3(0.0f, 2.0f, 4.0f);
+	frame.specularIntensity1 = .6f;	//set specular intensity
+	frame.highlightSize1 = 12.0f;	//set specular highlight size
+	gFrameData.Clear();
+}
+
+// Draws with per part materials share them with the draws of the same materials
+// array; other textured draws share one material, the texture replacing its color
+MaterialKey UMaterialKey(const DrawItem& item)
+{
+	if (item.materials)
+		return { item.materials, false, glm::vec4(0.0f) };
+	if (item.texture != NO_TEXTURE)
+		return { nullptr, true, glm::vec4(0.0f) };
+	return { nullptr, false, item.color };
+}
+
+// Sorts the draws submitted this frame with gRenderQueue and executes them through
+// gGLState, so only the program, vertex array, texture unit and object that differ
+// from the previous draw are set. Draws with the same flat color or texture, or the
+// same per part materials, share a material id in the sort keys and its entries in
+// gFrameData, which is uploaded with an object per draw before the first one.
+void UDrawQueue(const glm::mat4& view, const glm::mat4& projection)
+{
+	// material id and first gFrameData entry of each material
+	static std::unordered_map<MaterialKey, std::pair<GLuint, GLuint>, MaterialKeyHash> materials;
+	materials.clear();
+
+	gRenderQueue.Clear();
+	for (size_t i = 0; i < gDrawItems.size(); i++)
+	{
+		DrawItem& item = gDrawItems[i];
+		auto inserted = materials.emplace(UMaterialKey(item), std::make_pair(GLuint(materials.size()), GLuint(gFrameData.materials.size())));
+		if (inserted.second)
+		{
+			// per part materials get an entry per part, in the order of the parts
+			if (item.materials)
+			{
+				for (int part = 0; part < std::min(item.mesh->PartsPerLod(), MAX_MATERIAL_PARTS); part++)
+					gFrameData.AddMaterial(item.materials[part].color, item.materials[part].hasTexture);
+			}
+			else
+				gFrameData.AddMaterial(item.color, item.texture != NO_TEXTURE);
+		}
+		GLuint material = inserted.first->second.first;
+		item.material = inserted.first->second.second;
+
+		RenderQueue::DrawState state;
+		state.program = item.surfaces ? 1 : 0;
+		state.vertexArray = item.mesh->vao;
+		state.texture = GLuint(item.texture + 1);
+		state.material = material;
+		state.depth = -(view * item.model[3]).z / FAR_PLANE;
+		if (!gRenderQueue.Submit(state))
+			break;
+	}
+	gRenderQueue.Sort();
+
+	static std::vector<DrawBatch> batches;
+	batches.clear();
+	if (gInstancing)
+	{
+		UGatherInstances(view, projection, batches);
+		if (gIndirectDraws)
+			UBuildCommands(batches);
+	}
+	else
+	{
+		for (GLuint i = 0; i < gRenderQueue.Size(); i++)
+		{
+			const DrawItem& item = gDrawItems[gRenderQueue.Item(i)];
+			batches.push_back({ &item, 0, gFrameData.AddObject(item.model, item.material), { 0, 0 } });
+		}
+	}
+	gFrameData.Upload();
+
+	GLuint program = 0;
+	GLint objectLoc = -1;
+	GLint textureLoc = -1;
+	GLint instancedLoc = -1;
+	for (const DrawBatch& batch : batches)
+	{
+		const DrawItem& item = *batch.item;
+		const InstanceRange* instances = batch.instances.count > 0 ? &batch.instances : nullptr;
+
+		GLuint itemProgram = item.surfaces ? gTessProgramId : gProgramId;
+		if (itemProgram != program)
+		{
+			program = itemProgram;
+			objectLoc = glGetUniformLocation(program, "uObject");
+			textureLoc = glGetUniformLocation(program, "uTexture");
+			instancedLoc = glGetUniformLocation(program, "ubInstanced");
+		}
+		gGLState.UseProgram(program);
+		gGLState.BindVertexArray(item.mesh->vao);
+		gGLState.Uniform1i(instancedLoc, instances != nullptr);
+
+		// flat colored draws leave the texture unit as it is, their material
+		// ignores it
+		if (item.texture != NO_TEXTURE)
+			gGLState.Uniform1i(textureLoc, item.texture);
+		if (instances)
+		{
+			if (batch.nCommands > 0)
+				UDrawIndirect(batch);
+			else if (item.materials)
+				UDrawMeshMaterials(*item.mesh, batch.lod, instances);
+			else if (item.part != ALL_PARTS)
+				UDrawMeshPart(*item.mesh, item.part, batch.lod, instances);
+			else
+				UDrawMesh(*item.mesh, batch.lod, instances);
+			gDraws++;
+			continue;
+		}
+
+		gGLState.Uniform1i(objectLoc, GLint(batch.object));
+		if (item.surfaces)
+			UDrawPatches(*item.mesh, item.surfaces, item.materials);
+		else if (item.materials)
+			UDrawMeshMaterials(*item.mesh, USelectLod(*item.mesh, item.model, view, projection));
+		else if (item.part != ALL_PARTS)
+			UDrawMeshPart(*item.mesh, item.part, item.lod);
+		else
+			UDrawMeshCulled(*item.mesh, item.model, view, projection);
+		gDraws++;
+	}
+
+	// the streamed meshes are drawn after the queue, with the uniforms of gProgramId
+	gGLState.UseProgram(gProgramId);
+	gGLState.Uniform1i(glGetUniformLocation(gProgramId, "ubInstanced"), false);
+	gGLState.BindVertexArray(0);
+	gDrawItems.clear();
+}
+
+// Gathers the sorted draws into batches for gInstancing: the draws of the same
+// mesh range (part and LOD) with the same texture or per part materials become
+// one group of instances, drawn where the first of them was sorted. Each draw
+// adds its object to gFrameData, which gInstances names group after group in
+// one upload. Patches are drawn one by one.
+void UGatherInstances(const glm::mat4& view, const glm::mat4& projection, std::vector<DrawBatch>& batches)
+{
+	typedef std::tuple<const Meshes::GLMesh*, int, int, GLint, const PartMaterial*> GroupKey;	// Mesh, part, LOD, texture, materials
+	static std::map<GroupKey, size_t> groups;		// Batch of each group
+	static std::vector<size_t> itemBatches;		// Batch of each sorted draw
+	groups.clear();
+	itemBatches.resize(gRenderQueue.Size());
+
+	for (GLuint i = 0; i < gRenderQueue.Size(); i++)
+	{
+		const DrawItem& item = gDrawItems[gRenderQueue.Item(i)];
+		if (item.surfaces)
+		{
+			batches.push_back({ &item, 0, gFrameData.AddObject(item.model, item.material), { 0, 0 } });
+			continue;
+		}
+
+		int lod = item.part != ALL_PARTS ? item.lod : USelectLod(*item.mesh, item.model, view, projection);
+		// most draws join a group, find it without creating a node
+		GroupKey key(item.mesh, item.part, lod, item.texture, item.materials);
+		auto group = groups.find(key);
+		if (group == groups.end())
+		{
+			gInstances.Attach(item.mesh->vao);
+			group = groups.emplace(key, batches.size()).first;
+			batches.push_back({ &item, lod, 0, { 0, 0 } });
+		}
+		itemBatches[i] = group->second;
+		batches[itemBatches[i]].instances.count++;
+	}
+
+	// the instances of a group are consecutive, counted again while writing them
+	GLuint nInstances = 0;
+	for (DrawBatch& batch : batches)
+	{
+		batch.instances.first = nInstances;
+		nInstances += batch.instances.count;
+		batch.instances.count = 0;
+	}
+
+	gInstances.instances.resize(nInstances);
+	for (GLuint i = 0; i < gRenderQueue.Size(); i++)
+	{
+		const DrawItem& item = gDrawItems[gRenderQueue.Item(i)];
+		if (item.surfaces)
+			continue;
+
+		InstanceRange& range = batches[itemBatches[i]].instances;
+		gInstances.instances[range.first + range.count++].object = gFrameData.AddObject(item.model, item.material);
+	}
+	gInstances.Upload();
+}
+
+// Turns the instanced draws into the commands of gDrawCommands for gIndirectDraws.
+// The batches are ordered by the GL state instancing leaves to them (vertex array,
+// index type, face culling, texture, and per part materials with the mesh and LOD
+// they are set for); those sharing it become one batch drawing consecutive
+// commands. The order of the render queue only holds between these states.
+void UBuildCommands(std::vector<DrawBatch>& batches)
+{
+	typedef std::tuple<bool, GLuint, GLenum, bool, GLint, const PartMaterial*, const Meshes::GLMesh*, int> StateKey;
+	auto stateKey = [](const DrawBatch& batch)
+	{
+		const DrawItem& item = *batch.item;
+		bool materials = item.materials != nullptr;
+		return StateKey(item.surfaces != nullptr, item.mesh->vao, item.mesh->indexType, item.mesh->cullBackFaces,
+			item.texture, item.materials, materials ? item.mesh : nullptr, materials ? batch.lod : 0);
+	};
+	std::stable_sort(batches.begin(), batches.end(), [&stateKey](const DrawBatch& a, const DrawBatch& b)
+	{
+		return stateKey(a) < stateKey(b);
+	});
+
+	// patches keep their single draws
+	gDrawCommands.commands.clear();
+	size_t nMerged = 0;
+	for (const DrawBatch& batch : batches)
+	{
+		if (batch.instances.count == 0)
+		{
+			batches[nMerged++] = batch;
+			continue;
+		}
+
+		const Meshes::GLMesh& mesh = *batch.item->mesh;
+		MeshGen::MeshPart range = UIndexRange(mesh, batch.item->part, batch.lod);
+		GLuint indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		gDrawCommands.commands.push_back({ range.nIndices, batch.instances.count, mesh.allocation.indexOffset / indexSize + range.firstIndex,
+			mesh.allocation.baseVertex, batch.instances.first });
+
+		DrawBatch* previous = nMerged > 0 ? &batches[nMerged - 1] : nullptr;
+		if (previous && previous->nCommands > 0 && stateKey(*previous) == stateKey(batch))
+			previous->nCommands++;
+		else
+		{
+			batches[nMerged] = batch;
+			batches[nMerged].firstCommand = GLuint(gDrawCommands.commands.size() - 1);
+			batches[nMerged].nCommands = 1;
+			nMerged++;
+		}
+	}
+	batches.resize(nMerged);
+	gDrawCommands.Upload();
+}
+
+// Sums the fence waits of the ring buffers the frame data, instances and draw
+// commands are written to; a stall is a claim of a region the GPU still read
+RingBuffer::Stats URingStats()
+{
+	const RingBuffer* rings[] = { &gFrameData.Ring(), &gInstances.Ring(), &gDrawCommands.Ring() };
+	RingBuffer::Stats total = {};
+	for (const RingBuffer* ring : rings)
+	{
+		total.claims += ring->stats.claims;
+		total.stalls += ring->stats.stalls;
+		total.stallMs += ring->stats.stallMs;
+	}
+	return total;
+}
+
+// Draws the commands of a batch built by UBuildCommands in one call, with the
+// state of its first draw
+void UDrawIndirect(const DrawBatch& batch)
+{
+	const Meshes::GLMesh& mesh = *batch.item->mesh;
+	USetFaceCulling(mesh);
+	if (batch.item->materials)
+		USetPartMaterials(mesh, batch.lod);
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, gDrawCommands.Offset(batch.firstCommand), GLsizei(batch.nCommands), 0);
+
+	if (batch.item->materials)
+		gGLState.Uniform1i(glGetUniformLocation(gProgramId, "uPartCount"), 0);
+}
+
 /*Generate and load the texture*/
 bool UCreateTexture(const char* filename, GLuint& textureId)
 {
@@ -1105,46 +2292,173 @@ void UDestroyTexture(GLuint textureId)
 	glGenTextures(1, &textureId);
 }
 
-// Implements the UCreateShaders function
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId)
+// Imports an OBJ or glTF file and writes its cluster hierarchy to a stream file;
+// the source mesh is held in memory here only, --stream then pages the file
+bool UBuildStream(const char* sourceFilename, const char* streamFilename)
 {
-	// Compilation and linkage error reporting
-	int success = 0;
-	char infoLog[512];
+	MeshGen::MeshData data;
+	std::vector<int> materialIds;
+	MeshImport::Stats importStats;
+	if (!MeshImport::UImport(sourceFilename, data, materialIds, importStats))
+		return false;
 
-	// Create a Shader program object.
-	programId = glCreateProgram();
+	MeshStream::BuildStats stats;
+	if (!MeshStream::UBuild(data, streamFilename, stats))
+	{
+		cout << "ERROR: Could not write mesh stream " << streamFilename << endl;
+		return false;
+	}
 
-	// Create the vertex and fragment shader objects
-	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	cout << "INFO: Mesh stream " << streamFilename << ": " << importStats.nTriangles << " triangles, "
+		<< stats.nNodes << " nodes (" << stats.nLeaves << " leaves, " << stats.nEmpty << " empty), depth " << stats.depth
+		<< ", " << stats.bytes << " bytes, built in " << stats.milliseconds << " ms" << endl;
+	return true;
+}
 
-	// Retrive the shader source
-	glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
-	glShaderSource(fragmentShaderId, 1, &fragShaderSource, NULL);
+// Generates every case of COMPUTE_VERIFY_CASES with the compute shader, reads it back
+// and compares it with the CPU generator; positions, texture coords and indices must
+// match, normals are the exact ones of the surface and only close to the CPU's
+bool UVerifyCompute()
+{
+	MeshCompute compute;
+	if (!compute.Create())
+		return false;
 
-	// Compile the vertex shader, and print compilation errors (if any)
-	glCompileShader(vertexShaderId); // compile the vertex shader
-	// check for shader compile errors
-	glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
-	if (!success)
+	bool verified = true;
+	for (const ComputeCase& test : COMPUTE_VERIFY_CASES)
 	{
-		glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+		for (bool packed : { false, true })
+		{
+			MeshCompute::VerifyStats stats;
+			bool matched = compute.Verify(test.shape, test.params, packed, stats);
+			verified = verified && matched;
+			cout << (matched ? "INFO" : "ERROR") << ": Compute " << (test.shape == MeshCompute::SHAPE_TORUS ? "torus" : "sphere")
+				<< " " << test.params[0] << "x" << test.params[1] << (packed ? " packed" : " float")
+				<< ": position error " << stats.positionError << ", normals within " << stats.normalDegrees
+				<< " degrees, uv error " << stats.uvError << ", " << stats.indexMismatches << " index mismatches" << endl;
+		}
+	}
+	compute.Destroy();
+	return verified;
+}
 
-		return false;
+// Submits DRAW_BENCHMARK_OBJECTS small closed meshes on a grid filling the view,
+// each textured or in one of a few colors, through every draw path: single draws,
+// instancing and indirect draws. Reports the time UDrawQueue takes on the CPU to
+// sort and submit them, and until the GPU finished drawing them. Cluster culling,
+// which only single draws do, is off so every path draws the same triangles.
+void UBenchDraws()
+{
+	const Meshes::GLMesh* benchMeshes[] = { gBoxMesh, gPyramid4Mesh, gCylinderMesh, gSmallCylinderMesh };
+	const int nMeshes = int(sizeof(benchMeshes) / sizeof(benchMeshes[0]));
+	const glm::vec4 colors[] = { glm::vec4(0.8f, 0.2f, 0.2f, 1.0f), glm::vec4(0.2f, 0.8f, 0.2f, 1.0f), glm::vec4(0.2f, 0.2f, 0.8f, 1.0f) };
+	const int nColors = int(sizeof(colors) / sizeof(colors[0]));
+	const GLint nTextures = 7;
+	const float gridSize = 12.0f;
+
+	struct DrawPath
+	{
+		const char* name;
+		bool instancing;
+		bool indirect;
+	};
+	const DrawPath paths[] = { { "single draws", false, false }, { "instancing", true, false }, { "indirect draws", true, true } };
+	bool instancing = gInstancing;
+	bool indirect = gIndirectDraws;
+	bool clusterCulling = gClusterCulling;
+	gClusterCulling = false;
+
+	glm::mat4 view = gCamera.GetViewMatrix();
+	glm::mat4 projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, FAR_PLANE);
+	gGLState.SetEnabled(GL_DEPTH_TEST, true);
+
+	for (GLuint nObjects : DRAW_BENCHMARK_OBJECTS)
+	{
+		GLuint side = GLuint(std::ceil(std::sqrt(double(nObjects))));
+		float spacing = gridSize / side;
+		for (const DrawPath& path : paths)
+		{
+			gInstancing = path.instancing;
+			gIndirectDraws = path.indirect;
+
+			double submitMs = 0.0;
+			double frameMs = 0.0;
+			for (int frame = 0; frame < DRAW_BENCHMARK_FRAMES; frame++)
+			{
+				gDraws = 0;
+				gGLState.ResetStats();
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				USetFrameData(view, projection);
+
+				for (GLuint i = 0; i < nObjects; i++)
+				{
+					glm::vec3 position((i % side) * spacing - 0.5f * gridSize, (i / side) * spacing - 0.5f * gridSize + 1.0f, 0.0f);
+					glm::mat4 model = glm::translate(position) * glm::scale(glm::vec3(0.4f * spacing));
+					GLint texture = i % 2 == 0 ? GLint(i / 2 % nTextures) : NO_TEXTURE;
+					USubmitDraw(*benchMeshes[i % nMeshes], model, texture, colors[i % nColors]);
+				}
+
+				auto start = std::chrono::steady_clock::now();
+				UDrawQueue(view, projection);
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				glFinish();
+				double finishedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				submitMs = frame == 0 ? ms : std::min(submitMs, ms);
+				frameMs = frame == 0 ? finishedMs : std::min(frameMs, finishedMs);
+			}
+
+			cout << "INFO: Draw benchmark, " << nObjects << " objects, " << path.name << ": " << gDraws << " draws, "
+				<< gGLState.stats.TotalCalls() - gGLState.stats.TotalDropped() << " state calls, submitted in " << submitMs
+				<< " ms (" << nObjects / submitMs / 1000.0 << " million objects/s), drawn in " << frameMs << " ms" << endl;
+		}
 	}
 
-	glCompileShader(fragmentShaderId); // compile the fragment shader
-	// check for shader compile errors
-	glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &success);
+	gInstancing = instancing;
+	gIndirectDraws = indirect;
+	gClusterCulling = clusterCulling;
+}
+
+// Compiles one shader stage from count source strings, printing the compilation errors (if any)
+bool UCompileShader(GLenum type, GLsizei count, const char* const* sources, const char* stage, GLuint& shaderId)
+{
+	int success = 0;
+	char infoLog[512];
+
+	shaderId = glCreateShader(type);
+	glShaderSource(shaderId, count, sources, NULL);
+	glCompileShader(shaderId);
+	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
 	if (!success)
 	{
-		glGetShaderInfoLog(fragmentShaderId, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+		glGetShaderInfoLog(shaderId, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::SHADER::" << stage << "::COMPILATION_FAILED\n" << infoLog << std::endl;
 
 		return false;
 	}
+	return true;
+}
+
+// Implements the UCreateShaders function; with sharedSource, both stages are
+// compiled after it, and it starts with the version line instead of them
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId, const char* sharedSource)
+{
+	// Compilation and linkage error reporting
+	int success = 0;
+	char infoLog[512];
+
+	// Create a Shader program object.
+	programId = glCreateProgram();
+
+	// Create and compile the vertex and fragment shader objects
+	GLuint vertexShaderId;
+	GLuint fragmentShaderId;
+	const char* vertexSources[] = { sharedSource, vtxShaderSource };
+	const char* fragmentSources[] = { sharedSource, fragShaderSource };
+	GLsizei skipped = sharedSource ? 0 : 1;
+	if (!UCompileShader(GL_VERTEX_SHADER, 2 - skipped, vertexSources + skipped, "VERTEX", vertexShaderId))
+		return false;
+	if (!UCompileShader(GL_FRAGMENT_SHADER, 2 - skipped, fragmentSources + skipped, "FRAGMENT", fragmentShaderId))
+		return false;
 
 	// Attached compiled shaders to the shader program
 	glAttachShader(programId, vertexShaderId);
@@ -1166,6 +2480,54 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	return true;
 }
 
+// Same as UCreateShaderProgram with tessellation control and evaluation stages
+// between the vertex and fragment shaders; the program draws GL_PATCHES. The
+// vertex shader is compiled alone, the other stages after sharedSource, which
+// starts with the version line, and both tessellation stages after
+// tessSurfaceShaderSource, which holds the surface functions they share.
+bool UCreateTessShaderProgram(const char* vtxShaderSource, const char* tessSurfaceShaderSource, const char* tessControlShaderSource, const char* tessEvalShaderSource, const char* fragShaderSource, GLuint& programId, const char* sharedSource)
+{
+	int success = 0;
+	char infoLog[512];
+
+	programId = glCreateProgram();
+
+	GLuint vertexShaderId;
+	GLuint tessControlShaderId;
+	GLuint tessEvalShaderId;
+	GLuint fragmentShaderId;
+	if (!UCompileShader(GL_VERTEX_SHADER, 1, &vtxShaderSource, "VERTEX", vertexShaderId))
+		return false;
+	const char* tessControlSources[] = { sharedSource, tessSurfaceShaderSource, tessControlShaderSource };
+	const char* tessEvalSources[] = { sharedSource, tessSurfaceShaderSource, tessEvalShaderSource };
+	const char* fragmentSources[] = { sharedSource, fragShaderSource };
+	if (!UCompileShader(GL_TESS_CONTROL_SHADER, 3, tessControlSources, "TESS_CONTROL", tessControlShaderId))
+		return false;
+	if (!UCompileShader(GL_TESS_EVALUATION_SHADER, 3, tessEvalSources, "TESS_EVALUATION", tessEvalShaderId))
+		return false;
+	if (!UCompileShader(GL_FRAGMENT_SHADER, 2, fragmentSources, "FRAGMENT", fragmentShaderId))
+		return false;
+
+	glAttachShader(programId, vertexShaderId);
+	glAttachShader(programId, tessControlShaderId);
+	glAttachShader(programId, tessEvalShaderId);
+	glAttachShader(programId, fragmentShaderId);
+
+	glLinkProgram(programId);
+	glGetProgramiv(programId, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+
+		return false;
+	}
+
+	glUseProgram(programId);
+
+	return true;
+}
+
 
 void UDestroyShaderProgram(GLuint programId)
 {
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// framedata.cpp
+// ========
+// shader data of a frame in buffer blocks: the camera and lights in a std140
+// uniform block, and the drawn objects and their materials in std430
+// storage blocks, all written to one region of a persistently mapped ring
+// buffer in a single pass
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framedata.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+static_assert(offsetof(FrameData::FrameBlock, viewPosition) == 128 && offsetof(FrameData::FrameBlock, light1Position) == 176
+	&& sizeof(FrameData::FrameBlock) == 192, "FrameBlock does not match its std140 layout");
+static_assert(offsetof(FrameData::Object, normalMatrix) == 64 && offsetof(FrameData::Object, material) == 112
+	&& sizeof(FrameData::Object) == 128, "Object does not match its std430 layout");
+static_assert(offsetof(FrameData::Material, hasTexture) == 16 && sizeof(FrameData::Material) == 32,
+	"Material does not match its std430 layout");
+
+namespace
+{
+	GLsizeiptr UAlign(GLsizeiptr offset, GLint alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+}
+
+///////////////////////////////////////////////////
+//	AddObject(const glm::mat4&, GLuint)
+//
+//	model: model matrix of the object
+//	material: index of its (first) material
+//
+//	Add an object drawn this frame and return its
+//	index, the one the draws select it with
+///////////////////////////////////////////////////
+GLuint FrameData::AddObject(const glm::mat4& model, GLuint material)
+{
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+	Object object = {};
+	object.model = model;
+	for (int column = 0; column < 3; column++)
+		object.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+	object.material = GLint(material);
+	objects.push_back(object);
+	return GLuint(objects.size() - 1);
+}
+
+GLuint FrameData::AddMaterial(const glm::vec4& color, bool hasTexture)
+{
+	Material material = {};
+	material.color = color;
+	material.hasTexture = hasTexture;
+	materials.push_back(material);
+	return GLuint(materials.size() - 1);
+}
+
+// Forget the objects and materials of the last frame
+void FrameData::Clear()
+{
+	objects.clear();
+	materials.clear();
+}
+
+///////////////////////////////////////////////////
+//	Upload()
+//
+//	Write the frame block, the objects and the
+//	materials to the frame's region of the ring
+//	buffer and bind each range to its binding
+//	point. The regions of the last frames stay
+//	untouched while their draws may read them.
+///////////////////////////////////////////////////
+void FrameData::Upload()
+{
+	if (uniformAlignment == 0)
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		ring.Align(uniformAlignment);
+		ring.Align(storageAlignment);
+	}
+
+	// storage ranges cannot be empty
+	GLsizeiptr objectBytes = GLsizeiptr(std::max<size_t>(objects.size(), 1) * sizeof(Object));
+	GLsizeiptr materialBytes = GLsizeiptr(std::max<size_t>(materials.size(), 1) * sizeof(Material));
+	GLsizeiptr objectOffset = UAlign(sizeof(FrameBlock), storageAlignment);
+	GLsizeiptr materialOffset = UAlign(objectOffset + objectBytes, storageAlignment);
+	GLsizeiptr bytes = materialOffset + materialBytes;
+
+	// the ring's regions start at multiples of both alignments
+	unsigned char* data = static_cast<unsigned char*>(ring.Claim(bytes));
+	std::memcpy(data, &frame, sizeof(FrameBlock));
+	std::memcpy(data + objectOffset, objects.data(), objects.size() * sizeof(Object));
+	std::memcpy(data + materialOffset, materials.data(), materials.size() * sizeof(Material));
+
+	GLintptr offset = ring.Offset();
+	glBindBufferRange(GL_UNIFORM_BUFFER, BINDING_FRAME, ring.Buffer(), offset, sizeof(FrameBlock));
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BINDING_OBJECTS, ring.Buffer(), offset + objectOffset, objectBytes);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BINDING_MATERIALS, ring.Buffer(), offset + materialOffset, materialBytes);
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Delete the ring buffer of the blocks
+///////////////////////////////////////////////////
+void FrameData::Destroy()
+{
+	ring.Destroy();
+	Clear();
+}
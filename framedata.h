@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// framedata.h
+// ========
+// shader data of a frame in buffer blocks: the camera and lights in a std140
+// uniform block, and the drawn objects and their materials in std430
+// storage blocks, all written to one region of a persistently mapped ring
+// buffer in a single pass
+//
+// The structs below mirror the GLSL declarations of the blocks member by
+// member (see sceneDataShaderSource in Source.cpp). A draw selects its object
+// by index; the object holds its model and normal matrices and the index of
+// its first material, one material per part for draws with per part
+// materials.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "ringbuffer.h"
+
+class FrameData
+{
+
+public:
+
+	// Binding points of the blocks
+	enum Binding
+	{
+		BINDING_FRAME = 0,		// Uniform block
+		BINDING_OBJECTS = 1,	// Storage blocks
+		BINDING_MATERIALS = 2
+	};
+
+	// std140 FrameBlock: each vec3 shares its 16 bytes with the float after it
+	struct FrameBlock
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 viewPosition;
+		float ambientStrength;
+		glm::vec3 ambientColor;
+		float specularIntensity1;
+		glm::vec3 light1Color;
+		float highlightSize1;
+		glm::vec3 light1Position;
+		float pad;
+	};
+
+	// std430 Object: the columns of the mat3 are 16 byte aligned
+	struct Object
+	{
+		glm::mat4 model;
+		glm::vec4 normalMatrix[3];	// Inverse transpose of the model's upper 3x3
+		GLint material;
+		GLint pad[3];
+	};
+
+	// std430 Material
+	struct Material
+	{
+		glm::vec4 color;	// Flat color without a texture
+		GLint hasTexture;	// The draw's texture replaces color
+		GLint pad[3];
+	};
+
+	FrameBlock frame = {};
+	std::vector<Object> objects;
+	std::vector<Material> materials;
+
+public:
+	GLuint AddObject(const glm::mat4 &model, GLuint material);
+	GLuint AddMaterial(const glm::vec4 &color, bool hasTexture);
+	void Clear();
+	void Upload();
+	void Destroy();
+
+	const RingBuffer& Ring() const { return ring; }
+
+private:
+	RingBuffer ring;
+	GLint uniformAlignment = 0;		// Offset alignments of the block ranges, 0 until queried
+	GLint storageAlignment = 0;
+};
@@ -0,0 +1,247 @@
+///////////////////////////////////////////////////////////////////////////////
+// geometryheap.cpp
+// ========
+// one shared vertex buffer and index buffer with a suballocator, so meshes
+// are offset/count records into the heap instead of their own GL objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "geometryheap.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	// Index ranges start on a 4 byte boundary so both index types are aligned
+	const GLuint INDEX_ALIGNMENT = 4;
+
+	GLuint UAlignIndexBytes(GLuint bytes)
+	{
+		return (bytes + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Create(GLsizei, GLuint, GLuint)
+//
+//	vertexStride: size of one vertex in bytes
+//	vertexCapacity: initial number of vertices
+//	indexCapacity: initial index buffer size in bytes
+//
+//	Create the shared vertex and index buffers
+///////////////////////////////////////////////////
+void GeometryHeap::Create(GLsizei vertexStride, GLuint vertexCapacity, GLuint indexCapacity)
+{
+	stride = vertexStride;
+	indexCapacity = UAlignIndexBytes(indexCapacity);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(stride) * vertexCapacity, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &ibo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+	glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	vertexBlocks.Reset(vertexCapacity);
+	indexBlocks.Reset(indexCapacity);
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Delete the shared buffers. Vertex arrays created
+//	with CreateVertexArray() belong to the caller.
+///////////////////////////////////////////////////
+void GeometryHeap::Destroy()
+{
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	vertexBlocks.Reset(0);
+	indexBlocks.Reset(0);
+}
+
+///////////////////////////////////////////////////
+//	CreateVertexArray(GLuint)
+//
+//	binding: vertex buffer binding index of the VAO
+//
+//	Create a VAO with the heap's index buffer and its
+//	vertex buffer attached to binding with the heap's
+//	stride. The VAO is left bound, so the caller can
+//	set up its attribute formats next.
+///////////////////////////////////////////////////
+GLuint GeometryHeap::CreateVertexArray(GLuint binding)
+{
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glBindVertexBuffer(binding, vbo, 0, stride);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	return vao;
+}
+
+///////////////////////////////////////////////////
+//	Allocate(GLuint, GLuint)
+//
+//	nVertices: number of vertices to reserve
+//	indexBytes: size of the index range to reserve
+//
+//	Reserve a vertex and an index range, growing the
+//	buffers when no free block is large enough
+///////////////////////////////////////////////////
+GeometryHeap::Allocation GeometryHeap::Allocate(GLuint nVertices, GLuint indexBytes)
+{
+	Allocation allocation;
+	allocation.nVertices = nVertices;
+	allocation.indexBytes = indexBytes;
+	indexBytes = UAlignIndexBytes(indexBytes);
+
+	GLuint vertexOffset;
+	while (!vertexBlocks.Allocate(nVertices, vertexOffset))
+	{
+		GLuint capacity = std::max(vertexBlocks.capacity * 2, vertexBlocks.capacity + nVertices);
+		UGrowBuffer(vbo, vertexBlocks.capacity * stride, capacity * stride);
+		vertexBlocks.Grow(capacity);
+	}
+	allocation.baseVertex = GLint(vertexOffset);
+
+	while (!indexBlocks.Allocate(indexBytes, allocation.indexOffset))
+	{
+		GLuint capacity = std::max(indexBlocks.capacity * 2, indexBlocks.capacity + indexBytes);
+		UGrowBuffer(ibo, indexBlocks.capacity, capacity);
+		indexBlocks.Grow(capacity);
+	}
+
+	return allocation;
+}
+
+///////////////////////////////////////////////////
+//	Free(const Allocation&)
+//
+//	Return an allocation's ranges to the free lists
+///////////////////////////////////////////////////
+void GeometryHeap::Free(const Allocation& allocation)
+{
+	vertexBlocks.Free(GLuint(allocation.baseVertex), allocation.nVertices);
+	indexBlocks.Free(allocation.indexOffset, UAlignIndexBytes(allocation.indexBytes));
+}
+
+void GeometryHeap::UploadVertices(const Allocation& allocation, const void* vertices)
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(allocation.baseVertex) * stride, GLsizeiptr(allocation.nVertices) * stride, vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryHeap::UploadIndices(const Allocation& allocation, const void* indices)
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, allocation.indexBytes, indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+///////////////////////////////////////////////////
+//	UGrowBuffer(GLuint, GLuint, GLuint)
+//
+//	Resize a buffer in place, keeping its contents and its
+//	name so the VAOs referencing it stay valid
+///////////////////////////////////////////////////
+void GeometryHeap::UGrowBuffer(GLuint buffer, GLuint oldBytes, GLuint newBytes)
+{
+	std::cout << "INFO: Geometry heap buffer " << buffer << " grows from " << oldBytes << " to " << newBytes << " bytes" << std::endl;
+
+	GLuint copy;
+	glGenBuffers(1, &copy);
+
+	// save the contents, reallocate the storage and copy them back
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, copy);
+	glBufferData(GL_COPY_WRITE_BUFFER, oldBytes, nullptr, GL_STREAM_COPY);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, copy);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &copy);
+}
+
+void GeometryHeap::FreeList::Reset(GLuint size)
+{
+	blocks.clear();
+	if (size > 0)
+		blocks[0] = size;
+	capacity = size;
+	used = 0;
+}
+
+bool GeometryHeap::FreeList::Allocate(GLuint size, GLuint& offset)
+{
+	if (size == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	for (auto block = blocks.begin(); block != blocks.end(); ++block)
+	{
+		if (block->second < size)
+			continue;
+
+		// carve the range from the front of the first block that fits
+		offset = block->first;
+		GLuint remaining = block->second - size;
+		blocks.erase(block);
+		if (remaining > 0)
+			blocks[offset + size] = remaining;
+
+		used += size;
+		return true;
+	}
+	return false;
+}
+
+void GeometryHeap::FreeList::Free(GLuint offset, GLuint size)
+{
+	if (size == 0)
+		return;
+
+	used -= size;
+	auto block = blocks.emplace(offset, size).first;
+
+	// merge with the following block
+	auto next = std::next(block);
+	if (next != blocks.end() && block->first + block->second == next->first)
+	{
+		block->second += next->second;
+		blocks.erase(next);
+	}
+
+	// merge with the preceding block
+	if (block != blocks.begin())
+	{
+		auto previous = std::prev(block);
+		if (previous->first + previous->second == block->first)
+		{
+			previous->second += block->second;
+			blocks.erase(block);
+		}
+	}
+}
+
+void GeometryHeap::FreeList::Grow(GLuint size)
+{
+	// the new space is one free block at the end, merged with a trailing free block
+	GLuint added = size - capacity;
+	GLuint oldCapacity = capacity;
+	capacity = size;
+	used += added;
+	Free(oldCapacity, added);
+}
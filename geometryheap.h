@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// geometryheap.h
+// ========
+// one shared vertex buffer and index buffer with a suballocator, so meshes
+// are offset/count records into the heap instead of their own GL objects
+//
+// Vertices are allocated in whole vertices of a fixed stride and drawn with
+// a base vertex; indices are allocated in bytes (4 byte aligned) so 16 and
+// 32 bit index ranges can share the index buffer.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <map>
+
+class GeometryHeap
+{
+
+public:
+
+	// Location of one mesh inside the heap
+	struct Allocation
+	{
+		GLint baseVertex;		// First vertex, added to every index when drawing
+		GLuint nVertices;		// Number of vertices reserved
+		GLuint indexOffset;		// Byte offset of the first index in the index buffer
+		GLuint indexBytes;		// Size of the index range in bytes (reserved rounded up to 4)
+	};
+
+	GLuint vbo;		// Shared vertex buffer
+	GLuint ibo;		// Shared index buffer
+
+public:
+	void Create(GLsizei vertexStride, GLuint vertexCapacity, GLuint indexCapacity);
+	void Destroy();
+
+	GLuint CreateVertexArray(GLuint binding);
+	Allocation Allocate(GLuint nVertices, GLuint indexBytes);
+	void Free(const Allocation &allocation);
+	void UploadVertices(const Allocation &allocation, const void *vertices);
+	void UploadIndices(const Allocation &allocation, const void *indices);
+
+	GLsizei Stride() const { return stride; }
+	GLuint VerticesUsed() const { return vertexBlocks.used; }
+	GLuint IndexBytesUsed() const { return indexBlocks.used; }
+
+private:
+
+	// First-fit free list over [0, capacity) with coalescing on free
+	struct FreeList
+	{
+		std::map<GLuint, GLuint> blocks;	// Free blocks: offset -> size
+		GLuint capacity;
+		GLuint used;
+
+		void Reset(GLuint size);
+		bool Allocate(GLuint size, GLuint &offset);
+		void Free(GLuint offset, GLuint size);
+		void Grow(GLuint size);
+	};
+
+	GLsizei stride;
+	FreeList vertexBlocks;
+	FreeList indexBlocks;
+
+	void UGrowBuffer(GLuint buffer, GLuint oldBytes, GLuint newBytes);
+};
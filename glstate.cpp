@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstate.cpp
+// ========
+// thin state cache between the renderer and GL: shadows the bound program,
+// vertex array, textures, enabled capabilities, clear color and uniform
+// values, and drops the calls that would not change them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "glstate.h"
+
+#include <cstring>
+
+///////////////////////////////////////////////////
+//	TotalCalls() / TotalDropped()
+//
+//	Calls of every kind made through the cache, and
+//	how many of them never reached GL.
+///////////////////////////////////////////////////
+GLuint GLState::Stats::TotalCalls() const
+{
+	GLuint total = 0;
+	for (GLuint count : calls)
+		total += count;
+	return total;
+}
+
+GLuint GLState::Stats::TotalDropped() const
+{
+	GLuint total = 0;
+	for (GLuint count : dropped)
+		total += count;
+	return total;
+}
+
+///////////////////////////////////////////////////
+//	UseProgram(GLuint) / BindVertexArray(GLuint)
+//
+//	glUseProgram and glBindVertexArray, skipped when
+//	the object is already bound.
+///////////////////////////////////////////////////
+void GLState::UseProgram(GLuint program)
+{
+	if (!UChanged(CALL_PROGRAM, program != this->program))
+		return;
+
+	glUseProgram(program);
+	this->program = program;
+}
+
+void GLState::BindVertexArray(GLuint vertexArray)
+{
+	if (!UChanged(CALL_VERTEX_ARRAY, vertexArray != this->vertexArray))
+		return;
+
+	glBindVertexArray(vertexArray);
+	this->vertexArray = vertexArray;
+}
+
+///////////////////////////////////////////////////
+//	BindTexture(GLuint, GLenum, GLuint)
+//
+//	unit: texture unit, 0 for GL_TEXTURE0
+//	target: texture target, GL_TEXTURE_2D...
+//	texture: texture bound to the target of the unit
+//
+//	Bind a texture to a unit. The active unit only
+//	changes when the binding does.
+///////////////////////////////////////////////////
+void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	auto binding = textures.find(std::make_pair(unit, target));
+	if (!UChanged(CALL_TEXTURE, binding == textures.end() || binding->second != texture))
+		return;
+
+	if (UChanged(CALL_TEXTURE, unit != activeUnit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+	}
+	glBindTexture(target, texture);
+	textures[std::make_pair(unit, target)] = texture;
+}
+
+///////////////////////////////////////////////////
+//	SetEnabled(GLenum, bool)
+//
+//	capability: GL_DEPTH_TEST, GL_CULL_FACE...
+//	enabled: glEnable when true, glDisable when false
+///////////////////////////////////////////////////
+void GLState::SetEnabled(GLenum capability, bool enabled)
+{
+	auto known = capabilities.find(capability);
+	if (!UChanged(CALL_CAPABILITY, known == capabilities.end() || known->second != enabled))
+		return;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+	capabilities[capability] = enabled;
+}
+
+void GLState::ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	const GLfloat color[4] = { red, green, blue, alpha };
+	if (!UChanged(CALL_CAPABILITY, !clearColorKnown || std::memcmp(color, clearColor, sizeof(color)) != 0))
+		return;
+
+	glClearColor(red, green, blue, alpha);
+	std::memcpy(clearColor, color, sizeof(color));
+	clearColorKnown = true;
+}
+
+///////////////////////////////////////////////////
+//	Uniform*(GLint, ...)
+//
+//	location: uniform location in the current
+//	program; -1 is ignored like GL does
+//
+//	glUniform* on the program of the last
+//	UseProgram(), skipped when the location already
+//	holds the same value.
+///////////////////////////////////////////////////
+void GLState::Uniform1i(GLint location, GLint value)
+{
+	if (UUniformChanged(location, &value, sizeof(value)))
+		glUniform1i(location, value);
+}
+
+void GLState::Uniform1iv(GLint location, GLsizei count, const GLint *values)
+{
+	if (UUniformChanged(location, values, count * sizeof(GLint)))
+		glUniform1iv(location, count, values);
+}
+
+void GLState::Uniform1f(GLint location, GLfloat value)
+{
+	if (UUniformChanged(location, &value, sizeof(value)))
+		glUniform1f(location, value);
+}
+
+void GLState::Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+	const GLfloat value[3] = { x, y, z };
+	if (UUniformChanged(location, value, sizeof(value)))
+		glUniform3f(location, x, y, z);
+}
+
+void GLState::Uniform4fv(GLint location, GLsizei count, const GLfloat *values)
+{
+	if (UUniformChanged(location, values, count * 4 * sizeof(GLfloat)))
+		glUniform4fv(location, count, values);
+}
+
+void GLState::UniformMatrix4fv(GLint location, const GLfloat *value)
+{
+	if (UUniformChanged(location, value, 16 * sizeof(GLfloat)))
+		glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
+
+///////////////////////////////////////////////////
+//	Invalidate()
+//
+//	Forget all the shadowed state, after GL state
+//	was changed without the cache: the next call of
+//	each kind is made.
+///////////////////////////////////////////////////
+void GLState::Invalidate()
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	textures.clear();
+	capabilities.clear();
+	clearColorKnown = false;
+	uniforms.clear();
+}
+
+///////////////////////////////////////////////////
+//	InvalidateUniforms(GLuint)
+//
+//	program: program whose uniforms were set without
+//	the cache (glProgramUniform*, relinking)
+///////////////////////////////////////////////////
+void GLState::InvalidateUniforms(GLuint program)
+{
+	for (auto uniform = uniforms.begin(); uniform != uniforms.end();)
+	{
+		if (GLuint(uniform->first >> 32) == program)
+			uniform = uniforms.erase(uniform);
+		else
+			++uniform;
+	}
+}
+
+// Count a call of a kind, and whether it was dropped; returns changed
+bool GLState::UChanged(CallKind kind, bool changed)
+{
+	stats.calls[kind]++;
+	if (!changed)
+		stats.dropped[kind]++;
+	return changed;
+}
+
+// Compare a uniform value with the one last set at its location, keeping it
+// when it differs. Uniforms the program does not use (location -1) are skipped
+// without being counted: GL would ignore them anyway.
+bool GLState::UUniformChanged(GLint location, const void *data, size_t bytes)
+{
+	if (location < 0)
+		return false;
+
+	std::vector<unsigned char> &shadow = uniforms[(uint64_t(program) << 32) | GLuint(location)];
+	const unsigned char *value = static_cast<const unsigned char *>(data);
+	if (!UChanged(CALL_UNIFORM, shadow.size() != bytes || std::memcmp(shadow.data(), value, bytes) != 0))
+		return false;
+
+	shadow.assign(value, value + bytes);
+	return true;
+}
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstate.h
+// ========
+// thin state cache between the renderer and GL: shadows the bound program,
+// vertex array, textures, enabled capabilities, clear color and uniform
+// values, and drops the calls that would not change them
+//
+// Until a value went through the cache it is unknown and the first call is
+// always made. Code that changes the same state directly must put it back as
+// it found it (as Meshes and MeshStream do with their bindings) or tell the
+// cache with Invalidate()/InvalidateUniforms(). Uniform arrays are shadowed
+// as a whole at the location of their first element.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class GLState
+{
+
+public:
+
+	// Kinds of calls counted in Stats
+	enum CallKind
+	{
+		CALL_PROGRAM,
+		CALL_VERTEX_ARRAY,
+		CALL_TEXTURE,		// Active texture unit and texture bindings
+		CALL_CAPABILITY,	// glEnable / glDisable and the clear color
+		CALL_UNIFORM,
+		CALL_KINDS
+	};
+
+	// Calls made through the cache since ResetStats(), and those dropped
+	struct Stats
+	{
+		GLuint calls[CALL_KINDS];
+		GLuint dropped[CALL_KINDS];
+
+		GLuint TotalCalls() const;
+		GLuint TotalDropped() const;
+	};
+
+	Stats stats = {};
+
+public:
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vertexArray);
+	void BindTexture(GLuint unit, GLenum target, GLuint texture);
+	void SetEnabled(GLenum capability, bool enabled);
+	void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+
+	// Uniforms of the current program
+	void Uniform1i(GLint location, GLint value);
+	void Uniform1iv(GLint location, GLsizei count, const GLint *values);
+	void Uniform1f(GLint location, GLfloat value);
+	void Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z);
+	void Uniform4fv(GLint location, GLsizei count, const GLfloat *values);
+	void UniformMatrix4fv(GLint location, const GLfloat *value);
+
+	GLuint Program() const { return program; }
+
+	void Invalidate();
+	void InvalidateUniforms(GLuint program);
+	void ResetStats() { stats = {}; }
+
+private:
+	static const GLuint UNKNOWN = ~0u;
+
+	bool UChanged(CallKind kind, bool changed);
+	bool UUniformChanged(GLint location, const void *data, size_t bytes);
+
+	GLuint program = UNKNOWN;
+	GLuint vertexArray = UNKNOWN;
+	GLuint activeUnit = UNKNOWN;
+	std::map<std::pair<GLuint, GLenum>, GLuint> textures;	// (unit, target) -> texture
+	std::map<GLenum, bool> capabilities;
+	GLfloat clearColor[4];
+	bool clearColorKnown = false;
+
+	// Last value set at each (program, location), as raw bytes
+	std::unordered_map<uint64_t, std::vector<unsigned char>> uniforms;
+};
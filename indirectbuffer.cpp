@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// indirectbuffer.cpp
+// ========
+// indexed draw commands of a frame in a GL_DRAW_INDIRECT_BUFFER, so any
+// number of draws sharing their GL state go out in one
+// glMultiDrawElementsIndirect; the commands are written per frame to a
+// persistently mapped ring buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "indirectbuffer.h"
+
+#include <cstring>
+
+static_assert(sizeof(IndirectBuffer::Command) == 5 * sizeof(GLuint), "indirect commands are five tightly packed integers");
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Delete the command buffer
+///////////////////////////////////////////////////
+void IndirectBuffer::Destroy()
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	ring.Destroy();
+	commands.clear();
+}
+
+///////////////////////////////////////////////////
+//	Upload()
+//
+//	Write the frame's commands to the next region of
+//	the ring buffer and leave it bound to
+//	GL_DRAW_INDIRECT_BUFFER for the draws, which
+//	address the region with Offset().
+///////////////////////////////////////////////////
+void IndirectBuffer::Upload()
+{
+	if (commands.empty())
+		return;
+
+	GLsizeiptr bytes = GLsizeiptr(commands.size() * sizeof(Command));
+	std::memcpy(ring.Claim(bytes), commands.data(), size_t(bytes));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ring.Buffer());
+}
@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// indirectbuffer.h
+// ========
+// indexed draw commands of a frame in a GL_DRAW_INDIRECT_BUFFER, so any
+// number of draws sharing their GL state go out in one
+// glMultiDrawElementsIndirect; the commands are written per frame to a
+// persistently mapped ring buffer
+//
+// The commands address the shared geometry heap: the first index counts
+// indices from the start of the index buffer, and the base instance selects
+// the draw's instances in the InstanceBuffer, which name their objects.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "ringbuffer.h"
+
+class IndirectBuffer
+{
+
+public:
+
+	// Layout of one command read by glMultiDrawElementsIndirect
+	struct Command
+	{
+		GLuint count;			// Indices
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// Commands of the current frame, filled by the caller before Upload()
+	std::vector<Command> commands;
+
+public:
+	void Destroy();
+	void Upload();
+
+	// Byte offset of an uploaded command, the indirect argument of the draw
+	const void* Offset(GLuint command) const { return (const void*)(ring.Offset() + sizeof(Command) * command); }
+
+	const RingBuffer& Ring() const { return ring; }
+
+private:
+	RingBuffer ring;
+};
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancebuffer.cpp
+// ========
+// per instance attribute of the instanced draws: the object every copy of a
+// mesh draws, written per frame to a persistently mapped ring buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "instancebuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Delete the instance buffer. The vertex arrays it
+//	was attached to belong to their creator.
+///////////////////////////////////////////////////
+void InstanceBuffer::Destroy()
+{
+	ring.Destroy();
+	attached.clear();
+	instances.clear();
+}
+
+///////////////////////////////////////////////////
+//	Attach(GLuint)
+//
+//	vertexArray: VAO drawn with instances
+//
+//	Add the instance attribute to a VAO, once per
+//	VAO, reading binding with a divisor of 1; the
+//	next Upload() points binding at the instances.
+//	Leaves no VAO bound, like the mesh VAOs are left
+//	after their creation.
+///////////////////////////////////////////////////
+void InstanceBuffer::Attach(GLuint vertexArray)
+{
+	if (std::find(attached.begin(), attached.end(), vertexArray) != attached.end())
+		return;
+
+	glBindVertexArray(vertexArray);
+	glVertexBindingDivisor(binding, 1);
+	Layout::USetup(binding);
+	glBindVertexArray(0);
+	attached.push_back(vertexArray);
+}
+
+///////////////////////////////////////////////////
+//	Upload()
+//
+//	Write the frame's instances to the next region
+//	of the ring buffer and point the attached VAOs
+//	at it. Leaves no VAO bound.
+///////////////////////////////////////////////////
+void InstanceBuffer::Upload()
+{
+	if (instances.empty())
+		return;
+
+	GLsizeiptr bytes = GLsizeiptr(instances.size()) * Layout::stride;
+	std::memcpy(ring.Claim(bytes), instances.data(), size_t(bytes));
+	for (GLuint vertexArray : attached)
+	{
+		glBindVertexArray(vertexArray);
+		glBindVertexBuffer(binding, ring.Buffer(), ring.Offset(), Layout::stride);
+	}
+	glBindVertexArray(0);
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancebuffer.h
+// ========
+// per instance attribute of the instanced draws: the object every copy of a
+// mesh draws, written per frame to a persistently mapped ring buffer
+//
+// The attribute is read from its own vertex buffer binding with a divisor of
+// 1, next to the mesh vertices of the VAO, which is pointed at the frame's
+// region of the ring on every upload. Each instanced draw selects its
+// instances in the region with its base instance, so all the groups of a
+// frame share one write; the model and material of an instance live with
+// its object in the frame's storage blocks (see framedata.h).
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "ringbuffer.h"
+#include "vertexlayout.h"
+
+class InstanceBuffer
+{
+
+public:
+
+	// Attribute of one instance
+	struct Instance
+	{
+		GLuint object;		// Index of the instance's object in the frame data
+	};
+
+	// Shader input location of the instance attribute, after the vertex ones
+	enum AttributeLocation
+	{
+		ATTRIBUTE_OBJECT = 3
+	};
+
+	typedef VertexLayout<Instance,
+		VertexIntegerAttribute<ATTRIBUTE_OBJECT, GL_UNSIGNED_INT, 1, offsetof(Instance, object)>> Layout;
+
+	// Vertex buffer binding of the instances; the mesh vertices use 0
+	static const GLuint binding = 1;
+
+	// Instances of the current frame, filled by the caller before Upload()
+	std::vector<Instance> instances;
+
+public:
+	void Destroy();
+	void Attach(GLuint vertexArray);
+	void Upload();
+
+	const RingBuffer& Ring() const { return ring; }
+
+private:
+	RingBuffer ring;
+	std::vector<GLuint> attached;	// Vertex arrays reading the instances
+};
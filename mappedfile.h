@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ========
+// read-only memory mapped file (CreateFileMapping on Windows, mmap elsewhere)
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+class MappedFile
+{
+
+public:
+	const unsigned char *data = nullptr;	// Start of the mapped file, null when not open
+	size_t size = 0;						// File size in bytes
+
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char *filename);
+	void Close();
+
+private:
+#ifdef _WIN32
+	void *file = nullptr;		// HANDLE of the file
+	void *mapping = nullptr;	// HANDLE of the file mapping
+#endif
+};
@@ -0,0 +1,357 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.cpp
+// ========
+// versioned binary cache of the final, GPU ready vertex and index data of
+// each mesh, memory mapped at startup
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshcache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	// Bump whenever the file layout or the data the meshes pipeline produces changes
+	const uint32_t MESH_CACHE_VERSION = 5;
+	const char MESH_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'C' };
+
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t nEntries;
+		uint32_t reserved;
+	};
+
+	// One table entry per mesh; its data follows the table at offset:
+	// vertices, indices, parts, LOD errors and meshlets, each starting on a 4 byte boundary
+	struct FileEntry
+	{
+		uint64_t hash;
+		char name[32];
+		uint64_t offset;
+		uint32_t nVertices;
+		uint32_t vertexBytes;
+		uint32_t nIndices;
+		uint32_t indexBytes;
+		uint32_t indexType;
+		uint32_t normalizedUVs;
+		uint32_t nParts;
+		uint32_t nLods;
+		uint32_t nMeshlets;
+		uint32_t closed;
+	};
+
+	uint64_t UAlign4(uint64_t value)
+	{
+		return (value + 3) & ~uint64_t(3);
+	}
+
+	uint64_t UFnv1a(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	template <typename Index>
+	bool UValidIndices(const void* indices, GLuint nIndices, GLuint nVertices)
+	{
+		const Index* index = static_cast<const Index*>(indices);
+		return std::all_of(index, index + nIndices, [nVertices](Index vertex) { return vertex < nVertices; });
+	}
+
+	// The data of a mapped entry is what its counts say: whole vertices of
+	// vertexStride, indices of its type into its vertices, and parts and
+	// meshlets within its indices
+	bool UValidImage(const MeshCache::MeshImage& image, GLuint vertexStride)
+	{
+		if (uint64_t(image.nVertices) * vertexStride != image.vertexBytes)
+			return false;
+
+		if (image.indexType == GL_UNSIGNED_SHORT)
+		{
+			if (uint64_t(image.nIndices) * sizeof(GLushort) != image.indexBytes || !UValidIndices<GLushort>(image.indices, image.nIndices, image.nVertices))
+				return false;
+		}
+		else if (image.indexType == GL_UNSIGNED_INT)
+		{
+			if (uint64_t(image.nIndices) * sizeof(GLuint) != image.indexBytes || !UValidIndices<GLuint>(image.indices, image.nIndices, image.nVertices))
+				return false;
+		}
+		else
+			return false;
+
+		for (GLuint p = 0; p < image.nParts; p++)
+		{
+			if (uint64_t(image.parts[p].firstIndex) + image.parts[p].nIndices > image.nIndices)
+				return false;
+		}
+		for (GLuint m = 0; m < image.nMeshlets; m++)
+		{
+			if (uint64_t(image.meshlets[m].firstIndex) + image.meshlets[m].nIndices > image.nIndices)
+				return false;
+		}
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Open(const char*)
+//
+//	filename: cache file to map, created by Close()
+//		when it does not exist yet
+//
+//	Map the cache file. Returns false (every lookup
+//	misses) when the file is missing, damaged or was
+//	written by another version.
+///////////////////////////////////////////////////
+bool MeshCache::Open(const char* filename)
+{
+	path = filename;
+	entries.clear();
+	hits = 0;
+	misses = 0;
+
+	if (!file.Open(filename))
+		return false;
+
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(file.data);
+	if (file.size < sizeof(FileHeader) || std::memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0
+		|| header->version != MESH_CACHE_VERSION
+		|| file.size < sizeof(FileHeader) + sizeof(FileEntry) * uint64_t(header->nEntries))
+	{
+		std::cout << "INFO: Mesh cache " << path << " is out of date and will be rebuilt" << std::endl;
+		file.Close();
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Find(const Key&, GLuint, MeshImage&)
+//
+//	key: mesh to look up
+//	vertexStride: bytes per vertex of the cached meshes
+//	image: receives pointers into the mapped file
+//
+//	Look up a mesh and count the hit or miss. A damaged
+//	entry is a miss. The image stays valid until Close().
+///////////////////////////////////////////////////
+bool MeshCache::Find(const Key& key, GLuint vertexStride, MeshImage& image)
+{
+	if (file.data)
+	{
+		const FileHeader* header = reinterpret_cast<const FileHeader*>(file.data);
+		const FileEntry* table = reinterpret_cast<const FileEntry*>(file.data + sizeof(FileHeader));
+
+		for (uint32_t i = 0; i < header->nEntries; i++)
+		{
+			const FileEntry& entry = table[i];
+			if (entry.hash != key.hash)
+				continue;
+
+			uint64_t indexOffset = UAlign4(entry.offset + entry.vertexBytes);
+			uint64_t partOffset = UAlign4(indexOffset + entry.indexBytes);
+			uint64_t lodOffset = partOffset + sizeof(MeshGen::MeshPart) * uint64_t(entry.nParts);
+			uint64_t meshletOffset = lodOffset + sizeof(float) * uint64_t(entry.nLods);
+			if (entry.offset % 4 != 0 || meshletOffset + sizeof(MeshGen::Meshlet) * uint64_t(entry.nMeshlets) > file.size)
+				break;	// truncated file, treat as a miss
+
+			image.vertices = file.data + entry.offset;
+			image.vertexBytes = entry.vertexBytes;
+			image.nVertices = entry.nVertices;
+			image.indices = file.data + indexOffset;
+			image.indexBytes = entry.indexBytes;
+			image.nIndices = entry.nIndices;
+			image.indexType = entry.indexType;
+			image.normalizedUVs = entry.normalizedUVs != 0;
+			image.closed = entry.closed != 0;
+			image.parts = reinterpret_cast<const MeshGen::MeshPart*>(file.data + partOffset);
+			image.nParts = entry.nParts;
+			image.lodErrors = reinterpret_cast<const float*>(file.data + lodOffset);
+			image.nLods = entry.nLods;
+			image.meshlets = reinterpret_cast<const MeshGen::Meshlet*>(file.data + meshletOffset);
+			image.nMeshlets = entry.nMeshlets;
+			if (!UValidImage(image, vertexStride))
+				break;
+
+			// keep the entry for the rewrite in case another mesh misses
+			if (!UHasEntry(key.hash))
+			{
+				Entry used;
+				used.hash = key.hash;
+				used.name = key.name;
+				used.image = image;
+				entries.push_back(used);
+			}
+
+			hits++;
+			return true;
+		}
+	}
+
+	std::cout << "INFO: Mesh cache miss: " << key.name << std::endl;
+	misses++;
+	return false;
+}
+
+///////////////////////////////////////////////////
+//	Store(const Key&, const MeshImage&)
+//
+//	key: mesh that missed
+//	image: its final data, copied
+//
+//	Add a generated mesh to be written by Close(), once
+//	even when it is generated again
+///////////////////////////////////////////////////
+void MeshCache::Store(const Key& key, const MeshImage& image)
+{
+	if (UHasEntry(key.hash))
+		return;
+
+	Entry entry;
+	entry.hash = key.hash;
+	entry.name = key.name;
+	entry.image = image;
+
+	const unsigned char* vertices = static_cast<const unsigned char*>(image.vertices);
+	const unsigned char* indices = static_cast<const unsigned char*>(image.indices);
+	entry.vertices.assign(vertices, vertices + image.vertexBytes);
+	entry.indices.assign(indices, indices + image.indexBytes);
+	entry.parts.assign(image.parts, image.parts + image.nParts);
+	entry.lodErrors.assign(image.lodErrors, image.lodErrors + image.nLods);
+	entry.meshlets.assign(image.meshlets, image.meshlets + image.nMeshlets);
+
+	entries.push_back(std::move(entry));
+}
+
+///////////////////////////////////////////////////
+//	Close()
+//
+//	Report hits and misses, rewrite the file when any
+//	mesh missed and unmap it
+///////////////////////////////////////////////////
+void MeshCache::Close()
+{
+	std::cout << "INFO: Mesh cache " << path << ": " << hits << " hits, " << misses << " misses" << std::endl;
+
+	if (misses > 0)
+	{
+		// copy the meshes found in the mapping before it goes away
+		for (Entry& entry : entries)
+		{
+			if (!entry.vertices.empty() || !entry.indices.empty())
+				continue;
+
+			const unsigned char* vertices = static_cast<const unsigned char*>(entry.image.vertices);
+			const unsigned char* indices = static_cast<const unsigned char*>(entry.image.indices);
+			entry.vertices.assign(vertices, vertices + entry.image.vertexBytes);
+			entry.indices.assign(indices, indices + entry.image.indexBytes);
+			entry.parts.assign(entry.image.parts, entry.image.parts + entry.image.nParts);
+			entry.lodErrors.assign(entry.image.lodErrors, entry.image.lodErrors + entry.image.nLods);
+			entry.meshlets.assign(entry.image.meshlets, entry.image.meshlets + entry.image.nMeshlets);
+		}
+		file.Close();
+
+		if (!UWriteFile())
+			std::cout << "ERROR: Could not write mesh cache " << path << std::endl;
+	}
+
+	file.Close();
+	entries.clear();
+}
+
+///////////////////////////////////////////////////
+//	UMakeKey(const char*, const std::vector<float>&)
+//
+//	name: mesh name, must outlive the key
+//	params: generator and pipeline parameters
+//
+//	Hash the name and parameters into a cache key
+///////////////////////////////////////////////////
+MeshCache::Key MeshCache::UMakeKey(const char* name, const std::vector<float>& params)
+{
+	Key key;
+	key.name = name;
+	key.hash = UFnv1a(14695981039346656037ull, name, std::strlen(name) + 1);
+	key.hash = UFnv1a(key.hash, params.data(), sizeof(float) * params.size());
+	return key;
+}
+
+// A mesh is written once, however often it was looked up or generated this run
+bool MeshCache::UHasEntry(uint64_t hash) const
+{
+	for (const Entry& entry : entries)
+	{
+		if (entry.hash == hash)
+			return true;
+	}
+	return false;
+}
+
+bool MeshCache::UWriteFile()
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	FileHeader header = {};
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.nEntries = uint32_t(entries.size());
+
+	// lay out the data behind the entry table
+	std::vector<FileEntry> table(entries.size());
+	uint64_t offset = sizeof(FileHeader) + sizeof(FileEntry) * table.size();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const Entry& entry = entries[i];
+		FileEntry& fileEntry = table[i];
+		std::memset(&fileEntry, 0, sizeof(fileEntry));
+		fileEntry.hash = entry.hash;
+		std::memcpy(fileEntry.name, entry.name.c_str(), std::min(entry.name.size(), sizeof(fileEntry.name) - 1));
+		fileEntry.offset = offset;
+		fileEntry.nVertices = entry.image.nVertices;
+		fileEntry.vertexBytes = uint32_t(entry.vertices.size());
+		fileEntry.nIndices = entry.image.nIndices;
+		fileEntry.indexBytes = uint32_t(entry.indices.size());
+		fileEntry.indexType = entry.image.indexType;
+		fileEntry.normalizedUVs = entry.image.normalizedUVs ? 1 : 0;
+		fileEntry.closed = entry.image.closed ? 1 : 0;
+		fileEntry.nParts = uint32_t(entry.parts.size());
+		fileEntry.nLods = uint32_t(entry.lodErrors.size());
+		fileEntry.nMeshlets = uint32_t(entry.meshlets.size());
+
+		offset = UAlign4(offset + fileEntry.vertexBytes);
+		offset = UAlign4(offset + fileEntry.indexBytes);
+		offset += sizeof(MeshGen::MeshPart) * fileEntry.nParts;
+		offset += sizeof(float) * fileEntry.nLods;
+		offset += sizeof(MeshGen::Meshlet) * fileEntry.nMeshlets;
+	}
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(table.data()), sizeof(FileEntry) * table.size());
+
+	const char padding[4] = {};
+	for (const Entry& entry : entries)
+	{
+		out.write(reinterpret_cast<const char*>(entry.vertices.data()), entry.vertices.size());
+		out.write(padding, UAlign4(entry.vertices.size()) - entry.vertices.size());
+		out.write(reinterpret_cast<const char*>(entry.indices.data()), entry.indices.size());
+		out.write(padding, UAlign4(entry.indices.size()) - entry.indices.size());
+		out.write(reinterpret_cast<const char*>(entry.parts.data()), sizeof(MeshGen::MeshPart) * entry.parts.size());
+		out.write(reinterpret_cast<const char*>(entry.lodErrors.data()), sizeof(float) * entry.lodErrors.size());
+		out.write(reinterpret_cast<const char*>(entry.meshlets.data()), sizeof(MeshGen::Meshlet) * entry.meshlets.size());
+	}
+
+	out.close();
+	return !out.fail();
+}
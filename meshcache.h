@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.h
+// ========
+// versioned binary cache of the final, GPU ready vertex and index data of
+// each mesh, memory mapped at startup so cached meshes are uploaded without
+// generating or post-processing them
+//
+// Meshes are looked up by a key hashed from their name and the parameters
+// that produced them; a changed parameter or file version is a miss and the
+// file is rewritten with the meshes used this run.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+#include "meshgen.h"
+
+class MeshCache
+{
+
+public:
+
+	// Identifies one mesh: its name and a hash of everything that produced it
+	struct Key
+	{
+		const char *name;
+		uint64_t hash;
+	};
+
+	// GPU ready data of one mesh; the pointers refer to the mapped
+	// file (found meshes) or to memory owned by the caller (stored meshes)
+	struct MeshImage
+	{
+		const void *vertices;
+		GLuint vertexBytes;
+		GLuint nVertices;
+		const void *indices;
+		GLuint indexBytes;
+		GLuint nIndices;
+		GLenum indexType;
+		bool normalizedUVs;		// Packed layout only: texture coords are normalized shorts
+		const MeshGen::MeshPart *parts;
+		GLuint nParts;
+		const float *lodErrors;
+		GLuint nLods;			// Entries in lodErrors, 0 without LODs
+		const MeshGen::Meshlet *meshlets;
+		GLuint nMeshlets;
+		bool closed;			// Back faces can be culled
+	};
+
+public:
+	bool Open(const char *filename);
+	bool Find(const Key &key, GLuint vertexStride, MeshImage &image);
+	void Store(const Key &key, const MeshImage &image);
+	void Close();
+
+	static Key UMakeKey(const char *name, const std::vector<float> &params);
+
+private:
+
+	// A mesh written back to the file by Close()
+	struct Entry
+	{
+		uint64_t hash;
+		std::string name;
+		MeshImage image;
+		std::vector<unsigned char> vertices;	// Copies, the mapping is gone when the file is written
+		std::vector<unsigned char> indices;
+		std::vector<MeshGen::MeshPart> parts;
+		std::vector<float> lodErrors;
+		std::vector<MeshGen::Meshlet> meshlets;
+	};
+
+	std::string path;
+	MappedFile file;
+	std::vector<Entry> entries;		// Meshes used this run
+	GLuint hits;
+	GLuint misses;
+
+	bool UHasEntry(uint64_t hash) const;
+	bool UWriteFile();
+};
@@ -0,0 +1,475 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcompute.cpp
+// ========
+// parametric primitives generated by a compute shader straight into GPU
+// buffers: no CPU generation and no upload copy
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshcompute.h"
+#include "meshgen.h"
+#include "meshopt.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/*Shader program Macro*/
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version " core \n" #Source
+#endif
+
+namespace
+{
+	// Invocations per work group, must match local_size_x
+	const GLuint GROUP_SIZE = 64;
+
+	// Verify(): largest accepted differences from the CPU generator. The CPU
+	// normals are averaged over the triangles around a vertex (or flat past
+	// the crease angle on coarse shapes), the shader's are exact, so they may
+	// differ by up to a segment's angle.
+	const float VERIFY_POSITION_TOLERANCE = 1e-4f;
+	const float VERIFY_HALF_TOLERANCE = 1e-3f;		// Relative, half float positions
+	const float VERIFY_NORMAL_DEGREES = 10.0f;		// At least, else the segment angle
+	const float VERIFY_UV_TOLERANCE = 2.0f / 65535.0f;
+
+	const GLchar* generateShaderSource = GLSL(440,
+	layout(local_size_x = 64) in;
+
+	// The shared vertex and index buffers, as words
+	layout(std430, binding = 0) writeonly buffer VertexBuffer { uint vertexWords[]; };
+	layout(std430, binding = 1) writeonly buffer IndexBuffer { uint indexWords[]; };
+
+	uniform int uShape;				// MeshCompute::Shape
+	uniform vec4 uParams;			// Generator parameters, clamped like MeshGen
+	uniform bool uIndexPass;		// Write the indices instead of the vertices
+	uniform bool uPacked;			// Packed vertex layout
+	uniform bool uShortIndices;		// 16 bit indices, two to a word
+	uniform uint uFirstWord;		// First word of the mesh's vertices or indices
+	uniform uint uCount;			// Vertices or index words to write
+	uniform uint uIndexCount;
+
+	const float PI = 3.14159265358979323846;
+	const float TWO_PI = 6.28318530717958647692;
+
+	// Vertex v of MeshGen::UGenerateTorus
+	void torusVertex(int v, out vec3 position, out vec3 normal, out vec2 uv)
+	{
+		int mainSegments = int(uParams.x);
+		int tubeSegments = int(uParams.y);
+		int i = v / (tubeSegments + 1);
+		int j = v % (tubeSegments + 1);
+
+		// the last row and column wrap to angle zero, as on the CPU
+		float mainAngle = TWO_PI * float(i % mainSegments) / float(mainSegments);
+		float tubeAngle = TWO_PI * float(j % tubeSegments) / float(tubeSegments);
+		float ring = uParams.z + uParams.w * cos(tubeAngle);
+		position = vec3(ring * cos(mainAngle), ring * sin(mainAngle), uParams.w * sin(tubeAngle));
+		normal = vec3(cos(tubeAngle) * cos(mainAngle), cos(tubeAngle) * sin(mainAngle), sin(tubeAngle));
+		uv = vec2(float(i) / float(mainSegments), float(j) / float(tubeSegments));
+	}
+
+	// Vertex v of MeshGen::UGenerateSphere (MeshTables::ULayoutSphere)
+	void sphereVertex(int v, out vec3 position, out vec3 normal, out vec2 uv)
+	{
+		int slices = int(uParams.x);
+		int stacks = int(uParams.y);
+		int s = v / (slices + 1);
+		int i = v % (slices + 1);
+
+		float phi = PI * float(s) / float(stacks);
+		float sinPhi = s == 0 || s == stacks ? 0.0 : sin(phi);	// exact poles
+		float theta = TWO_PI * float(i % slices) / float(slices);
+		normal = vec3(sinPhi * cos(theta), cos(phi), sinPhi * sin(theta));
+		position = normal * uParams.z;
+		uv = vec2(float(i) / float(slices), 1.0 - float(s) / float(stacks));
+	}
+
+	// Index n of MeshGen::UGenerateTorus: two triangles per quad
+	uint torusIndex(int n)
+	{
+		int tubeSegments = int(uParams.y);
+		int quad = n / 6;
+		int a = (quad / tubeSegments) * (tubeSegments + 1) + quad % tubeSegments;
+		int b = a + tubeSegments + 1;
+		int corners[6] = int[6](a, b, a + 1, b, b + 1, a + 1);
+		return uint(corners[n % 6]);
+	}
+
+	// Index n of MeshGen::UGenerateSphere: the pole rows have one triangle per quad
+	uint sphereIndex(int n)
+	{
+		int slices = int(uParams.x);
+		int stacks = int(uParams.y);
+		int cap = 3 * slices;
+		int middle = 6 * slices * (stacks - 2);
+
+		int s = 0;
+		int quad = n / 3;
+		int corner = n % 3;
+		bool upper = false;		// Triangle (a, c, b) of the quad, else (c, d, b)
+		if (n >= cap + middle)
+		{
+			s = stacks - 1;
+			quad = (n - cap - middle) / 3;
+			corner = (n - cap - middle) % 3;
+			upper = true;
+		}
+		else if (n >= cap)
+		{
+			s = 1 + (n - cap) / (6 * slices);
+			quad = ((n - cap) / 6) % slices;
+			corner = (n - cap) % 3;
+			upper = (n - cap) % 6 < 3;
+		}
+
+		int a = s * (slices + 1) + quad;
+		int b = a + slices + 1;
+		int corners[3] = int[3](a + 1, b + 1, b);
+		if (upper)
+			corners = int[3](a, a + 1, b);
+		return uint(corners[corner]);
+	}
+
+	uint shapeIndex(uint n)
+	{
+		return uShape == 0 ? torusIndex(int(n)) : sphereIndex(int(n));
+	}
+
+	// Same octahedral encoding as MeshOpt::UPackVertices
+	vec2 octEncode(vec3 n)
+	{
+		vec2 e = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+		if (n.z < 0.0)
+			e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+		return e;
+	}
+
+	void main()
+	{
+		uint id = gl_GlobalInvocationID.x;
+		if (id >= uCount)
+			return;
+
+		if (uIndexPass)
+		{
+			// the first of two 16 bit indices goes in the low half of the word
+			if (uShortIndices)
+			{
+				uint second = 2u * id + 1u < uIndexCount ? shapeIndex(2u * id + 1u) : 0u;
+				indexWords[uFirstWord + id] = shapeIndex(2u * id) | (second << 16);
+			}
+			else
+				indexWords[uFirstWord + id] = shapeIndex(id);
+			return;
+		}
+
+		vec3 position;
+		vec3 normal;
+		vec2 uv;
+		if (uShape == 0)
+			torusVertex(int(id), position, normal, uv);
+		else
+			sphereVertex(int(id), position, normal, uv);
+
+		if (uPacked)
+		{
+			uint word = uFirstWord + 4u * id;
+			vertexWords[word] = packHalf2x16(position.xy);
+			vertexWords[word + 1u] = packHalf2x16(vec2(position.z, 0.0));
+			vertexWords[word + 2u] = packSnorm2x16(octEncode(normal));
+			vertexWords[word + 3u] = packUnorm2x16(uv);
+		}
+		else
+		{
+			uint word = uFirstWord + 8u * id;
+			vertexWords[word] = floatBitsToUint(position.x);
+			vertexWords[word + 1u] = floatBitsToUint(position.y);
+			vertexWords[word + 2u] = floatBitsToUint(position.z);
+			vertexWords[word + 3u] = floatBitsToUint(normal.x);
+			vertexWords[word + 4u] = floatBitsToUint(normal.y);
+			vertexWords[word + 5u] = floatBitsToUint(normal.z);
+			vertexWords[word + 6u] = floatBitsToUint(uv.x);
+			vertexWords[word + 7u] = floatBitsToUint(uv.y);
+		}
+	}
+	);
+
+	float UHalfToFloat(GLushort half)
+	{
+		int exponent = (half >> 10) & 0x1f;
+		int mantissa = half & 0x3ff;
+		float value = exponent == 0 ? std::ldexp(float(mantissa), -24) : std::ldexp(float(mantissa | 0x400), exponent - 25);
+		return half & 0x8000 ? -value : value;
+	}
+
+	// Unfold an octahedral encoded normal, as the vertex shader does
+	glm::vec3 UOctDecode(GLshort x, GLshort y)
+	{
+		glm::vec3 n(std::max(x / 32767.0f, -1.0f), std::max(y / 32767.0f, -1.0f), 0.0f);
+		n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+		float t = std::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+}
+
+///////////////////////////////////////////////////
+//	Create()
+//
+//	Compile the compute program. Returns false (and the
+//	meshes are generated on the CPU) when it fails.
+///////////////////////////////////////////////////
+bool MeshCompute::Create()
+{
+	int success = 0;
+	char infoLog[512];
+
+	GLuint shaderId = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shaderId, 1, &generateShaderSource, NULL);
+	glCompileShader(shaderId);
+	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(shaderId, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+		glDeleteShader(shaderId);
+		return false;
+	}
+
+	program = glCreateProgram();
+	glAttachShader(program, shaderId);
+	glLinkProgram(program);
+	glDeleteShader(shaderId);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		Destroy();
+		return false;
+	}
+	return true;
+}
+
+void MeshCompute::Destroy()
+{
+	glDeleteProgram(program);
+	program = 0;
+}
+
+///////////////////////////////////////////////////
+//	UCounts(Shape, const float*, bool)
+//
+//	shape, params: shape and its generator parameters
+//	packed: packed vertex layout
+//
+//	Size of the vertex and index ranges Generate() fills
+///////////////////////////////////////////////////
+MeshCompute::Counts MeshCompute::UCounts(Shape shape, const float* params, bool packed)
+{
+	float p[4];
+	UClampParams(shape, params, p);
+
+	Counts counts;
+	if (shape == SHAPE_TORUS)
+	{
+		counts.nVertices = GLuint(p[0] + 1) * GLuint(p[1] + 1);
+		counts.nIndices = 6 * GLuint(p[0]) * GLuint(p[1]);
+	}
+	else
+	{
+		counts.nVertices = GLuint(p[0] + 1) * GLuint(p[1] + 1);
+		counts.nIndices = 6 * GLuint(p[0]) * GLuint(p[1] - 1);
+	}
+
+	// the same rule as MeshOpt::UPackIndices
+	bool shortIndices = packed && counts.nVertices <= 0x10000u;
+	counts.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	counts.indexBytes = counts.nIndices * (shortIndices ? sizeof(GLushort) : sizeof(GLuint));
+	return counts;
+}
+
+///////////////////////////////////////////////////
+//	Generate(Shape, const float*, bool, GLuint, GLint, GLuint, GLuint)
+//
+//	shape, params: shape and its generator parameters
+//	packed: write the packed vertex layout, else the float one
+//	vertexBuffer, baseVertex: where the first vertex goes
+//	indexBuffer, indexOffset: where the first index goes,
+//		a byte offset on a 4 byte boundary
+//
+//	Write the vertices and indices of a shape into GPU
+//	buffers (sized with UCounts) and make them visible to
+//	the following draws and buffer reads
+///////////////////////////////////////////////////
+void MeshCompute::Generate(Shape shape, const float* params, bool packed, GLuint vertexBuffer, GLint baseVertex, GLuint indexBuffer, GLuint indexOffset)
+{
+	float p[4];
+	UClampParams(shape, params, p);
+	Counts counts = UCounts(shape, params, packed);
+	bool shortIndices = counts.indexType == GL_UNSIGNED_SHORT;
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "uShape"), shape);
+	glUniform4fv(glGetUniformLocation(program, "uParams"), 1, p);
+	glUniform1i(glGetUniformLocation(program, "uPacked"), packed);
+	glUniform1i(glGetUniformLocation(program, "uShortIndices"), shortIndices);
+	glUniform1ui(glGetUniformLocation(program, "uIndexCount"), counts.nIndices);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vertexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, indexBuffer);
+
+	const GLuint vertexWords = packed ? sizeof(MeshOpt::PackedVertex) / sizeof(GLuint) : MeshGen::floatsPerVertexTotal;
+	glUniform1ui(glGetUniformLocation(program, "uFirstWord"), GLuint(baseVertex) * vertexWords);
+	UDispatch(false, counts.nVertices);
+
+	glUniform1ui(glGetUniformLocation(program, "uFirstWord"), indexOffset / sizeof(GLuint));
+	UDispatch(true, shortIndices ? (counts.nIndices + 1) / 2 : counts.nIndices);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+	glUseProgram(GLuint(previousProgram));
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+///////////////////////////////////////////////////
+//	Verify(Shape, const float*, bool, VerifyStats&)
+//
+//	shape, params: shape and its generator parameters
+//	packed: vertex layout to check
+//	stats: receives the largest differences found
+//
+//	Generate a shape into scratch buffers, read it back
+//	and compare it with the CPU generator's data (packed
+//	like the meshes pipeline does). Returns true when the
+//	indices match and the vertices are within tolerance.
+///////////////////////////////////////////////////
+bool MeshCompute::Verify(Shape shape, const float* params, bool packed, VerifyStats& stats)
+{
+	stats = VerifyStats();
+
+	MeshGen::MeshData data;
+	float p[4];
+	UClampParams(shape, params, p);
+	if (shape == SHAPE_TORUS)
+		MeshGen::UGenerateTorus(data, int(p[0]), int(p[1]), p[2], p[3]);
+	else
+		MeshGen::UGenerateSphere(data, int(p[0]), int(p[1]), p[2]);
+
+	Counts counts = UCounts(shape, params, packed);
+	if (counts.nVertices != data.VertexCount() || counts.nIndices != data.indices.size())
+	{
+		stats.indexMismatches = counts.nIndices;
+		return false;
+	}
+
+	// scratch buffers, offset like a mesh in the middle of the heap
+	const GLint baseVertex = 3;
+	const GLuint indexOffset = 4 * sizeof(GLuint);
+	const GLsizeiptr stride = packed ? sizeof(MeshOpt::PackedVertex) : sizeof(GLfloat) * MeshGen::floatsPerVertexTotal;
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+	glBufferData(GL_COPY_WRITE_BUFFER, stride * (baseVertex + counts.nVertices), nullptr, GL_STATIC_READ);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+	glBufferData(GL_COPY_WRITE_BUFFER, indexOffset + ((counts.indexBytes + 3) & ~3u), nullptr, GL_STATIC_READ);
+
+	Generate(shape, params, packed, buffers[0], baseVertex, buffers[1], indexOffset);
+
+	std::vector<unsigned char> vertices(size_t(stride) * counts.nVertices);
+	std::vector<unsigned char> indices(counts.indexBytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffers[0]);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, stride * baseVertex, vertices.size(), vertices.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, buffers[1]);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, indexOffset, indices.size(), indices.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(2, buffers);
+
+	float size = shape == SHAPE_TORUS ? p[2] + p[3] : p[2];
+	float positionTolerance = packed ? VERIFY_HALF_TOLERANCE * std::max(size, 1.0f) : VERIFY_POSITION_TOLERANCE * std::max(size, 1.0f);
+	float minNormalCos = 1.0f;
+	for (GLuint v = 0; v < counts.nVertices; v++)
+	{
+		const GLfloat* expected = &data.verts[v * MeshGen::floatsPerVertexTotal];
+		glm::vec3 position, normal;
+		glm::vec2 uv;
+		if (packed)
+		{
+			MeshOpt::PackedVertex vertex;
+			std::memcpy(&vertex, &vertices[v * stride], sizeof(vertex));
+			position = glm::vec3(UHalfToFloat(vertex.position[0]), UHalfToFloat(vertex.position[1]), UHalfToFloat(vertex.position[2]));
+			normal = UOctDecode(vertex.normal[0], vertex.normal[1]);
+			uv = glm::vec2(vertex.uv[0] / 65535.0f, vertex.uv[1] / 65535.0f);
+		}
+		else
+		{
+			GLfloat vertex[MeshGen::floatsPerVertexTotal];
+			std::memcpy(vertex, &vertices[v * stride], sizeof(vertex));
+			position = glm::vec3(vertex[0], vertex[1], vertex[2]);
+			normal = glm::normalize(glm::vec3(vertex[3], vertex[4], vertex[5]));
+			uv = glm::vec2(vertex[6], vertex[7]);
+		}
+
+		glm::vec3 expectedPosition(expected[0], expected[1], expected[2]);
+		glm::vec3 expectedNormal(expected[3], expected[4], expected[5]);
+		glm::vec2 expectedUV(expected[6], expected[7]);
+		glm::vec3 positionDelta = glm::abs(position - expectedPosition);
+		glm::vec2 uvDelta = glm::abs(uv - expectedUV);
+		stats.positionError = std::max(stats.positionError, std::max(positionDelta.x, std::max(positionDelta.y, positionDelta.z)));
+		stats.uvError = std::max(stats.uvError, std::max(uvDelta.x, uvDelta.y));
+		minNormalCos = std::min(minNormalCos, glm::dot(normal, glm::normalize(expectedNormal)));
+	}
+	stats.normalDegrees = std::acos(std::max(-1.0f, std::min(1.0f, minNormalCos))) * 180.0f / 3.14159265f;
+
+	for (GLuint i = 0; i < counts.nIndices; i++)
+	{
+		GLuint index;
+		if (counts.indexType == GL_UNSIGNED_SHORT)
+		{
+			GLushort shortIndex;
+			std::memcpy(&shortIndex, &indices[i * sizeof(GLushort)], sizeof(shortIndex));
+			index = shortIndex;
+		}
+		else
+			std::memcpy(&index, &indices[i * sizeof(GLuint)], sizeof(index));
+		if (index != data.indices[i])
+			stats.indexMismatches++;
+	}
+
+	float segmentDegrees = shape == SHAPE_TORUS ? 360.0f / std::min(p[0], p[1]) : std::max(360.0f / p[0], 180.0f / p[1]);
+	return stats.indexMismatches == 0 && stats.positionError <= positionTolerance
+		&& stats.normalDegrees <= std::max(VERIFY_NORMAL_DEGREES, segmentDegrees) && stats.uvError <= VERIFY_UV_TOLERANCE;
+}
+
+// The parameters MeshGen's generator would use, padded to a vec4
+void MeshCompute::UClampParams(Shape shape, const float* params, float* clamped)
+{
+	std::fill(clamped, clamped + 4, 0.0f);
+	if (shape == SHAPE_TORUS)
+	{
+		clamped[0] = std::max(std::floor(params[0]), 3.0f);
+		clamped[1] = std::max(std::floor(params[1]), 3.0f);
+		clamped[2] = params[2];
+		clamped[3] = params[3];
+	}
+	else
+	{
+		clamped[0] = std::max(std::floor(params[0]), 3.0f);
+		clamped[1] = std::max(std::floor(params[1]), 2.0f);
+		clamped[2] = params[2];
+	}
+}
+
+void MeshCompute::UDispatch(bool indexPass, GLuint count)
+{
+	glUniform1i(glGetUniformLocation(program, "uIndexPass"), indexPass);
+	glUniform1ui(glGetUniformLocation(program, "uCount"), count);
+	glDispatchCompute((count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+}
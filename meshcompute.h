@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcompute.h
+// ========
+// parametric primitives generated by a compute shader straight into GPU
+// buffers: no CPU generation and no upload copy
+//
+// The shader writes the same vertices and indices as the MeshGen generators
+// (same order, positions and texture coords; normals are the exact ones of
+// the surface), in the float or packed vertex layout. Verify() reads them
+// back and compares them with the CPU generator.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+class MeshCompute
+{
+
+public:
+
+	// Shapes the compute shader generates, with the parameters of their MeshGen generator
+	enum Shape
+	{
+		SHAPE_TORUS = 0,	// main segments, tube segments, main radius, tube radius
+		SHAPE_SPHERE = 1	// slices, stacks, radius
+	};
+
+	// Size of a generated shape in one vertex layout
+	struct Counts
+	{
+		GLuint nVertices;
+		GLuint nIndices;
+		GLenum indexType;	// GL_UNSIGNED_SHORT with the packed layout when the vertices fit
+		GLuint indexBytes;
+	};
+
+	// Largest differences from the CPU generator found by Verify()
+	struct VerifyStats
+	{
+		float positionError;
+		float normalDegrees;
+		float uvError;
+		GLuint indexMismatches;
+	};
+
+public:
+	bool Create();
+	void Destroy();
+	bool IsCreated() const { return program != 0; }
+
+	static Counts UCounts(Shape shape, const float *params, bool packed);
+	void Generate(Shape shape, const float *params, bool packed, GLuint vertexBuffer, GLint baseVertex, GLuint indexBuffer, GLuint indexOffset);
+	bool Verify(Shape shape, const float *params, bool packed, VerifyStats &stats);
+
+private:
+	static void UClampParams(Shape shape, const float *params, float *clamped);
+	void UDispatch(bool indexPass, GLuint count);
+
+	GLuint program = 0;
+};
@@ -13,6 +13,22 @@
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geometryheap.h"
+#include "meshcache.h"
+#include "meshcompute.h"
+#include "meshgen.h"
+#include "meshopt.h"
+#include "meshstream.h"
+#include "vertexlayout.h"
+
 class Meshes
 {
 
@@ -21,40 +37,192 @@ public:
 	// Stores the GL data relative to a given mesh
 	struct GLMesh
 	{
-		GLuint vao;         // Handle for the vertex array object
-		GLuint vbos[2];     // Handles for the vertex buffer objects
+		GLuint vao;         // Handle for the vertex array object (shared by all meshes of a layout)
+		GeometryHeap::Allocation allocation;	// Vertex and index ranges in the geometry heap
 		GLuint nVertices;	// Number of vertices for the mesh
 		GLuint nIndices;    // Number of indices for the mesh
+		GLenum indexType;	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		bool cullBackFaces;	// Closed and wound outward, so back faces are hidden and can be culled
+		std::vector<MeshGen::MeshPart> parts;	// Index ranges drawn with their own material, for every LOD
+		std::vector<float> lodErrors;	// Object space error of each LOD, empty without LODs
+		std::vector<MeshGen::Meshlet> meshlets;	// Clusters of all LODs in index order, culled before drawing
+
+		int LodCount() const { return lodErrors.empty() ? 1 : int(lodErrors.size()); }
+		int PartsPerLod() const { return int(parts.size()) / LodCount(); }
+		const MeshGen::MeshPart& Part(int lod, int part) const { return parts[lod * PartsPerLod() + part]; }
+	};
+
+	// Default radii of the torus
+	static constexpr float torusMainRadius = 1.0f;
+	static constexpr float torusTubeRadius = 0.1f;
+
+	// Generator parameters of the torus acquired with AcquireTorus(), changed at
+	// runtime by RegenerateTorus()
+	struct TorusParams
+	{
+		int mainSegments;
+		int tubeSegments;
+		float mainRadius;	// The tessellation path evaluates the torus from the radii
+		float tubeRadius;
+	};
+
+	// Parameters of the torus currently drawn (and of its patch mesh's radii)
+	TorusParams torusParams = { 30, 30, torusMainRadius, torusTubeRadius };
+
+	// Mesh imported from an asset file (see MeshImport)
+	struct ImportedMesh
+	{
+		std::string filename;
+		GLMesh mesh;
+		std::vector<int> materialIds;	// Material of each part of a LOD, MeshImport::NO_MATERIAL without one
+		glm::vec3 boundsMin;			// Object space bounding box
+		glm::vec3 boundsMax;
 	};
 
-	GLMesh gBoxMesh;
-	GLMesh gConeMesh;
-	GLMesh gCylinderMesh;
-	GLMesh gTaperedCylinderMesh;
-	GLMesh gPlaneMesh;
-	GLMesh gPrismMesh;
-	GLMesh gSphereMesh;
-	GLMesh gPyramid3Mesh;
-	GLMesh gPyramid4Mesh;
-	GLMesh gTorusMesh;
+	std::vector<ImportedMesh> gImportedMeshes;
+
+	// Meshes streamed from stream files (see MeshStream); they page their own
+	// GPU buffers and stay out of the geometry heap
+	std::vector<std::unique_ptr<MeshStream>> gStreamedMeshes;
+
+	// Vertex layout used for the uploaded meshes
+	enum VertexFormat
+	{
+		VERTEX_FLOAT,	// 32 bytes: float position, normal and texture coords, 32 bit indices
+		VERTEX_PACKED	// 16 bytes: half float position, octahedral normal, normalized texture coords, 16 bit indices
+	};
+
+	// Shader input locations of the vertex attributes
+	enum AttributeLocation
+	{
+		ATTRIBUTE_POSITION = 0,
+		ATTRIBUTE_NORMAL = 1,
+		ATTRIBUTE_UV = 2
+	};
+
+	// Attribute layouts of VERTEX_FLOAT and VERTEX_PACKED; the packed normal is
+	// octahedral encoded and its texture coords normalized or half floats
+	typedef VertexLayout<MeshGen::Vertex,
+		VertexAttribute<ATTRIBUTE_POSITION, GL_FLOAT, 3, false, offsetof(MeshGen::Vertex, position)>,
+		VertexAttribute<ATTRIBUTE_NORMAL, GL_FLOAT, 3, false, offsetof(MeshGen::Vertex, normal)>,
+		VertexAttribute<ATTRIBUTE_UV, GL_FLOAT, 2, false, offsetof(MeshGen::Vertex, uv)>> FloatLayout;
+
+	typedef VertexLayout<MeshOpt::PackedVertex,
+		VertexAttribute<ATTRIBUTE_POSITION, GL_HALF_FLOAT, 4, false, offsetof(MeshOpt::PackedVertex, position)>,
+		VertexAttribute<ATTRIBUTE_NORMAL, GL_SHORT, 2, true, offsetof(MeshOpt::PackedVertex, normal)>,
+		VertexAttribute<ATTRIBUTE_UV, GL_UNSIGNED_SHORT, 2, true, offsetof(MeshOpt::PackedVertex, uv)>> PackedLayout;
+
+	typedef VertexLayout<MeshOpt::PackedVertex,
+		VertexAttribute<ATTRIBUTE_POSITION, GL_HALF_FLOAT, 4, false, offsetof(MeshOpt::PackedVertex, position)>,
+		VertexAttribute<ATTRIBUTE_NORMAL, GL_SHORT, 2, true, offsetof(MeshOpt::PackedVertex, normal)>,
+		VertexAttribute<ATTRIBUTE_UV, GL_HALF_FLOAT, 2, false, offsetof(MeshOpt::PackedVertex, uv)>> PackedHalfUVLayout;
+
+	// Selects the layout, must be set before CreateMeshes()
+	VertexFormat vertexFormat = VERTEX_FLOAT;
+
+	// Load and store the final mesh data in the mesh cache file
+	bool useMeshCache = true;
+
+	// Generate the torus and sphere on the GPU with a compute shader (see
+	// MeshCompute); these skip the mesh cache and get no LODs or meshlets
+	bool computeMeshes = false;
+
+	// OBJ and glTF files imported into gImportedMeshes by CreateMeshes()
+	std::vector<std::string> importFiles;
+
+	// Stream files opened into gStreamedMeshes by CreateMeshes(), and the GPU
+	// memory each of them pages its nodes into
+	std::vector<std::string> streamFiles;
+	GLuint streamBudgetBytes = 32 << 20;
 
 public:
 	void CreateMeshes();
 	void DestroyMeshes();
+	const GLMesh* AcquireMesh(const std::string &name, const std::vector<float> &params = {});
+	const GLMesh* AcquireTorus(bool patches = false);
+	void ReleaseMesh(const GLMesh *mesh);
+	void ReportMeshes() const;
+	void RegenerateTorus(const TorusParams &params);
+	bool UpdateMeshes();
 
 private:
-	void UCreatePlaneMesh(GLMesh &mesh);
-	void UCreatePrismMesh(GLMesh &mesh);
-	void UCreateBoxMesh(GLMesh &mesh);
-	void UCreateConeMesh(GLMesh &mesh);
-	void UCreateCylinderMesh(GLMesh &mesh);
-	void UCreateTaperedCylinderMesh(GLMesh &mesh);
-	void UCreateTorusMesh(GLMesh &mesh);
-	void UCreatePyramid3Mesh(GLMesh &mesh);
-	void UCreatePyramid4Mesh(GLMesh &mesh);
-	void UCreateSphereMesh(GLMesh &mesh);
+	// Registry key: generator name and all its parameters
+	typedef std::pair<std::string, std::vector<float>> MeshId;
 
+	// Mesh created by AcquireMesh(), freed when the last user releases it
+	struct RegisteredMesh
+	{
+		GLMesh mesh;
+		int references;
+	};
+
+	void UProcessMesh(MeshGen::MeshData &data, const char *name);
+	void UOrientMesh(MeshGen::MeshData &data, const char *name);
+	MeshCache::Key UMeshKey(const char *name, std::vector<float> params);
+	bool ULoadMesh(GLMesh &mesh, const MeshCache::Key &key);
+	void UImportMesh(const std::string &filename);
+	void UCreateMesh(GLMesh &mesh, MeshGen::MeshData &data, const MeshCache::Key &key, bool store = true);
+	void UCreatePatchMesh(GLMesh &mesh, MeshGen::MeshData &data, const MeshCache::Key &key);
+	void UProcessPatchMesh(MeshGen::MeshData &data, const char *name);
+	void UStoreMesh(GLMesh &mesh, MeshGen::MeshData &data, const MeshCache::Key &key, bool store);
+	void UMakeImage(MeshGen::MeshData &data, std::vector<MeshOpt::PackedVertex> &packedVertices, std::vector<GLushort> &shortIndices, MeshCache::MeshImage &image);
+	void UUploadMesh(GLMesh &mesh, const MeshCache::MeshImage &image);
+	void USetupVertexAttributes(bool normalizedUVs);
+	GLuint UVertexArray(bool normalizedUVs);
+	bool UComputeReady();
+	void UComputeMesh(GLMesh &mesh, MeshCompute::Shape shape, const float *params);
+	void URegenerateComputeTorus(const TorusParams &params);
 	void UDestroyMesh(GLMesh &mesh);
+	MeshId UTorusId(const TorusParams &params, bool patches) const;
+	bool UTorusTaken(const TorusParams &params, bool patches) const;
+	void UStartTorusJob(const TorusParams &params);
+	void USwapMesh(GLMesh &mesh, const MeshCache::MeshImage &image);
+	GLMesh* URekeyMesh(const MeshId &from, const MeshId &to);
+	void URetireAllocation(const GeometryHeap::Allocation &allocation);
+	void UFreeRetiredMeshes(bool wait);
+
+	// Shared vertex/index buffers of all meshes and their VAOs
+	GeometryHeap heap;
+	GLuint vertexArray;
+	GLuint halfUVVertexArray;	// Packed layout with half float texture coords
+
+	MeshCache cache;	// Open from CreateMeshes() to DestroyMeshes(), meshes are acquired in between
+	MeshCompute compute;	// Created with the first compute mesh
+
+	// std::map nodes never move, so the pointers AcquireMesh() hands out stay valid
+	std::map<MeshId, RegisteredMesh> registry;
+	double registryMilliseconds = 0.0;	// Time spent creating the registered meshes
+
+	// Mesh data generated and quantized on a worker thread, ready to upload
+	struct PreparedMesh
+	{
+		MeshGen::MeshData data;
+		std::vector<MeshOpt::PackedVertex> packedVertices;
+		std::vector<GLushort> shortIndices;
+		MeshCache::MeshImage image;		// Points into the vectors above
+	};
+
+	// Result of a torus regeneration: the patch mesh is only made when it is
+	// registered and the radii changed
+	struct TorusJob
+	{
+		TorusParams params;
+		PreparedMesh mesh;
+		PreparedMesh patches;
+		bool hasPatches;
+	};
+
+	// Heap ranges of swapped out meshes, freed once the GPU passed the fence
+	// placed after the last frame that could draw them
+	struct RetiredMesh
+	{
+		GeometryHeap::Allocation allocation;
+		GLsync fence;
+	};
 
-	void CalculateTriangleNormal(glm::vec3 px, glm::vec3 py, glm::vec3 pz);
+	std::future<TorusJob> torusJob;		// Regeneration running on the worker thread
+	bool torusRequestPending = false;	// Another regeneration waits for it
+	TorusParams torusRequest;
+	bool torusRegenerated = false;		// Regenerated on the GPU since the last UpdateMeshes()
+	std::vector<RetiredMesh> retiredMeshes;
 };
\ No newline at end of file
@@ -0,0 +1,401 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgen.cpp
+// ========
+// parametric generators for the 3D primitives: plane, pyramid, prism, cube,
+// cone, cylinder, tapered cylinder, torus, sphere
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshgen.h"
+#include "meshnormals.h"
+#include "meshtables.h"
+
+#include <cmath>
+
+namespace
+{
+	const float TWO_PI = 6.28318530717958647692f;
+	const float PI = 3.14159265358979323846f;
+
+	// Split vertices of the round primitives whose normals are closer than
+	// this (degrees) are smoothed together: it closes the texture seams and
+	// the pole/apex fans while the edges to the caps stay hard
+	const float SMOOTH_CREASE_ANGLE = 30.0f;
+
+	// Default resolutions of the round primitives, laid out at compile time
+	constexpr auto CYLINDER_TABLE = MeshTables::UCylinderTable<36>(1.0f, 1.0f, 1.0f);
+	constexpr auto SMALL_CYLINDER_TABLE = MeshTables::UCylinderTable<12>(1.0f, 1.0f, 1.0f);
+	constexpr auto TAPERED_CYLINDER_TABLE = MeshTables::UCylinderTable<36>(1.0f, 0.5f, 1.0f);
+	constexpr auto CONE_TABLE = MeshTables::UConeTable<36>(1.0f, 1.0f);
+	constexpr auto SPHERE_TABLE = MeshTables::USphereTable<16, 16>(1.0f);
+
+	static_assert(CYLINDER_TABLE.Full() && SMALL_CYLINDER_TABLE.Full() && TAPERED_CYLINDER_TABLE.Full(), "cylinder table size");
+	static_assert(CONE_TABLE.Full() && SPHERE_TABLE.Full(), "cone or sphere table size");
+
+	// Append a compile time table to the mesh data
+	template<class Table>
+	void UAppendTable(MeshGen::MeshData& data, const Table& table)
+	{
+		GLuint baseVertex = data.VertexCount();
+		GLuint baseIndex = GLuint(data.indices.size());
+		data.verts.insert(data.verts.end(), table.verts.begin(), table.verts.end());
+		for (GLuint index : table.indices)
+			data.indices.push_back(baseVertex + index);
+		for (MeshGen::MeshPart part : table.parts)
+		{
+			part.firstIndex += baseIndex;
+			data.parts.push_back(part);
+		}
+	}
+}
+
+// MeshTables sink that appends to mesh data at runtime, through the same
+// helpers as the generators
+struct MeshGen::MeshDataSink
+{
+	MeshData& data;
+
+	GLuint VertexCount() const { return data.VertexCount(); }
+	GLuint AddVertex(float x, float y, float z, float u, float v) { return UAddVertex(data, glm::vec3(x, y, z), glm::vec2(u, v)); }
+	void AddTriangle(GLuint i0, GLuint i1, GLuint i2) { UAddTriangle(data, i0, i1, i2); }
+	void BeginPart() { UBeginPart(data); }
+	void EndPart() { UEndPart(data); }
+};
+
+///////////////////////////////////////////////////
+//	UGeneratePlane(MeshData&, int, int)
+//
+//	data: mesh data to fill
+//	xSegments, zSegments: number of quads along each axis
+//
+//	Create a flat 2x2 plane on the XZ axis facing up
+///////////////////////////////////////////////////
+void MeshGen::UGeneratePlane(MeshData& data, int xSegments, int zSegments)
+{
+	xSegments = xSegments < 1 ? 1 : xSegments;
+	zSegments = zSegments < 1 ? 1 : zSegments;
+
+	UBeginPart(data);
+	GLuint first = data.VertexCount();
+	for (int iz = 0; iz <= zSegments; iz++)
+	{
+		float z = -1.0f + 2.0f * iz / zSegments;
+		for (int ix = 0; ix <= xSegments; ix++)
+		{
+			float x = -1.0f + 2.0f * ix / xSegments;
+			UAddVertex(data, glm::vec3(x, 0.0f, z), glm::vec2((x + 1.0f) * 0.5f, (1.0f - z) * 0.5f));
+		}
+	}
+
+	GLuint row = xSegments + 1;
+	for (int iz = 0; iz < zSegments; iz++)
+	{
+		for (int ix = 0; ix < xSegments; ix++)
+		{
+			GLuint a = first + iz * row + ix;
+			GLuint b = a + 1;
+			GLuint c = a + row;
+			GLuint d = c + 1;
+			UAddTriangle(data, a, c, b);
+			UAddTriangle(data, b, c, d);
+		}
+	}
+	UEndPart(data);
+
+	MeshNormals::UComputeNormals(data);
+}
+
+///////////////////////////////////////////////////
+//	UGenerateBox(MeshData&, int)
+//
+//	data: mesh data to fill
+//	segments: number of quads along each edge of a face
+//
+//	Create a unit cube centered on the origin
+///////////////////////////////////////////////////
+void MeshGen::UGenerateBox(MeshData& data, int segments)
+{
+	// face normal, then the u and v axes of the face (u x v = normal)
+	const glm::vec3 faces[6][3] = {
+		{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },	// back
+		{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },		// bottom
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },		// left
+		{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },		// right
+		{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },		// top
+		{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) }		// front
+	};
+
+	segments = segments < 1 ? 1 : segments;
+
+	UBeginPart(data);
+	for (int f = 0; f < 6; f++)
+	{
+		const glm::vec3& normal = faces[f][0];
+		const glm::vec3& uAxis = faces[f][1];
+		const glm::vec3& vAxis = faces[f][2];
+
+		GLuint first = data.VertexCount();
+		for (int t = 0; t <= segments; t++)
+		{
+			float v = float(t) / segments;
+			for (int s = 0; s <= segments; s++)
+			{
+				float u = float(s) / segments;
+				glm::vec3 position = normal * 0.5f + uAxis * (u - 0.5f) + vAxis * (v - 0.5f);
+				UAddVertex(data, position, glm::vec2(u, v));
+			}
+		}
+
+		GLuint row = segments + 1;
+		for (int t = 0; t < segments; t++)
+		{
+			for (int s = 0; s < segments; s++)
+			{
+				GLuint a = first + t * row + s;
+				GLuint b = a + 1;
+				GLuint c = a + row;
+				GLuint d = c + 1;
+				UAddTriangle(data, a, b, c);
+				UAddTriangle(data, b, d, c);
+			}
+		}
+	}
+	UEndPart(data);
+
+	MeshNormals::UComputeNormals(data);
+}
+
+///////////////////////////////////////////////////
+//	UGeneratePyramid(MeshData&, int)
+//
+//	data: mesh data to fill
+//	sides: number of sides of the base (3 or 4 for the scene pyramids)
+//
+//	Create a unit pyramid centered on the origin, apex up
+///////////////////////////////////////////////////
+void MeshGen::UGeneratePyramid(MeshData& data, int sides)
+{
+	sides = sides < 3 ? 3 : sides;
+
+	// base corners sit on the unit square for the 4 sided pyramid
+	const float radius = std::sqrt(0.5f);
+	const float angleOffset = PI / sides;
+
+	UBeginPart(data);
+	glm::vec3 apex(0.0f, 0.5f, 0.0f);
+	for (int i = 0; i < sides; i++)
+	{
+		float a0 = angleOffset + TWO_PI * i / sides;
+		float a1 = angleOffset + TWO_PI * (i + 1) / sides;
+		glm::vec3 b0(radius * std::cos(a0), -0.5f, radius * std::sin(a0));
+		glm::vec3 b1(radius * std::cos(a1), -0.5f, radius * std::sin(a1));
+		GLuint i0 = UAddVertex(data, b0, glm::vec2(0.0f, 0.0f));
+		GLuint i1 = UAddVertex(data, apex, glm::vec2(0.5f, 1.0f));
+		GLuint i2 = UAddVertex(data, b1, glm::vec2(1.0f, 0.0f));
+		UAddTriangle(data, i0, i1, i2);
+	}
+	MeshDataSink sink{ data };
+	MeshTables::ULayoutCap(sink, sides, radius, -0.5f, angleOffset, false);
+	UEndPart(data);
+
+	MeshNormals::UComputeNormals(data);
+}
+
+///////////////////////////////////////////////////
+//	UGeneratePrism(MeshData&, int)
+//
+//	data: mesh data to fill
+//	sides: number of sides of the prism
+//
+//	Create a unit prism centered on the origin with flat sides
+///////////////////////////////////////////////////
+void MeshGen::UGeneratePrism(MeshData& data, int sides)
+{
+	sides = sides < 3 ? 3 : sides;
+
+	const float radius = std::sqrt(0.5f);
+	const float angleOffset = PI / sides;
+
+	MeshDataSink sink{ data };
+	UBeginPart(data);
+	MeshTables::ULayoutFrustumSides(sink, sides, radius, radius, -0.5f, 1.0f, angleOffset, false);
+	MeshTables::ULayoutCap(sink, sides, radius, -0.5f, angleOffset, false);
+	MeshTables::ULayoutCap(sink, sides, radius, 0.5f, angleOffset, true);
+	UEndPart(data);
+
+	MeshNormals::UComputeNormals(data);
+}
+
+///////////////////////////////////////////////////
+//	UGenerateCone(MeshData&, int, float, float)
+//
+//	data: mesh data to fill
+//	slices: number of segments around the cone
+//
+//	Create a cone standing on the XZ plane
+//	Parts: CYLINDER_BOTTOM, CONE_SIDES
+///////////////////////////////////////////////////
+void MeshGen::UGenerateCone(MeshData& data, int slices, float radius, float height)
+{
+	slices = slices < 3 ? 3 : slices;
+
+	if (slices == 36 && radius == 1.0f && height == 1.0f)
+		UAppendTable(data, CONE_TABLE);
+	else
+	{
+		MeshDataSink sink{ data };
+		MeshTables::ULayoutCone(sink, slices, radius, height);
+	}
+
+	MeshNormals::UComputeNormals(data, MeshNormals::WEIGHT_ANGLE, SMOOTH_CREASE_ANGLE);
+}
+
+///////////////////////////////////////////////////
+//	UGenerateCylinder(MeshData&, int, float, float)
+//
+//	data: mesh data to fill
+//	slices: number of segments around the cylinder
+//
+//	Create a cylinder standing on the XZ plane
+//	Parts: CYLINDER_BOTTOM, CYLINDER_TOP, CYLINDER_SIDES
+///////////////////////////////////////////////////
+void MeshGen::UGenerateCylinder(MeshData& data, int slices, float radius, float height)
+{
+	UGenerateTaperedCylinder(data, slices, radius, radius, height);
+}
+
+///////////////////////////////////////////////////
+//	UGenerateTaperedCylinder(MeshData&, int, float, float, float)
+//
+//	data: mesh data to fill
+//	slices: number of segments around the cylinder
+//
+//	Create a cylinder standing on the XZ plane whose
+//	top radius differs from its bottom radius
+//	Parts: CYLINDER_BOTTOM, CYLINDER_TOP, CYLINDER_SIDES
+///////////////////////////////////////////////////
+void MeshGen::UGenerateTaperedCylinder(MeshData& data, int slices, float bottomRadius, float topRadius, float height)
+{
+	slices = slices < 3 ? 3 : slices;
+
+	if (slices == 36 && bottomRadius == 1.0f && topRadius == 1.0f && height == 1.0f)
+		UAppendTable(data, CYLINDER_TABLE);
+	else if (slices == 12 && bottomRadius == 1.0f && topRadius == 1.0f && height == 1.0f)
+		UAppendTable(data, SMALL_CYLINDER_TABLE);
+	else if (slices == 36 && bottomRadius == 1.0f && topRadius == 0.5f && height == 1.0f)
+		UAppendTable(data, TAPERED_CYLINDER_TABLE);
+	else
+	{
+		MeshDataSink sink{ data };
+		MeshTables::ULayoutCylinder(sink, slices, bottomRadius, topRadius, height);
+	}
+
+	MeshNormals::UComputeNormals(data, MeshNormals::WEIGHT_ANGLE, SMOOTH_CREASE_ANGLE);
+}
+
+///////////////////////////////////////////////////
+//	UGenerateTorus(MeshData&, int, int, float, float)
+//
+//	data: mesh data to fill
+//	mainSegments: number of segments around the ring
+//	tubeSegments: number of segments around the tube
+//
+//	Create a torus lying on the XY plane
+///////////////////////////////////////////////////
+void MeshGen::UGenerateTorus(MeshData& data, int mainSegments, int tubeSegments, float mainRadius, float tubeRadius)
+{
+	mainSegments = mainSegments < 3 ? 3 : mainSegments;
+	tubeSegments = tubeSegments < 3 ? 3 : tubeSegments;
+
+	UBeginPart(data);
+	GLuint first = data.VertexCount();
+
+	// the first and last rows/columns are duplicated so the texture wraps once;
+	// their angles wrap to zero so the duplicates land on the same positions
+	for (int i = 0; i <= mainSegments; i++)
+	{
+		float mainAngle = TWO_PI * (i % mainSegments) / mainSegments;
+		float sinMain = std::sin(mainAngle);
+		float cosMain = std::cos(mainAngle);
+		for (int j = 0; j <= tubeSegments; j++)
+		{
+			float tubeAngle = TWO_PI * (j % tubeSegments) / tubeSegments;
+			float sinTube = std::sin(tubeAngle);
+			float cosTube = std::cos(tubeAngle);
+
+			glm::vec3 position(
+				(mainRadius + tubeRadius * cosTube) * cosMain,
+				(mainRadius + tubeRadius * cosTube) * sinMain,
+				tubeRadius * sinTube);
+			UAddVertex(data, position, glm::vec2(float(i) / mainSegments, float(j) / tubeSegments));
+		}
+	}
+
+	GLuint row = tubeSegments + 1;
+	for (int i = 0; i < mainSegments; i++)
+	{
+		for (int j = 0; j < tubeSegments; j++)
+		{
+			GLuint a = first + i * row + j;
+			GLuint b = a + row;
+			GLuint c = a + 1;
+			GLuint d = b + 1;
+			UAddTriangle(data, a, b, c);
+			UAddTriangle(data, b, d, c);
+		}
+	}
+	UEndPart(data);
+
+	MeshNormals::UComputeNormals(data, MeshNormals::WEIGHT_ANGLE, SMOOTH_CREASE_ANGLE);
+}
+
+///////////////////////////////////////////////////
+//	UGenerateSphere(MeshData&, int, int, float)
+//
+//	data: mesh data to fill
+//	slices: number of segments around the Y axis
+//	stacks: number of rings from pole to pole
+//
+//	Create a UV sphere centered on the origin
+///////////////////////////////////////////////////
+void MeshGen::UGenerateSphere(MeshData& data, int slices, int stacks, float radius)
+{
+	slices = slices < 3 ? 3 : slices;
+	stacks = stacks < 2 ? 2 : stacks;
+
+	if (slices == 16 && stacks == 16 && radius == 1.0f)
+		UAppendTable(data, SPHERE_TABLE);
+	else
+	{
+		MeshDataSink sink{ data };
+		MeshTables::ULayoutSphere(sink, slices, stacks, radius);
+	}
+
+	MeshNormals::UComputeNormals(data, MeshNormals::WEIGHT_ANGLE, SMOOTH_CREASE_ANGLE);
+}
+
+// the normal is left zero for MeshNormals to compute
+GLuint MeshGen::UAddVertex(MeshData& data, const glm::vec3& position, const glm::vec2& uv)
+{
+	GLuint index = data.VertexCount();
+	data.verts.insert(data.verts.end(), { position.x, position.y, position.z, 0.0f, 0.0f, 0.0f, uv.x, uv.y });
+	return index;
+}
+
+void MeshGen::UAddTriangle(MeshData& data, GLuint i0, GLuint i1, GLuint i2)
+{
+	data.indices.insert(data.indices.end(), { i0, i1, i2 });
+}
+
+void MeshGen::UBeginPart(MeshData& data)
+{
+	MeshPart part;
+	part.firstIndex = GLuint(data.indices.size());
+	part.nIndices = 0;
+	data.parts.push_back(part);
+}
+
+void MeshGen::UEndPart(MeshData& data)
+{
+	MeshPart& part = data.parts.back();
+	part.nIndices = GLuint(data.indices.size()) - part.firstIndex;
+}
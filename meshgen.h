@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgen.h
+// ========
+// parametric generators for the 3D primitives: plane, pyramid, prism, cube,
+// cone, cylinder, tapered cylinder, torus, sphere
+//
+// Every generator produces an indexed triangle list with the interleaved
+// vertex layout used by Meshes (position, normal, texture coords) and a
+// counter-clockwise (outward facing) winding. The generators lay out
+// positions and texture coords; the normals are computed from the
+// triangles by MeshNormals.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class MeshGen
+{
+
+public:
+
+	// total float values per each vertex attribute
+	static const GLuint floatsPerVertex = 3;
+	static const GLuint floatsPerNormal = 3;
+	static const GLuint floatsPerUV = 2;
+	static const GLuint floatsPerVertexTotal = floatsPerVertex + floatsPerNormal + floatsPerUV;
+
+	// One vertex of MeshData::verts
+	struct Vertex
+	{
+		GLfloat position[floatsPerVertex];
+		GLfloat normal[floatsPerNormal];
+		GLfloat uv[floatsPerUV];
+	};
+
+	// Range of indices that is drawn with a single material,
+	// e.g. the bottom cap, top cap or the sides of a cylinder
+	struct MeshPart
+	{
+		GLuint firstIndex;	// Offset of the first index of the part
+		GLuint nIndices;	// Number of indices of the part
+	};
+
+	// Small cluster of consecutive triangles of one part with the bounds
+	// used to cull it on the CPU (see MeshOpt::UBuildMeshlets)
+	struct Meshlet
+	{
+		GLuint firstIndex;		// Offset of the first index of the cluster
+		GLuint nIndices;		// Number of indices of the cluster
+		GLfloat center[3];		// Bounding sphere in object space
+		GLfloat radius;
+		GLfloat coneAxis[3];	// Average facing of the triangles
+		GLfloat coneCutoff;		// Sine of the widest angle between a triangle and the axis, 1 when never back-facing
+	};
+
+	// Part order of the cylinder, tapered cylinder and cone meshes
+	// (the cone has no top cap, its sides are part 1)
+	enum CylinderPart
+	{
+		CYLINDER_BOTTOM = 0,
+		CYLINDER_TOP = 1,
+		CYLINDER_SIDES = 2,
+		CONE_SIDES = 1
+	};
+
+	// CPU side mesh data produced by the generators
+	//
+	// Simplified LODs (see MeshOpt::UGenerateLods) share the vertices and
+	// append their own index ranges: LOD k uses parts [k * PartsPerLod(), (k + 1) * PartsPerLod())
+	struct MeshData
+	{
+		std::vector<GLfloat> verts;		// Interleaved position, normal, texture coords
+		std::vector<GLuint> indices;	// Triangle list
+		std::vector<MeshPart> parts;	// Index ranges, at least one covering all indices
+		std::vector<float> lodErrors;	// Object space error of each LOD, empty without LODs
+		std::vector<Meshlet> meshlets;	// Clusters covering the parts of every LOD in index order
+		bool closed = false;			// Closed and wound outward (see MeshOpt::UOrientWinding), back faces can be culled
+
+		GLuint VertexCount() const { return GLuint(verts.size() / floatsPerVertexTotal); }
+		GLuint LodCount() const { return lodErrors.empty() ? 1 : GLuint(lodErrors.size()); }
+		GLuint PartsPerLod() const { return GLuint(parts.size()) / LodCount(); }
+	};
+
+public:
+	static void UGeneratePlane(MeshData &data, int xSegments = 1, int zSegments = 1);
+	static void UGenerateBox(MeshData &data, int segments = 1);
+	static void UGeneratePyramid(MeshData &data, int sides);
+	static void UGeneratePrism(MeshData &data, int sides = 3);
+	static void UGenerateCone(MeshData &data, int slices = 36, float radius = 1.0f, float height = 1.0f);
+	static void UGenerateCylinder(MeshData &data, int slices = 36, float radius = 1.0f, float height = 1.0f);
+	static void UGenerateTaperedCylinder(MeshData &data, int slices = 36, float bottomRadius = 1.0f, float topRadius = 0.5f, float height = 1.0f);
+	static void UGenerateTorus(MeshData &data, int mainSegments = 30, int tubeSegments = 30, float mainRadius = 1.0f, float tubeRadius = 0.1f);
+	static void UGenerateSphere(MeshData &data, int slices = 16, int stacks = 16, float radius = 1.0f);
+
+private:
+	struct MeshDataSink;
+
+	static GLuint UAddVertex(MeshData &data, const glm::vec3 &position, const glm::vec2 &uv);
+	static void UAddTriangle(MeshData &data, GLuint i0, GLuint i1, GLuint i2);
+	static void UBeginPart(MeshData &data);
+	static void UEndPart(MeshData &data);
+};
@@ -0,0 +1,1304 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimport.cpp
+// ========
+// importer for exported assets: Wavefront OBJ and glTF 2.0 (.gltf with
+// local buffer files, or binary .glb)
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshimport.h"
+#include "meshnormals.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+	const GLuint floatsPerVertexTotal = MeshGen::floatsPerVertexTotal;
+
+	// Smallest share of the file a parse thread is started for
+	const size_t MIN_THREAD_BYTES = 256 * 1024;
+
+	// OBJ chunks per thread, so threads that finish early pick up more
+	const GLuint OBJ_CHUNKS_PER_THREAD = 4;
+
+	// Deepest JSON nesting and glTF node hierarchy accepted
+	const int MAX_JSON_DEPTH = 64;
+	const int MAX_NODE_DEPTH = 64;
+
+	const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+	// Run task(0) .. task(nTasks - 1) on up to nThreads threads
+	template<class Task>
+	void UParallelFor(GLuint nTasks, GLuint nThreads, const Task& task)
+	{
+		std::atomic<GLuint> next(0);
+		auto worker = [&]()
+		{
+			for (GLuint i = next++; i < nTasks; i = next++)
+				task(i);
+		};
+
+		std::vector<std::thread> threads;
+		for (GLuint t = 1; t < std::min(nThreads, nTasks); t++)
+			threads.emplace_back(worker);
+		worker();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// Triangles decoded by one task, bucketed by material
+	struct Batch
+	{
+		std::vector<GLfloat> verts;
+		std::map<int, std::vector<GLuint>> indices;	// Material -> triangle list into verts
+		bool missingNormals = false;
+		bool skipped = false;	// Geometry that is not a triangle list was left out
+		bool error = false;
+	};
+
+	GLuint UAddBatchVertex(Batch& batch, const GLfloat* position, const GLfloat* normal, const GLfloat* uv)
+	{
+		GLuint index = GLuint(batch.verts.size() / floatsPerVertexTotal);
+		batch.verts.insert(batch.verts.end(), { position[0], position[1], position[2],
+			normal[0], normal[1], normal[2], uv[0], uv[1] });
+		return index;
+	}
+
+	// First vertex and vertex count of a batch in the merged mesh data
+	typedef std::pair<GLuint, GLuint> VertexRange;
+
+	// Concatenate the batches into the mesh data with one part per material,
+	// in material order; missingNormals gets the vertices of the batches that
+	// lacked normals
+	void UMergeBatches(const std::vector<Batch>& batches, MeshGen::MeshData& data, std::vector<int>& materialIds, std::vector<VertexRange>& missingNormals)
+	{
+		std::vector<GLuint> baseVertex(batches.size());
+		std::map<int, size_t> materialIndices;
+		size_t nFloats = 0;
+		for (size_t b = 0; b < batches.size(); b++)
+		{
+			baseVertex[b] = GLuint(nFloats / floatsPerVertexTotal);
+			nFloats += batches[b].verts.size();
+			for (const auto& material : batches[b].indices)
+				materialIndices[material.first] += material.second.size();
+			if (batches[b].missingNormals)
+				missingNormals.push_back(VertexRange(baseVertex[b], GLuint(batches[b].verts.size() / floatsPerVertexTotal)));
+		}
+
+		data.verts.reserve(data.verts.size() + nFloats);
+		for (const Batch& batch : batches)
+			data.verts.insert(data.verts.end(), batch.verts.begin(), batch.verts.end());
+
+		for (const auto& material : materialIndices)
+		{
+			MeshGen::MeshPart part;
+			part.firstIndex = GLuint(data.indices.size());
+			part.nIndices = GLuint(material.second);
+			data.indices.reserve(data.indices.size() + material.second);
+			for (size_t b = 0; b < batches.size(); b++)
+			{
+				auto found = batches[b].indices.find(material.first);
+				if (found == batches[b].indices.end())
+					continue;
+				for (GLuint index : found->second)
+					data.indices.push_back(baseVertex[b] + index);
+			}
+			data.parts.push_back(part);
+			materialIds.push_back(material.first);
+		}
+	}
+
+	// Compute normals for the vertices of the batches that lacked them, keeping
+	// the ones the file provided: the whole mesh is computed on a copy and only
+	// those ranges are written back
+	void UComputeMissingNormals(MeshGen::MeshData& data, const std::vector<VertexRange>& missingNormals)
+	{
+		if (missingNormals.empty())
+			return;
+
+		MeshGen::MeshData computed = data;
+		MeshNormals::UComputeNormals(computed);
+		for (const VertexRange& range : missingNormals)
+		{
+			for (GLuint v = range.first; v < range.first + range.second; v++)
+			{
+				size_t normal = size_t(v) * floatsPerVertexTotal + MeshGen::floatsPerVertex;
+				std::copy(computed.verts.begin() + normal, computed.verts.begin() + normal + MeshGen::floatsPerNormal, data.verts.begin() + normal);
+			}
+		}
+	}
+
+	bool UIsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	bool UIsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// Parse a decimal number with optional fraction and exponent at p,
+	// leaving p after it; more than 19 significant digits are dropped
+	bool UParseNumber(const char*& p, const char* end, double& value)
+	{
+		const char* q = p;
+		bool negative = false;
+		if (q < end && (*q == '-' || *q == '+'))
+			negative = *q++ == '-';
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool any = false;
+		for (; q < end && UIsDigit(*q); q++, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*q - '0');
+				digits += mantissa != 0 ? 1 : 0;
+			}
+			else
+				exponent++;
+		}
+		if (q < end && *q == '.')
+		{
+			for (q++; q < end && UIsDigit(*q); q++, any = true)
+			{
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*q - '0');
+					digits += mantissa != 0 ? 1 : 0;
+					exponent--;
+				}
+			}
+		}
+		if (!any)
+			return false;
+
+		if (q < end && (*q == 'e' || *q == 'E'))
+		{
+			const char* e = q + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+				negativeExponent = *e++ == '-';
+			int power = 0;
+			bool exponentDigits = false;
+			for (; e < end && UIsDigit(*e); e++, exponentDigits = true)
+				power = power < 10000 ? power * 10 + (*e - '0') : power;
+			if (exponentDigits)
+			{
+				exponent += negativeExponent ? -power : power;
+				q = e;
+			}
+		}
+
+		double result = double(mantissa);
+		if (exponent != 0 && mantissa != 0)
+			result = exponent < 0 ? result / std::pow(10.0, -exponent) : result * std::pow(10.0, exponent);
+		value = negative ? -result : result;
+		p = q;
+		return true;
+	}
+
+	bool UParseInt(const char*& p, const char* end, long long& value)
+	{
+		const char* q = p;
+		bool negative = false;
+		if (q < end && (*q == '-' || *q == '+'))
+			negative = *q++ == '-';
+		if (q >= end || !UIsDigit(*q))
+			return false;
+
+		long long result = 0;
+		for (; q < end && UIsDigit(*q); q++)
+		{
+			result = result * 10 + (*q - '0');
+			if (result > INT32_MAX)
+				return false;
+		}
+		value = negative ? -result : result;
+		p = q;
+		return true;
+	}
+
+	void USkipSpaces(const char*& p, const char* end)
+	{
+		while (p < end && UIsSpace(*p))
+			p++;
+	}
+
+	//
+	// OBJ
+	//
+
+	// OBJ face corner components: position, texture coords, normal
+	const int OBJ_ELEMENT_KINDS = 3;
+	const GLuint OBJ_ELEMENT_SIZE[OBJ_ELEMENT_KINDS] = { 3, 2, 3 };
+
+	// Component of a corner the face does not give
+	const int OBJ_MISSING = INT32_MIN;
+
+	// One corner of an OBJ face: 0 based indices, or indices relative
+	// to the chunk's first element of the kind (negative OBJ indices)
+	struct ObjCorner
+	{
+		int32_t index[OBJ_ELEMENT_KINDS];
+		unsigned char relative;		// Bit k set: index[k] is relative to the chunk
+	};
+
+	// A run of lines parsed by one task
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+		std::vector<GLfloat> elements[OBJ_ELEMENT_KINDS];	// Positions, texture coords, normals
+		std::vector<ObjCorner> corners;						// 3 per triangle
+		std::vector<std::pair<GLuint, std::string>> usemtl;	// Material changes: first triangle, name
+		std::vector<int> materialIds;						// Material of each usemtl entry
+		int initialMaterial;								// Material in effect at the first line
+		const char* error = nullptr;						// First line that failed to parse
+	};
+
+	bool UParseObjCorner(const char*& p, const char* end, const ObjChunk& chunk, ObjCorner& corner)
+	{
+		corner.relative = 0;
+		for (int k = 0; k < OBJ_ELEMENT_KINDS; k++)
+			corner.index[k] = OBJ_MISSING;
+
+		for (int k = 0; k < OBJ_ELEMENT_KINDS; k++)
+		{
+			if (k > 0)
+			{
+				if (p >= end || *p != '/')
+					break;
+				p++;
+				if (p >= end || *p == '/' || UIsSpace(*p))
+					continue;	// v//vn leaves out the texture coords
+			}
+
+			long long value;
+			if (!UParseInt(p, end, value) || value == 0)
+				return false;
+			if (value > 0)
+				corner.index[k] = int32_t(value - 1);
+			else
+			{
+				long long count = chunk.elements[k].size() / OBJ_ELEMENT_SIZE[k];
+				corner.index[k] = int32_t(count + value);
+				corner.relative |= 1 << k;
+			}
+		}
+		return p >= end || UIsSpace(*p);
+	}
+
+	bool UParseObjLine(const char* p, const char* end, ObjChunk& chunk)
+	{
+		USkipSpaces(p, end);
+		if (p >= end || *p == '#')
+			return true;
+
+		const char* keyword = p;
+		while (p < end && !UIsSpace(*p))
+			p++;
+		size_t keywordLength = p - keyword;
+
+		if (keyword[0] == 'v' && keywordLength <= 2)
+		{
+			int kind = keywordLength == 1 ? 0 : keyword[1] == 't' ? 1 : keyword[1] == 'n' ? 2 : -1;
+			if (kind < 0)
+				return true;
+
+			// extra values (w, vertex colors) are ignored, a missing v of vt is 0
+			for (GLuint c = 0; c < OBJ_ELEMENT_SIZE[kind]; c++)
+			{
+				USkipSpaces(p, end);
+				double value = 0.0;
+				if (!UParseNumber(p, end, value) && !(kind == 1 && c == 1))
+					return false;
+				chunk.elements[kind].push_back(GLfloat(value));
+			}
+			return true;
+		}
+
+		if (keywordLength == 1 && keyword[0] == 'f')
+		{
+			// polygons are split into a fan around their first corner
+			ObjCorner first = {};
+			ObjCorner previous = {};
+			int nCorners = 0;
+			for (USkipSpaces(p, end); p < end && *p != '#'; USkipSpaces(p, end))
+			{
+				ObjCorner corner;
+				if (!UParseObjCorner(p, end, chunk, corner))
+					return false;
+				if (nCorners == 0)
+					first = corner;
+				else if (nCorners >= 2)
+					chunk.corners.insert(chunk.corners.end(), { first, previous, corner });
+				previous = corner;
+				nCorners++;
+			}
+			return true;
+		}
+
+		if (keywordLength == 6 && std::memcmp(keyword, "usemtl", 6) == 0)
+		{
+			USkipSpaces(p, end);
+			const char* nameEnd = end;
+			while (nameEnd > p && UIsSpace(nameEnd[-1]))
+				nameEnd--;
+			chunk.usemtl.emplace_back(GLuint(chunk.corners.size() / 3), std::string(p, nameEnd));
+		}
+
+		// groups, objects, smoothing groups, lines and points are ignored
+		return true;
+	}
+
+	void UParseObjChunk(ObjChunk& chunk)
+	{
+		for (const char* p = chunk.begin; p < chunk.end; )
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+			lineEnd = lineEnd ? lineEnd : chunk.end;
+			if (!UParseObjLine(p, lineEnd, chunk))
+			{
+				chunk.error = p;
+				return;
+			}
+			p = lineEnd + 1;
+		}
+	}
+
+	// Corner key of the vertex cache of one chunk
+	struct ObjCornerKey
+	{
+		int32_t index[OBJ_ELEMENT_KINDS];
+
+		bool operator==(const ObjCornerKey& other) const
+		{
+			return index[0] == other.index[0] && index[1] == other.index[1] && index[2] == other.index[2];
+		}
+	};
+
+	struct ObjCornerHash
+	{
+		size_t operator()(const ObjCornerKey& key) const
+		{
+			return size_t(key.index[0]) * 73856093u ^ size_t(key.index[1]) * 19349663u ^ size_t(key.index[2]) * 83492791u;
+		}
+	};
+
+	// Turn the corners of a chunk into vertices and triangles: relative indices
+	// are made absolute with the element counts of the chunks before it
+	void UBuildObjBatch(const ObjChunk& chunk, const GLuint* base, const std::vector<GLfloat>* elements, Batch& batch)
+	{
+		const GLfloat zero[3] = { 0.0f, 0.0f, 0.0f };
+		GLuint counts[OBJ_ELEMENT_KINDS];
+		for (int k = 0; k < OBJ_ELEMENT_KINDS; k++)
+			counts[k] = GLuint(elements[k].size() / OBJ_ELEMENT_SIZE[k]);
+
+		std::unordered_map<ObjCornerKey, GLuint, ObjCornerHash> cache;
+		int material = chunk.initialMaterial;
+		size_t nextUsemtl = 0;
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			while (nextUsemtl < chunk.usemtl.size() && chunk.usemtl[nextUsemtl].first * 3 <= i)
+				material = chunk.materialIds[nextUsemtl++];
+
+			const ObjCorner& corner = chunk.corners[i];
+			ObjCornerKey key;
+			for (int k = 0; k < OBJ_ELEMENT_KINDS; k++)
+			{
+				int64_t index = corner.index[k];
+				if (index != OBJ_MISSING && (corner.relative & (1 << k)))
+					index += base[k];
+				if (index != OBJ_MISSING && (index < 0 || index >= int64_t(counts[k])))
+				{
+					batch.error = true;
+					return;
+				}
+				key.index[k] = int32_t(index);
+			}
+			if (key.index[0] == OBJ_MISSING)
+			{
+				batch.error = true;
+				return;
+			}
+
+			auto found = cache.find(key);
+			GLuint vertex;
+			if (found != cache.end())
+				vertex = found->second;
+			else
+			{
+				const GLfloat* position = &elements[0][size_t(key.index[0]) * 3];
+				const GLfloat* uv = key.index[1] == OBJ_MISSING ? zero : &elements[1][size_t(key.index[1]) * 2];
+				const GLfloat* normal = key.index[2] == OBJ_MISSING ? zero : &elements[2][size_t(key.index[2]) * 3];
+				batch.missingNormals = batch.missingNormals || key.index[2] == OBJ_MISSING;
+				vertex = UAddBatchVertex(batch, position, normal, uv);
+				cache.emplace(key, vertex);
+			}
+			batch.indices[material].push_back(vertex);
+		}
+	}
+
+	//
+	// glTF
+	//
+
+	// Parsed JSON value, the subset of JSON that glTF uses
+	struct JsonValue
+	{
+		enum Type
+		{
+			JSON_NULL,
+			JSON_BOOL,
+			JSON_NUMBER,
+			JSON_STRING,
+			JSON_ARRAY,
+			JSON_OBJECT
+		};
+
+		Type type = JSON_NULL;
+		double number = 0.0;			// Numbers and booleans
+		std::string string;
+		std::vector<JsonValue> items;	// Array elements or object values
+		std::vector<std::string> keys;	// Object keys, parallel to items
+
+		const JsonValue* Find(const char* key) const
+		{
+			for (size_t i = 0; i < keys.size(); i++)
+				if (keys[i] == key)
+					return &items[i];
+			return nullptr;
+		}
+
+		const JsonValue* At(int index) const
+		{
+			return type == JSON_ARRAY && index >= 0 && size_t(index) < items.size() ? &items[index] : nullptr;
+		}
+
+		double Number(const char* key, double fallback) const
+		{
+			const JsonValue* value = Find(key);
+			return value && value->type == JSON_NUMBER ? value->number : fallback;
+		}
+
+		int Int(const char* key, int fallback) const
+		{
+			return int(Number(key, fallback));
+		}
+	};
+
+	void USkipJsonSpaces(const char*& p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+			p++;
+	}
+
+	void UAppendUtf8(std::string& out, uint32_t code)
+	{
+		if (code < 0x80)
+			out += char(code);
+		else if (code < 0x800)
+		{
+			out += char(0xC0 | (code >> 6));
+			out += char(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			out += char(0xE0 | (code >> 12));
+			out += char(0x80 | ((code >> 6) & 0x3F));
+			out += char(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			out += char(0xF0 | (code >> 18));
+			out += char(0x80 | ((code >> 12) & 0x3F));
+			out += char(0x80 | ((code >> 6) & 0x3F));
+			out += char(0x80 | (code & 0x3F));
+		}
+	}
+
+	// Value of a hex digit, 16 when c is none
+	uint32_t UHexDigit(char c)
+	{
+		return UIsDigit(c) ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+	}
+
+	bool UParseHex4(const char*& p, const char* end, uint32_t& code)
+	{
+		if (end - p < 4)
+			return false;
+		code = 0;
+		for (int i = 0; i < 4; i++, p++)
+		{
+			uint32_t digit = UHexDigit(*p);
+			if (digit > 15)
+				return false;
+			code = code * 16 + digit;
+		}
+		return true;
+	}
+
+	bool UParseJsonString(const char*& p, const char* end, std::string& out)
+	{
+		if (p >= end || *p != '"')
+			return false;
+		for (p++; p < end && *p != '"'; )
+		{
+			if (*p != '\\')
+			{
+				out += *p++;
+				continue;
+			}
+			if (++p >= end)
+				return false;
+			char escape = *p++;
+			switch (escape)
+			{
+			case '"': case '\\': case '/': out += escape; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				uint32_t code;
+				if (!UParseHex4(p, end, code))
+					return false;
+				// surrogate pair
+				uint32_t low;
+				if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+				{
+					p += 2;
+					if (!UParseHex4(p, end, low))
+						return false;
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				UAppendUtf8(out, code);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		if (p >= end)
+			return false;
+		p++;
+		return true;
+	}
+
+	bool UParseJson(const char*& p, const char* end, JsonValue& value, int depth)
+	{
+		USkipJsonSpaces(p, end);
+		if (p >= end || depth > MAX_JSON_DEPTH)
+			return false;
+
+		if (*p == '{' || *p == '[')
+		{
+			bool object = *p == '{';
+			char close = object ? '}' : ']';
+			value.type = object ? JsonValue::JSON_OBJECT : JsonValue::JSON_ARRAY;
+			p++;
+			USkipJsonSpaces(p, end);
+			if (p < end && *p == close)
+			{
+				p++;
+				return true;
+			}
+			while (true)
+			{
+				if (object)
+				{
+					std::string key;
+					USkipJsonSpaces(p, end);
+					if (!UParseJsonString(p, end, key))
+						return false;
+					USkipJsonSpaces(p, end);
+					if (p >= end || *p++ != ':')
+						return false;
+					value.keys.push_back(std::move(key));
+				}
+				value.items.emplace_back();
+				if (!UParseJson(p, end, value.items.back(), depth + 1))
+					return false;
+				USkipJsonSpaces(p, end);
+				if (p >= end)
+					return false;
+				if (*p == close)
+				{
+					p++;
+					return true;
+				}
+				if (*p++ != ',')
+					return false;
+			}
+		}
+
+		if (*p == '"')
+		{
+			value.type = JsonValue::JSON_STRING;
+			return UParseJsonString(p, end, value.string);
+		}
+
+		const char* literals[] = { "true", "false", "null" };
+		for (int i = 0; i < 3; i++)
+		{
+			size_t length = std::strlen(literals[i]);
+			if (size_t(end - p) >= length && std::memcmp(p, literals[i], length) == 0)
+			{
+				value.type = i < 2 ? JsonValue::JSON_BOOL : JsonValue::JSON_NULL;
+				value.number = i == 0 ? 1.0 : 0.0;
+				p += length;
+				return true;
+			}
+		}
+
+		value.type = JsonValue::JSON_NUMBER;
+		return UParseNumber(p, end, value.number);
+	}
+
+	// glTF document with the data of its buffers
+	struct Gltf
+	{
+		JsonValue json;
+		std::vector<const unsigned char*> buffers;
+		std::vector<size_t> bufferSizes;
+		std::vector<std::unique_ptr<MappedFile>> files;	// Buffers in files of their own
+	};
+
+	// Location and encoding of the elements of an accessor
+	struct GltfAccessor
+	{
+		const unsigned char* data;	// First element, null when all zero (no buffer view)
+		size_t count;
+		size_t stride;
+		int componentType;
+		GLuint nComponents;
+		bool normalized;
+	};
+
+	size_t UComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+		case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+		case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	GLuint UTypeComponents(const std::string& type)
+	{
+		return type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+	}
+
+	// Look up an accessor and check that it lies inside its buffer
+	bool UFindAccessor(const Gltf& gltf, int index, GLuint nComponents, GltfAccessor& accessor)
+	{
+		const JsonValue* accessors = gltf.json.Find("accessors");
+		const JsonValue* json = accessors ? accessors->At(index) : nullptr;
+		if (!json || json->Find("sparse"))
+			return false;
+
+		const JsonValue* type = json->Find("type");
+		accessor.componentType = json->Int("componentType", 0);
+		accessor.nComponents = nComponents;
+		accessor.count = size_t(json->Number("count", 0.0));
+		const JsonValue* normalized = json->Find("normalized");
+		accessor.normalized = normalized && normalized->number != 0.0;
+		size_t componentSize = UComponentSize(accessor.componentType);
+		if (!type || UTypeComponents(type->string) != nComponents || componentSize == 0)
+			return false;
+
+		size_t elementSize = componentSize * nComponents;
+		int viewIndex = json->Int("bufferView", -1);
+		if (viewIndex < 0)
+		{
+			accessor.data = nullptr;
+			accessor.stride = elementSize;
+			return true;
+		}
+
+		const JsonValue* views = gltf.json.Find("bufferViews");
+		const JsonValue* view = views ? views->At(viewIndex) : nullptr;
+		if (!view)
+			return false;
+		int buffer = view->Int("buffer", -1);
+		size_t viewOffset = size_t(view->Number("byteOffset", 0.0));
+		size_t viewLength = size_t(view->Number("byteLength", 0.0));
+		size_t offset = size_t(json->Number("byteOffset", 0.0));
+		accessor.stride = size_t(view->Number("byteStride", 0.0));
+		accessor.stride = accessor.stride ? accessor.stride : elementSize;
+		if (buffer < 0 || size_t(buffer) >= gltf.buffers.size() || viewOffset + viewLength > gltf.bufferSizes[buffer])
+			return false;
+		if (accessor.count > 0 && offset + accessor.stride * (accessor.count - 1) + elementSize > viewLength)
+			return false;
+
+		accessor.data = gltf.buffers[buffer] + viewOffset + offset;
+		return true;
+	}
+
+	// Read an accessor as floats, applying the normalization of integer components
+	bool UReadFloats(const Gltf& gltf, int index, GLuint nComponents, std::vector<GLfloat>& out)
+	{
+		GltfAccessor accessor;
+		if (!UFindAccessor(gltf, index, nComponents, accessor))
+			return false;
+
+		out.assign(accessor.count * nComponents, 0.0f);
+		if (!accessor.data)
+			return true;
+
+		size_t componentSize = UComponentSize(accessor.componentType);
+		for (size_t i = 0; i < accessor.count; i++)
+		{
+			const unsigned char* element = accessor.data + i * accessor.stride;
+			for (GLuint c = 0; c < nComponents; c++)
+			{
+				const unsigned char* component = element + c * componentSize;
+				GLfloat value = 0.0f;
+				switch (accessor.componentType)
+				{
+				case GL_FLOAT: { std::memcpy(&value, component, 4); break; }
+				case GL_UNSIGNED_BYTE: { value = accessor.normalized ? component[0] / 255.0f : component[0]; break; }
+				case GL_BYTE: { int8_t v; std::memcpy(&v, component, 1); value = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v; break; }
+				case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, component, 2); value = accessor.normalized ? v / 65535.0f : v; break; }
+				case GL_SHORT: { int16_t v; std::memcpy(&v, component, 2); value = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : v; break; }
+				case GL_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, component, 4); value = GLfloat(v); break; }
+				}
+				out[i * nComponents + c] = value;
+			}
+		}
+		return true;
+	}
+
+	bool UReadIndices(const Gltf& gltf, int index, std::vector<GLuint>& out)
+	{
+		GltfAccessor accessor;
+		if (!UFindAccessor(gltf, index, 1, accessor) || !accessor.data || accessor.componentType == GL_FLOAT)
+			return false;
+
+		out.resize(accessor.count);
+		for (size_t i = 0; i < accessor.count; i++)
+		{
+			const unsigned char* element = accessor.data + i * accessor.stride;
+			switch (accessor.componentType)
+			{
+			case GL_UNSIGNED_BYTE: out[i] = element[0]; break;
+			case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, element, 2); out[i] = v; break; }
+			case GL_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, element, 4); out[i] = v; break; }
+			default: return false;
+			}
+		}
+		return true;
+	}
+
+	// A mesh placed by a node, with the node's world transform
+	struct GltfInstance
+	{
+		int mesh;
+		glm::mat4 transform;
+	};
+
+	// Local transform of a node: its matrix, or translation * rotation * scale
+	glm::mat4 UNodeTransform(const JsonValue& node)
+	{
+		glm::mat4 transform(1.0f);
+		const JsonValue* matrix = node.Find("matrix");
+		if (matrix && matrix->items.size() == 16)
+		{
+			for (int i = 0; i < 16; i++)
+				transform[i / 4][i % 4] = GLfloat(matrix->items[i].number);
+			return transform;
+		}
+
+		const JsonValue* rotation = node.Find("rotation");
+		if (rotation && rotation->items.size() == 4)
+		{
+			float x = GLfloat(rotation->items[0].number);
+			float y = GLfloat(rotation->items[1].number);
+			float z = GLfloat(rotation->items[2].number);
+			float w = GLfloat(rotation->items[3].number);
+			transform[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f);
+			transform[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f);
+			transform[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f);
+		}
+
+		const JsonValue* scale = node.Find("scale");
+		if (scale && scale->items.size() == 3)
+		{
+			for (int i = 0; i < 3; i++)
+				transform[i] *= GLfloat(scale->items[i].number);
+		}
+
+		const JsonValue* translation = node.Find("translation");
+		if (translation && translation->items.size() == 3)
+			transform[3] = glm::vec4(GLfloat(translation->items[0].number), GLfloat(translation->items[1].number), GLfloat(translation->items[2].number), 1.0f);
+		return transform;
+	}
+
+	void UCollectInstances(const JsonValue& nodes, int index, const glm::mat4& parent, int depth, std::vector<GltfInstance>& instances)
+	{
+		const JsonValue* node = nodes.At(index);
+		if (!node || depth > MAX_NODE_DEPTH)
+			return;
+
+		glm::mat4 transform = parent * UNodeTransform(*node);
+		int mesh = node->Int("mesh", -1);
+		if (mesh >= 0)
+			instances.push_back({ mesh, transform });
+
+		const JsonValue* children = node->Find("children");
+		if (children)
+		{
+			for (const JsonValue& child : children->items)
+				UCollectInstances(nodes, int(child.number), transform, depth + 1, instances);
+		}
+	}
+
+	// Decode one primitive of a placed mesh into world space vertices
+	void UBuildGltfBatch(const Gltf& gltf, const GltfInstance& instance, const JsonValue& primitive, Batch& batch)
+	{
+		const GLuint GLTF_TRIANGLES = 4;
+		const JsonValue* attributes = primitive.Find("attributes");
+		if (GLuint(primitive.Int("mode", GLTF_TRIANGLES)) != GLTF_TRIANGLES || !attributes)
+		{
+			batch.skipped = true;
+			return;
+		}
+
+		std::vector<GLfloat> positions, normals, uvs;
+		std::vector<GLuint> indices;
+		int normalAccessor = attributes->Int("NORMAL", -1);
+		int uvAccessor = attributes->Int("TEXCOORD_0", -1);
+		int indexAccessor = primitive.Int("indices", -1);
+		if (!UReadFloats(gltf, attributes->Int("POSITION", -1), 3, positions)
+			|| (normalAccessor >= 0 && !UReadFloats(gltf, normalAccessor, 3, normals))
+			|| (uvAccessor >= 0 && !UReadFloats(gltf, uvAccessor, 2, uvs))
+			|| (indexAccessor >= 0 && !UReadIndices(gltf, indexAccessor, indices)))
+		{
+			batch.error = true;
+			return;
+		}
+
+		size_t nVertices = positions.size() / 3;
+		if ((normalAccessor >= 0 && normals.size() != nVertices * 3) || (uvAccessor >= 0 && uvs.size() != nVertices * 2))
+		{
+			batch.error = true;
+			return;
+		}
+		if (indexAccessor < 0)
+		{
+			indices.resize(nVertices);
+			for (size_t i = 0; i < nVertices; i++)
+				indices[i] = GLuint(i);
+		}
+
+		// normals go through the inverse transpose, mirroring transforms flip the winding
+		glm::mat3 linear(instance.transform);
+		glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(instance.transform)));
+		bool mirrored = glm::dot(glm::cross(linear[0], linear[1]), linear[2]) < 0.0f;
+
+		batch.missingNormals = normalAccessor < 0;
+		batch.verts.reserve(nVertices * floatsPerVertexTotal);
+		for (size_t v = 0; v < nVertices; v++)
+		{
+			glm::vec4 position = instance.transform * glm::vec4(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2], 1.0f);
+			glm::vec3 normal(0.0f);
+			if (!batch.missingNormals)
+			{
+				normal = normalMatrix * glm::vec3(normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]);
+				float length = glm::length(normal);
+				normal = length > 0.0f ? normal / length : normal;
+			}
+
+			// glTF texture coords start at the top of the image, the textures here at the bottom
+			GLfloat uv[2] = { 0.0f, 0.0f };
+			if (uvAccessor >= 0)
+			{
+				uv[0] = uvs[v * 2];
+				uv[1] = 1.0f - uvs[v * 2 + 1];
+			}
+
+			const GLfloat p[3] = { position.x, position.y, position.z };
+			const GLfloat n[3] = { normal.x, normal.y, normal.z };
+			UAddBatchVertex(batch, p, n, uv);
+		}
+
+		std::vector<GLuint>& triangles = batch.indices[primitive.Int("material", MeshImport::NO_MATERIAL)];
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			if (indices[i] >= nVertices || indices[i + 1] >= nVertices || indices[i + 2] >= nVertices)
+			{
+				batch.error = true;
+				return;
+			}
+			if (mirrored)
+				triangles.insert(triangles.end(), { indices[i], indices[i + 2], indices[i + 1] });
+			else
+				triangles.insert(triangles.end(), { indices[i], indices[i + 1], indices[i + 2] });
+		}
+	}
+
+	// Relative buffer uri to a file path: percent escapes decoded
+	std::string UDecodeUri(const std::string& uri)
+	{
+		std::string path;
+		for (size_t i = 0; i < uri.size(); i++)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && UHexDigit(uri[i + 1]) < 16 && UHexDigit(uri[i + 2]) < 16)
+			{
+				path += char(UHexDigit(uri[i + 1]) * 16 + UHexDigit(uri[i + 2]));
+				i += 2;
+			}
+			else
+				path += uri[i];
+		}
+		return path;
+	}
+
+	uint32_t UReadU32(const unsigned char* p)
+	{
+		return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+	}
+
+	bool UHasExtension(const std::string& filename, const char* extension)
+	{
+		size_t length = std::strlen(extension);
+		if (filename.size() < length)
+			return false;
+		for (size_t i = 0; i < length; i++)
+		{
+			char c = filename[filename.size() - length + i];
+			if ((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != extension[i])
+				return false;
+		}
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////
+//	UImport(const char*, MeshData&, std::vector<int>&, Stats&)
+//
+//	filename: .obj, .gltf or .glb file
+//	data: mesh data to fill, one part per material
+//	materialIds: material of each part (usemtl order
+//		for OBJ, material index for glTF, NO_MATERIAL)
+//	stats: filled with the parse statistics
+//
+//	Import an asset file; returns false on errors
+///////////////////////////////////////////////////
+bool MeshImport::UImport(const char* filename, MeshGen::MeshData& data, std::vector<int>& materialIds, Stats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats = Stats();
+
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		// files without bytes cannot be mapped, tell them apart from missing ones
+		std::ifstream probe(filename, std::ios::binary | std::ios::ate);
+		if (probe && probe.tellg() == std::streampos(0))
+			std::cout << "ERROR: Empty file " << filename << std::endl;
+		else
+			std::cout << "ERROR: Could not open " << filename << std::endl;
+		return false;
+	}
+	stats.bytes = file.size;
+
+	bool imported;
+	if (UHasExtension(filename, ".obj"))
+		imported = UImportObj(file, data, materialIds, stats);
+	else if (UHasExtension(filename, ".gltf") || UHasExtension(filename, ".glb"))
+		imported = UImportGltf(filename, file, data, materialIds, stats);
+	else
+	{
+		std::cout << "ERROR: Unsupported mesh file " << filename << " (expected .obj, .gltf or .glb)" << std::endl;
+		return false;
+	}
+
+	if (imported && data.indices.empty())
+	{
+		std::cout << "ERROR: No triangles in " << filename << std::endl;
+		imported = false;
+	}
+	if (!imported)
+		return false;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	stats.milliseconds = elapsed.count();
+	stats.nTriangles = GLuint(data.indices.size() / 3);
+	stats.nParts = GLuint(data.parts.size());
+
+	double megabytes = stats.bytes / BYTES_PER_MB;
+	std::cout << "INFO: Imported " << filename << ": " << stats.nTriangles << " triangles, " << stats.nParts << " materials, "
+		<< megabytes << " MB in " << stats.milliseconds << " ms (" << megabytes * 1000.0 / std::max(stats.milliseconds, 0.001)
+		<< " MB/s on " << stats.nThreads << " threads)" << std::endl;
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UImportObj(const MappedFile&, MeshData&, std::vector<int>&, Stats&)
+//
+//	Parse an OBJ file in chunks of whole lines: each chunk
+//	collects its elements and faces in parallel, then the
+//	element counts before each chunk resolve the relative
+//	indices and the chunks build their vertices in parallel.
+//	Materials are numbered in order of their first usemtl.
+///////////////////////////////////////////////////
+bool MeshImport::UImportObj(const MappedFile& file, MeshGen::MeshData& data, std::vector<int>& materialIds, Stats& stats)
+{
+	const char* text = reinterpret_cast<const char*>(file.data);
+	const char* textEnd = text + file.size;
+	stats.nThreads = UThreadCount(file.size);
+
+	// split at line starts
+	GLuint nChunks = stats.nThreads == 1 ? 1 : stats.nThreads * OBJ_CHUNKS_PER_THREAD;
+	std::vector<ObjChunk> chunks(nChunks);
+	const char* begin = text;
+	for (GLuint c = 0; c < nChunks; c++)
+	{
+		const char* end = std::max(begin, text + file.size / nChunks * (c + 1));
+		const char* newline = end < textEnd ? static_cast<const char*>(std::memchr(end, '\n', textEnd - end)) : nullptr;
+		end = c + 1 == nChunks || !newline ? textEnd : newline + 1;
+		chunks[c].begin = begin;
+		chunks[c].end = end;
+		begin = end;
+	}
+
+	UParallelFor(nChunks, stats.nThreads, [&](GLuint c) { UParseObjChunk(chunks[c]); });
+
+	// element counts before each chunk, and the material in effect at its start
+	std::vector<GLuint> base(nChunks * OBJ_ELEMENT_KINDS);
+	GLuint totals[OBJ_ELEMENT_KINDS] = { 0, 0, 0 };
+	std::map<std::string, int> materials;
+	int material = NO_MATERIAL;
+	for (GLuint c = 0; c < nChunks; c++)
+	{
+		ObjChunk& chunk = chunks[c];
+		if (chunk.error)
+		{
+			std::cout << "ERROR: OBJ parse error at byte " << (chunk.error - text) << std::endl;
+			return false;
+		}
+
+		for (int k = 0; k < OBJ_ELEMENT_KINDS; k++)
+		{
+			base[c * OBJ_ELEMENT_KINDS + k] = totals[k];
+			totals[k] += GLuint(chunk.elements[k].size() / OBJ_ELEMENT_SIZE[k]);
+		}
+
+		chunk.initialMaterial = material;
+		for (const auto& usemtl : chunk.usemtl)
+		{
+			material = materials.emplace(usemtl.second, int(materials.size())).first->second;
+			chunk.materialIds.push_back(material);
+		}
+	}
+
+	// gather the elements of all chunks, each chunk copying its own
+	std::vector<GLfloat> elements[OBJ_ELEMENT_KINDS];
+	for (int k = 0; k < OBJ_ELEMENT_KINDS; k++)
+		elements[k].resize(size_t(totals[k]) * OBJ_ELEMENT_SIZE[k]);
+	UParallelFor(nChunks, stats.nThreads, [&](GLuint c)
+	{
+		for (int k = 0; k < OBJ_ELEMENT_KINDS; k++)
+		{
+			const std::vector<GLfloat>& chunkElements = chunks[c].elements[k];
+			if (!chunkElements.empty())
+				std::memcpy(&elements[k][size_t(base[c * OBJ_ELEMENT_KINDS + k]) * OBJ_ELEMENT_SIZE[k]], chunkElements.data(), chunkElements.size() * sizeof(GLfloat));
+		}
+	});
+
+	std::vector<Batch> batches(nChunks);
+	UParallelFor(nChunks, stats.nThreads, [&](GLuint c) { UBuildObjBatch(chunks[c], &base[c * OBJ_ELEMENT_KINDS], elements, batches[c]); });
+	for (const Batch& batch : batches)
+	{
+		if (batch.error)
+		{
+			std::cout << "ERROR: OBJ face refers to a missing vertex" << std::endl;
+			return false;
+		}
+	}
+
+	std::vector<VertexRange> missingNormals;
+	UMergeBatches(batches, data, materialIds, missingNormals);
+	UComputeMissingNormals(data, missingNormals);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UImportGltf(const char*, const MappedFile&, MeshData&, std::vector<int>&, Stats&)
+//
+//	Read the JSON of a .gltf file or .glb container, map
+//	its buffers (the GLB binary chunk or local files) and
+//	decode the triangle primitives of every mesh the
+//	default scene places, in parallel, baking the node
+//	transforms into the vertices
+///////////////////////////////////////////////////
+bool MeshImport::UImportGltf(const char* filename, const MappedFile& file, MeshGen::MeshData& data, std::vector<int>& materialIds, Stats& stats)
+{
+	const unsigned char* json = file.data;
+	size_t jsonSize = file.size;
+	const unsigned char* bin = nullptr;
+	size_t binSize = 0;
+
+	// binary container: 12 byte header, then the JSON and binary chunks
+	const uint32_t GLB_MAGIC = 0x46546C67;
+	const uint32_t GLB_JSON = 0x4E4F534A;
+	const uint32_t GLB_BIN = 0x004E4942;
+	if (file.size >= 12 && UReadU32(file.data) == GLB_MAGIC)
+	{
+		size_t length = std::min(size_t(UReadU32(file.data + 8)), file.size);
+		json = nullptr;
+		for (size_t offset = 12; offset + 8 <= length; )
+		{
+			size_t chunkLength = UReadU32(file.data + offset);
+			uint32_t chunkType = UReadU32(file.data + offset + 4);
+			if (offset + 8 + chunkLength > length)
+				break;
+			if (chunkType == GLB_JSON && !json)
+			{
+				json = file.data + offset + 8;
+				jsonSize = chunkLength;
+			}
+			else if (chunkType == GLB_BIN && !bin)
+			{
+				bin = file.data + offset + 8;
+				binSize = chunkLength;
+			}
+			offset += 8 + chunkLength;
+		}
+		if (UReadU32(file.data + 4) != 2 || !json)
+		{
+			std::cout << "ERROR: " << filename << " is not a glTF 2.0 binary file" << std::endl;
+			return false;
+		}
+	}
+
+	Gltf gltf;
+	const char* p = reinterpret_cast<const char*>(json);
+	const JsonValue* asset = nullptr;
+	const JsonValue* version = nullptr;
+	if (!UParseJson(p, p + jsonSize, gltf.json, 0) || !(asset = gltf.json.Find("asset"))
+		|| !(version = asset->Find("version")) || version->string.compare(0, 2, "2.") != 0)
+	{
+		std::cout << "ERROR: " << filename << " is not a glTF 2.0 file" << std::endl;
+		return false;
+	}
+
+	// buffers: the GLB binary chunk or files next to the .gltf
+	std::string filePath(filename);
+	size_t slash = filePath.find_last_of("/\\");
+	std::string directory = slash == std::string::npos ? std::string() : filePath.substr(0, slash + 1);
+	const JsonValue* buffers = gltf.json.Find("buffers");
+	for (size_t i = 0; buffers && i < buffers->items.size(); i++)
+	{
+		const JsonValue& buffer = buffers->items[i];
+		const JsonValue* uri = buffer.Find("uri");
+		size_t byteLength = size_t(buffer.Number("byteLength", 0.0));
+		if (!uri)
+		{
+			if (i != 0 || !bin || binSize < byteLength)
+			{
+				std::cout << "ERROR: glTF buffer " << i << " has no data" << std::endl;
+				return false;
+			}
+			gltf.buffers.push_back(bin);
+			gltf.bufferSizes.push_back(binSize);
+			continue;
+		}
+		if (uri->string.compare(0, 5, "data:") == 0)
+		{
+			std::cout << "ERROR: glTF buffer " << i << " is embedded as a data uri, export it as a separate file" << std::endl;
+			return false;
+		}
+
+		std::string path = directory + UDecodeUri(uri->string);
+		gltf.files.emplace_back(new MappedFile());
+		if (!gltf.files.back()->Open(path.c_str()) || gltf.files.back()->size < byteLength)
+		{
+			std::cout << "ERROR: Could not open glTF buffer " << path << std::endl;
+			return false;
+		}
+		gltf.buffers.push_back(gltf.files.back()->data);
+		gltf.bufferSizes.push_back(gltf.files.back()->size);
+		stats.bytes += gltf.files.back()->size;
+	}
+
+	// meshes placed by the nodes of the default scene, or every mesh once without scenes
+	std::vector<GltfInstance> instances;
+	const JsonValue* scenes = gltf.json.Find("scenes");
+	const JsonValue* nodes = gltf.json.Find("nodes");
+	const JsonValue* meshes = gltf.json.Find("meshes");
+	const JsonValue* scene = scenes ? scenes->At(gltf.json.Int("scene", 0)) : nullptr;
+	const JsonValue* roots = scene ? scene->Find("nodes") : nullptr;
+	if (roots && nodes)
+	{
+		for (const JsonValue& root : roots->items)
+			UCollectInstances(*nodes, int(root.number), glm::mat4(1.0f), 0, instances);
+	}
+	else if (meshes)
+	{
+		for (size_t m = 0; m < meshes->items.size(); m++)
+			instances.push_back({ int(m), glm::mat4(1.0f) });
+	}
+
+	// one task per primitive of each instance
+	std::vector<std::pair<const GltfInstance*, const JsonValue*>> tasks;
+	for (const GltfInstance& instance : instances)
+	{
+		const JsonValue* mesh = meshes ? meshes->At(instance.mesh) : nullptr;
+		const JsonValue* primitives = mesh ? mesh->Find("primitives") : nullptr;
+		for (size_t i = 0; primitives && i < primitives->items.size(); i++)
+			tasks.emplace_back(&instance, &primitives->items[i]);
+	}
+
+	stats.nThreads = UThreadCount(stats.bytes);
+	std::vector<Batch> batches(tasks.size());
+	UParallelFor(GLuint(tasks.size()), stats.nThreads, [&](GLuint t) { UBuildGltfBatch(gltf, *tasks[t].first, *tasks[t].second, batches[t]); });
+
+	bool skipped = false;
+	for (const Batch& batch : batches)
+	{
+		if (batch.error)
+		{
+			std::cout << "ERROR: glTF primitive with invalid or unsupported accessors in " << filename << std::endl;
+			return false;
+		}
+		skipped = skipped || batch.skipped;
+	}
+	if (skipped)
+		std::cout << "INFO: Skipped glTF primitives that are not triangle lists in " << filename << std::endl;
+
+	std::vector<VertexRange> missingNormals;
+	UMergeBatches(batches, data, materialIds, missingNormals);
+	UComputeMissingNormals(data, missingNormals);
+	return true;
+}
+
+// threads for a file: one per MIN_THREAD_BYTES, at most one per core
+GLuint MeshImport::UThreadCount(size_t bytes)
+{
+	GLuint cores = std::max(1u, std::thread::hardware_concurrency());
+	size_t threads = std::max(size_t(1), bytes / MIN_THREAD_BYTES);
+	return GLuint(std::min(size_t(cores), threads));
+}
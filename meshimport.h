@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimport.h
+// ========
+// importer for exported assets: Wavefront OBJ and glTF 2.0 (.gltf with
+// local buffer files, or binary .glb)
+//
+// The file is memory mapped and parsed on all cores: an OBJ file is split
+// into chunks at line boundaries that are parsed in parallel, a glTF file
+// decodes its primitives in parallel after reading the JSON. The result is
+// mesh data with the interleaved layout of the generators, with one part
+// per material and the material of each part.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "mappedfile.h"
+#include "meshgen.h"
+
+class MeshImport
+{
+
+public:
+
+	// Material of the triangles without one
+	static const int NO_MATERIAL = -1;
+
+	// Parse statistics of an import
+	struct Stats
+	{
+		size_t bytes;			// File and buffer bytes parsed
+		double milliseconds;	// Parse time, up to the finished mesh data
+		GLuint nThreads;		// Worker threads used
+		GLuint nTriangles;
+		GLuint nParts;
+	};
+
+public:
+	static bool UImport(const char *filename, MeshGen::MeshData &data, std::vector<int> &materialIds, Stats &stats);
+
+private:
+	static bool UImportObj(const MappedFile &file, MeshGen::MeshData &data, std::vector<int> &materialIds, Stats &stats);
+	static bool UImportGltf(const char *filename, const MappedFile &file, MeshGen::MeshData &data, std::vector<int> &materialIds, Stats &stats);
+	static GLuint UThreadCount(size_t bytes);
+};
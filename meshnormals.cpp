@@ -0,0 +1,600 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshnormals.cpp
+// ========
+// batch vertex normal generation over a whole mesh with scalar, SSE and AVX
+// kernels over structure of arrays positions
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshnormals.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MESHNORMALS_SSE
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MESHNORMALS_TARGET_AVX
+#else
+#include <cpuid.h>
+#define MESHNORMALS_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace
+{
+	const float PI = 3.14159265358979323846f;
+
+	// Contribution of one triangle: its normal scaled per corner
+	inline void UScatter(float* nx, float* ny, float* nz, const GLuint* triangle,
+		float cx, float cy, float cz, float s0, float s1, float s2)
+	{
+		GLuint i0 = triangle[0];
+		GLuint i1 = triangle[1];
+		GLuint i2 = triangle[2];
+		nx[i0] += cx * s0; ny[i0] += cy * s0; nz[i0] += cz * s0;
+		nx[i1] += cx * s1; ny[i1] += cy * s1; nz[i1] += cz * s1;
+		nx[i2] += cx * s2; ny[i2] += cy * s2; nz[i2] += cz * s2;
+	}
+
+	// Reference kernel. The cross product of two edges is the face normal
+	// scaled by twice the area, so area weighting adds it unchanged; angle
+	// weighting normalizes it and scales it by the angle at each corner.
+	void UAccumulateScalar(const float* x, const float* y, const float* z, const GLuint* indices,
+		size_t first, size_t end, bool angleWeighted, float* nx, float* ny, float* nz)
+	{
+		for (size_t t = first; t < end; t++)
+		{
+			const GLuint* triangle = indices + 3 * t;
+			GLuint i0 = triangle[0];
+			GLuint i1 = triangle[1];
+			GLuint i2 = triangle[2];
+
+			float e1x = x[i1] - x[i0], e1y = y[i1] - y[i0], e1z = z[i1] - z[i0];
+			float e2x = x[i2] - x[i0], e2y = y[i2] - y[i0], e2z = z[i2] - z[i0];
+			float cx = e1y * e2z - e1z * e2y;
+			float cy = e1z * e2x - e1x * e2z;
+			float cz = e1x * e2y - e1y * e2x;
+
+			if (!angleWeighted)
+			{
+				UScatter(nx, ny, nz, triangle, cx, cy, cz, 1.0f, 1.0f, 1.0f);
+				continue;
+			}
+
+			float length = std::sqrt(cx * cx + cy * cy + cz * cz);
+			if (length == 0.0f)
+				continue;
+
+			float e3x = x[i2] - x[i1], e3y = y[i2] - y[i1], e3z = z[i2] - z[i1];
+			float l1 = std::sqrt(e1x * e1x + e1y * e1y + e1z * e1z);
+			float l2 = std::sqrt(e2x * e2x + e2y * e2y + e2z * e2z);
+			float l3 = std::sqrt(e3x * e3x + e3y * e3y + e3z * e3z);
+			float cos0 = (e1x * e2x + e1y * e2y + e1z * e2z) / (l1 * l2);
+			float cos1 = -(e1x * e3x + e1y * e3y + e1z * e3z) / (l1 * l3);
+			float a0 = std::acos(std::max(-1.0f, std::min(1.0f, cos0)));
+			float a1 = std::acos(std::max(-1.0f, std::min(1.0f, cos1)));
+			float a2 = std::max(0.0f, PI - a0 - a1);
+
+			float inverse = 1.0f / length;
+			UScatter(nx, ny, nz, triangle, cx, cy, cz, a0 * inverse, a1 * inverse, a2 * inverse);
+		}
+	}
+
+	void UNormalizeScalar(float* nx, float* ny, float* nz, size_t first, size_t end)
+	{
+		for (size_t v = first; v < end; v++)
+		{
+			float length = std::sqrt(nx[v] * nx[v] + ny[v] * ny[v] + nz[v] * nz[v]);
+			float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+			nx[v] *= inverse;
+			ny[v] *= inverse;
+			nz[v] *= inverse;
+		}
+	}
+
+#ifdef MESHNORMALS_SSE
+	// Abramowitz & Stegun 4.4.45, |error| < 7e-5 radians, c in [-1, 1]
+	inline __m128 UAcosSse(__m128 c)
+	{
+		__m128 a = _mm_andnot_ps(_mm_set1_ps(-0.0f), c);
+		__m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0187293f), a), _mm_set1_ps(0.0742610f));
+		p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(-0.2121144f));
+		p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(1.5707288f));
+		__m128 r = _mm_mul_ps(p, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), a)));
+
+		// acos(-c) = pi - acos(c)
+		__m128 negative = _mm_cmplt_ps(c, _mm_setzero_ps());
+		return _mm_or_ps(_mm_andnot_ps(negative, r), _mm_and_ps(negative, _mm_sub_ps(_mm_set1_ps(PI), r)));
+	}
+
+	// One coordinate of one corner of 4 consecutive triangles
+	inline __m128 UGatherSse(const float* values, const GLuint* triangles, int corner)
+	{
+		return _mm_setr_ps(values[triangles[corner]], values[triangles[3 + corner]],
+			values[triangles[6 + corner]], values[triangles[9 + corner]]);
+	}
+
+	void UAccumulateSse(const float* x, const float* y, const float* z, const GLuint* indices,
+		size_t nTriangles, bool angleWeighted, float* nx, float* ny, float* nz)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 tiny = _mm_set1_ps(1e-30f);
+
+		size_t end = nTriangles & ~size_t(3);
+		for (size_t t = 0; t < end; t += 4)
+		{
+			const GLuint* triangles = indices + 3 * t;
+			__m128 x0 = UGatherSse(x, triangles, 0), y0 = UGatherSse(y, triangles, 0), z0 = UGatherSse(z, triangles, 0);
+			__m128 x1 = UGatherSse(x, triangles, 1), y1 = UGatherSse(y, triangles, 1), z1 = UGatherSse(z, triangles, 1);
+			__m128 x2 = UGatherSse(x, triangles, 2), y2 = UGatherSse(y, triangles, 2), z2 = UGatherSse(z, triangles, 2);
+
+			__m128 e1x = _mm_sub_ps(x1, x0), e1y = _mm_sub_ps(y1, y0), e1z = _mm_sub_ps(z1, z0);
+			__m128 e2x = _mm_sub_ps(x2, x0), e2y = _mm_sub_ps(y2, y0), e2z = _mm_sub_ps(z2, z0);
+			__m128 cx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+			__m128 cy = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+			__m128 cz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+			alignas(16) float s[3][4];
+			if (angleWeighted)
+			{
+				__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz)));
+				__m128 inverse = _mm_and_ps(_mm_div_ps(one, _mm_max_ps(length, tiny)), _mm_cmpgt_ps(length, zero));
+
+				__m128 e3x = _mm_sub_ps(x2, x1), e3y = _mm_sub_ps(y2, y1), e3z = _mm_sub_ps(z2, z1);
+				__m128 l1 = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e1x), _mm_mul_ps(e1y, e1y)), _mm_mul_ps(e1z, e1z)));
+				__m128 l2 = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e2x), _mm_mul_ps(e2y, e2y)), _mm_mul_ps(e2z, e2z)));
+				__m128 l3 = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e3x, e3x), _mm_mul_ps(e3y, e3y)), _mm_mul_ps(e3z, e3z)));
+				__m128 d12 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e2x), _mm_mul_ps(e1y, e2y)), _mm_mul_ps(e1z, e2z));
+				__m128 d13 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e3x), _mm_mul_ps(e1y, e3y)), _mm_mul_ps(e1z, e3z));
+				__m128 cos0 = _mm_div_ps(d12, _mm_max_ps(_mm_mul_ps(l1, l2), tiny));
+				__m128 cos1 = _mm_div_ps(_mm_sub_ps(zero, d13), _mm_max_ps(_mm_mul_ps(l1, l3), tiny));
+				cos0 = _mm_max_ps(_mm_set1_ps(-1.0f), _mm_min_ps(one, cos0));
+				cos1 = _mm_max_ps(_mm_set1_ps(-1.0f), _mm_min_ps(one, cos1));
+
+				__m128 a0 = UAcosSse(cos0);
+				__m128 a1 = UAcosSse(cos1);
+				__m128 a2 = _mm_max_ps(zero, _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(PI), a0), a1));
+				_mm_store_ps(s[0], _mm_mul_ps(a0, inverse));
+				_mm_store_ps(s[1], _mm_mul_ps(a1, inverse));
+				_mm_store_ps(s[2], _mm_mul_ps(a2, inverse));
+			}
+			else
+			{
+				_mm_store_ps(s[0], one);
+				_mm_store_ps(s[1], one);
+				_mm_store_ps(s[2], one);
+			}
+
+			alignas(16) float c[3][4];
+			_mm_store_ps(c[0], cx);
+			_mm_store_ps(c[1], cy);
+			_mm_store_ps(c[2], cz);
+
+			// triangles of a batch may share vertices, so the scatter stays scalar
+			for (int lane = 0; lane < 4; lane++)
+				UScatter(nx, ny, nz, triangles + 3 * lane, c[0][lane], c[1][lane], c[2][lane], s[0][lane], s[1][lane], s[2][lane]);
+		}
+
+		UAccumulateScalar(x, y, z, indices, end, nTriangles, angleWeighted, nx, ny, nz);
+	}
+
+	void UNormalizeSse(float* nx, float* ny, float* nz, size_t nVertices)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		size_t end = nVertices & ~size_t(3);
+		for (size_t v = 0; v < end; v += 4)
+		{
+			__m128 x = _mm_loadu_ps(nx + v);
+			__m128 y = _mm_loadu_ps(ny + v);
+			__m128 z = _mm_loadu_ps(nz + v);
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			__m128 inverse = _mm_and_ps(_mm_div_ps(one, length), _mm_cmpgt_ps(length, zero));
+			_mm_storeu_ps(nx + v, _mm_mul_ps(x, inverse));
+			_mm_storeu_ps(ny + v, _mm_mul_ps(y, inverse));
+			_mm_storeu_ps(nz + v, _mm_mul_ps(z, inverse));
+		}
+
+		UNormalizeScalar(nx, ny, nz, end, nVertices);
+	}
+
+	MESHNORMALS_TARGET_AVX inline __m256 UAcosAvx(__m256 c)
+	{
+		__m256 a = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), c);
+		__m256 p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-0.0187293f), a), _mm256_set1_ps(0.0742610f));
+		p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(-0.2121144f));
+		p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(1.5707288f));
+		__m256 r = _mm256_mul_ps(p, _mm256_sqrt_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), a)));
+
+		__m256 negative = _mm256_cmp_ps(c, _mm256_setzero_ps(), _CMP_LT_OQ);
+		return _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(PI), r), negative);
+	}
+
+	// One coordinate of one corner of 8 consecutive triangles
+	MESHNORMALS_TARGET_AVX inline __m256 UGatherAvx(const float* values, const GLuint* triangles, int corner)
+	{
+		return _mm256_setr_ps(values[triangles[corner]], values[triangles[3 + corner]],
+			values[triangles[6 + corner]], values[triangles[9 + corner]],
+			values[triangles[12 + corner]], values[triangles[15 + corner]],
+			values[triangles[18 + corner]], values[triangles[21 + corner]]);
+	}
+
+	MESHNORMALS_TARGET_AVX void UAccumulateAvx(const float* x, const float* y, const float* z, const GLuint* indices,
+		size_t nTriangles, bool angleWeighted, float* nx, float* ny, float* nz)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 tiny = _mm256_set1_ps(1e-30f);
+
+		size_t end = nTriangles & ~size_t(7);
+		for (size_t t = 0; t < end; t += 8)
+		{
+			const GLuint* triangles = indices + 3 * t;
+			__m256 x0 = UGatherAvx(x, triangles, 0), y0 = UGatherAvx(y, triangles, 0), z0 = UGatherAvx(z, triangles, 0);
+			__m256 x1 = UGatherAvx(x, triangles, 1), y1 = UGatherAvx(y, triangles, 1), z1 = UGatherAvx(z, triangles, 1);
+			__m256 x2 = UGatherAvx(x, triangles, 2), y2 = UGatherAvx(y, triangles, 2), z2 = UGatherAvx(z, triangles, 2);
+
+			__m256 e1x = _mm256_sub_ps(x1, x0), e1y = _mm256_sub_ps(y1, y0), e1z = _mm256_sub_ps(z1, z0);
+			__m256 e2x = _mm256_sub_ps(x2, x0), e2y = _mm256_sub_ps(y2, y0), e2z = _mm256_sub_ps(z2, z0);
+			__m256 cx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e1z, e2y));
+			__m256 cy = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e1x, e2z));
+			__m256 cz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e1y, e2x));
+
+			alignas(32) float s[3][8];
+			if (angleWeighted)
+			{
+				__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz)));
+				__m256 inverse = _mm256_and_ps(_mm256_div_ps(one, _mm256_max_ps(length, tiny)), _mm256_cmp_ps(length, zero, _CMP_GT_OQ));
+
+				__m256 e3x = _mm256_sub_ps(x2, x1), e3y = _mm256_sub_ps(y2, y1), e3z = _mm256_sub_ps(z2, z1);
+				__m256 l1 = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, e1x), _mm256_mul_ps(e1y, e1y)), _mm256_mul_ps(e1z, e1z)));
+				__m256 l2 = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, e2x), _mm256_mul_ps(e2y, e2y)), _mm256_mul_ps(e2z, e2z)));
+				__m256 l3 = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e3x, e3x), _mm256_mul_ps(e3y, e3y)), _mm256_mul_ps(e3z, e3z)));
+				__m256 d12 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, e2x), _mm256_mul_ps(e1y, e2y)), _mm256_mul_ps(e1z, e2z));
+				__m256 d13 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, e3x), _mm256_mul_ps(e1y, e3y)), _mm256_mul_ps(e1z, e3z));
+				__m256 cos0 = _mm256_div_ps(d12, _mm256_max_ps(_mm256_mul_ps(l1, l2), tiny));
+				__m256 cos1 = _mm256_div_ps(_mm256_sub_ps(zero, d13), _mm256_max_ps(_mm256_mul_ps(l1, l3), tiny));
+				cos0 = _mm256_max_ps(_mm256_set1_ps(-1.0f), _mm256_min_ps(one, cos0));
+				cos1 = _mm256_max_ps(_mm256_set1_ps(-1.0f), _mm256_min_ps(one, cos1));
+
+				__m256 a0 = UAcosAvx(cos0);
+				__m256 a1 = UAcosAvx(cos1);
+				__m256 a2 = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(PI), a0), a1));
+				_mm256_store_ps(s[0], _mm256_mul_ps(a0, inverse));
+				_mm256_store_ps(s[1], _mm256_mul_ps(a1, inverse));
+				_mm256_store_ps(s[2], _mm256_mul_ps(a2, inverse));
+			}
+			else
+			{
+				_mm256_store_ps(s[0], one);
+				_mm256_store_ps(s[1], one);
+				_mm256_store_ps(s[2], one);
+			}
+
+			alignas(32) float c[3][8];
+			_mm256_store_ps(c[0], cx);
+			_mm256_store_ps(c[1], cy);
+			_mm256_store_ps(c[2], cz);
+
+			for (int lane = 0; lane < 8; lane++)
+				UScatter(nx, ny, nz, triangles + 3 * lane, c[0][lane], c[1][lane], c[2][lane], s[0][lane], s[1][lane], s[2][lane]);
+		}
+
+		UAccumulateScalar(x, y, z, indices, end, nTriangles, angleWeighted, nx, ny, nz);
+	}
+
+	MESHNORMALS_TARGET_AVX void UNormalizeAvx(float* nx, float* ny, float* nz, size_t nVertices)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		size_t end = nVertices & ~size_t(7);
+		for (size_t v = 0; v < end; v += 8)
+		{
+			__m256 x = _mm256_loadu_ps(nx + v);
+			__m256 y = _mm256_loadu_ps(ny + v);
+			__m256 z = _mm256_loadu_ps(nz + v);
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+			__m256 inverse = _mm256_and_ps(_mm256_div_ps(one, length), _mm256_cmp_ps(length, zero, _CMP_GT_OQ));
+			_mm256_storeu_ps(nx + v, _mm256_mul_ps(x, inverse));
+			_mm256_storeu_ps(ny + v, _mm256_mul_ps(y, inverse));
+			_mm256_storeu_ps(nz + v, _mm256_mul_ps(z, inverse));
+		}
+
+		UNormalizeScalar(nx, ny, nz, end, nVertices);
+	}
+
+	// AVX needs both the instructions and the OS saving the YMM registers
+	bool UCpuHasAvx()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		bool avx = (info[2] & (1 << 28)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		return avx && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+		unsigned int eax, ebx, ecx, edx;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_AVX) || !(ecx & bit_OSXSAVE))
+			return false;
+		unsigned int xcr0Low, xcr0High;
+		__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+		return (xcr0Low & 6) == 6;
+#endif
+	}
+#endif
+}
+
+///////////////////////////////////////////////////
+//	UComputeNormals(MeshData&, Weighting, float, Kernel)
+//
+//	data: mesh data whose normals are replaced
+//	weighting: contribution of each triangle to its corners
+//	creaseAngle: vertices at the same position whose normals
+//		differ by less than this (degrees) are smoothed together,
+//		0 keeps every vertex to its own triangles
+//	kernel: implementation, KERNEL_AUTO picks the widest one
+//
+//	Recompute every vertex normal from the triangles: face
+//	normals are summed into their corners with the given
+//	weights and normalized. Vertices split only for their
+//	texture coords (seams) are joined by the crease angle.
+///////////////////////////////////////////////////
+void MeshNormals::UComputeNormals(MeshGen::MeshData& data, Weighting weighting, float creaseAngle, Kernel kernel)
+{
+	const GLuint stride = MeshGen::floatsPerVertexTotal;
+	size_t nVertices = data.VertexCount();
+
+	if (kernel == KERNEL_AUTO)
+		kernel = UKernelSupported(KERNEL_AVX) ? KERNEL_AVX : UKernelSupported(KERNEL_SSE) ? KERNEL_SSE : KERNEL_SCALAR;
+	else if (!UKernelSupported(kernel))
+		kernel = KERNEL_SCALAR;
+
+	Streams positions;
+	positions.x.resize(nVertices);
+	positions.y.resize(nVertices);
+	positions.z.resize(nVertices);
+	for (size_t v = 0; v < nVertices; v++)
+	{
+		positions.x[v] = data.verts[v * stride];
+		positions.y[v] = data.verts[v * stride + 1];
+		positions.z[v] = data.verts[v * stride + 2];
+	}
+
+	Streams normals;
+	normals.x.assign(nVertices, 0.0f);
+	normals.y.assign(nVertices, 0.0f);
+	normals.z.assign(nVertices, 0.0f);
+
+	UAccumulate(positions, data.indices, weighting, kernel, normals);
+	if (creaseAngle > 0.0f)
+		UMergeCreases(positions, creaseAngle, normals);
+	UNormalize(kernel, normals);
+
+	for (size_t v = 0; v < nVertices; v++)
+	{
+		data.verts[v * stride + MeshGen::floatsPerVertex] = normals.x[v];
+		data.verts[v * stride + MeshGen::floatsPerVertex + 1] = normals.y[v];
+		data.verts[v * stride + MeshGen::floatsPerVertex + 2] = normals.z[v];
+	}
+}
+
+///////////////////////////////////////////////////
+//	UBenchmark(GLuint)
+//
+//	nTriangles: approximate size of the test mesh
+//
+//	Time every supported kernel on a generated torus
+//	and report the speedup and the largest deviation
+//	from the scalar normals
+///////////////////////////////////////////////////
+void MeshNormals::UBenchmark(GLuint nTriangles)
+{
+	const int runs = 5;
+	const GLuint stride = MeshGen::floatsPerVertexTotal;
+
+	int tubeSegments = std::max(3, int(std::sqrt(nTriangles / 2.0)));
+	int mainSegments = std::max(3, int(nTriangles / (2 * tubeSegments)));
+
+	MeshGen::MeshData data;
+	MeshGen::UGenerateTorus(data, mainSegments, tubeSegments);
+	std::cout << "INFO: Normals benchmark: " << data.indices.size() / 3 << " triangles, "
+		<< data.VertexCount() << " vertices, best of " << runs << " runs" << std::endl;
+
+	const Weighting weightings[] = { WEIGHT_AREA, WEIGHT_ANGLE };
+	const Kernel kernels[] = { KERNEL_SCALAR, KERNEL_SSE, KERNEL_AVX };
+	for (Weighting weighting : weightings)
+	{
+		std::vector<GLfloat> reference;
+		double scalarMs = 0.0;
+
+		for (Kernel kernel : kernels)
+		{
+			if (!UKernelSupported(kernel))
+			{
+				std::cout << "INFO: Normals " << UKernelName(kernel) << ": not supported by this CPU" << std::endl;
+				continue;
+			}
+
+			double bestMs = 0.0;
+			for (int run = 0; run < runs; run++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				UComputeNormals(data, weighting, 0.0f, kernel);
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				bestMs = run == 0 ? ms : std::min(bestMs, ms);
+			}
+
+			// deviation from the scalar normals in degrees
+			double maxDegrees = 0.0;
+			if (kernel == KERNEL_SCALAR)
+			{
+				reference = data.verts;
+				scalarMs = bestMs;
+			}
+			else
+			{
+				// atan2 stays accurate for the tiny angles where acos of the dot product does not
+				for (size_t v = MeshGen::floatsPerVertex; v < data.verts.size(); v += stride)
+				{
+					glm::dvec3 normal(data.verts[v], data.verts[v + 1], data.verts[v + 2]);
+					glm::dvec3 expected(reference[v], reference[v + 1], reference[v + 2]);
+					double angle = std::atan2(glm::length(glm::cross(normal, expected)), glm::dot(normal, expected));
+					maxDegrees = std::max(maxDegrees, angle * 180.0 / PI);
+				}
+			}
+
+			std::cout << "INFO: Normals " << (weighting == WEIGHT_AREA ? "area" : "angle") << " weighted, " << UKernelName(kernel)
+				<< ": " << bestMs << " ms, " << scalarMs / bestMs << "x scalar, max deviation " << maxDegrees << " degrees" << std::endl;
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	UKernelSupported(Kernel)
+//
+//	True when the kernel is compiled in and the CPU
+//	runs it; the scalar kernel always is
+///////////////////////////////////////////////////
+bool MeshNormals::UKernelSupported(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case KERNEL_SCALAR:
+	case KERNEL_AUTO:
+		return true;
+#ifdef MESHNORMALS_SSE
+	case KERNEL_SSE:
+		return true;
+	case KERNEL_AVX:
+	{
+		static const bool hasAvx = UCpuHasAvx();
+		return hasAvx;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* MeshNormals::UKernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case KERNEL_SCALAR:
+		return "scalar";
+	case KERNEL_SSE:
+		return "SSE";
+	case KERNEL_AVX:
+		return "AVX";
+	default:
+		return "auto";
+	}
+}
+
+void MeshNormals::UAccumulate(const Streams& positions, const std::vector<GLuint>& indices, Weighting weighting, Kernel kernel, Streams& normals)
+{
+	size_t nTriangles = indices.size() / 3;
+	bool angleWeighted = weighting == WEIGHT_ANGLE;
+
+#ifdef MESHNORMALS_SSE
+	if (kernel == KERNEL_AVX)
+	{
+		UAccumulateAvx(positions.x.data(), positions.y.data(), positions.z.data(), indices.data(),
+			nTriangles, angleWeighted, normals.x.data(), normals.y.data(), normals.z.data());
+		return;
+	}
+	if (kernel == KERNEL_SSE)
+	{
+		UAccumulateSse(positions.x.data(), positions.y.data(), positions.z.data(), indices.data(),
+			nTriangles, angleWeighted, normals.x.data(), normals.y.data(), normals.z.data());
+		return;
+	}
+#endif
+	UAccumulateScalar(positions.x.data(), positions.y.data(), positions.z.data(), indices.data(),
+		0, nTriangles, angleWeighted, normals.x.data(), normals.y.data(), normals.z.data());
+}
+
+///////////////////////////////////////////////////
+//	UMergeCreases(const Streams&, float, Streams&)
+//
+//	Add the summed normals of the other vertices at the
+//	same position when they are within the crease angle
+//	of the vertex normal, so split vertices shade alike
+///////////////////////////////////////////////////
+void MeshNormals::UMergeCreases(const Streams& positions, float creaseAngle, Streams& normals)
+{
+	size_t nVertices = positions.x.size();
+	float minCos = std::cos(creaseAngle * PI / 180.0f);
+
+	// sorting by position puts the vertices of each position next to each other
+	std::vector<GLuint> order(nVertices);
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [&](GLuint a, GLuint b)
+		{
+			if (positions.x[a] != positions.x[b])
+				return positions.x[a] < positions.x[b];
+			if (positions.y[a] != positions.y[b])
+				return positions.y[a] < positions.y[b];
+			return positions.z[a] < positions.z[b];
+		});
+
+	Streams merged = normals;
+	size_t begin = 0;
+	while (begin < nVertices)
+	{
+		GLuint first = order[begin];
+		size_t end = begin + 1;
+		while (end < nVertices && positions.x[order[end]] == positions.x[first]
+			&& positions.y[order[end]] == positions.y[first] && positions.z[order[end]] == positions.z[first])
+			end++;
+
+		for (size_t i = begin; end - begin > 1 && i < end; i++)
+		{
+			GLuint v = order[i];
+			glm::vec3 normal(normals.x[v], normals.y[v], normals.z[v]);
+			if (normal == glm::vec3(0.0f))
+				continue;
+			normal = glm::normalize(normal);
+
+			for (size_t j = begin; j < end; j++)
+			{
+				GLuint u = order[j];
+				glm::vec3 other(normals.x[u], normals.y[u], normals.z[u]);
+				if (u == v || other == glm::vec3(0.0f) || glm::dot(normal, glm::normalize(other)) < minCos)
+					continue;
+				merged.x[v] += other.x;
+				merged.y[v] += other.y;
+				merged.z[v] += other.z;
+			}
+		}
+		begin = end;
+	}
+	normals = std::move(merged);
+}
+
+void MeshNormals::UNormalize(Kernel kernel, Streams& normals)
+{
+	size_t nVertices = normals.x.size();
+
+#ifdef MESHNORMALS_SSE
+	if (kernel == KERNEL_AVX)
+	{
+		UNormalizeAvx(normals.x.data(), normals.y.data(), normals.z.data(), nVertices);
+		return;
+	}
+	if (kernel == KERNEL_SSE)
+	{
+		UNormalizeSse(normals.x.data(), normals.y.data(), normals.z.data(), nVertices);
+		return;
+	}
+#endif
+	UNormalizeScalar(normals.x.data(), normals.y.data(), normals.z.data(), 0, nVertices);
+}
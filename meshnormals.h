@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshnormals.h
+// ========
+// batch vertex normal generation over a whole mesh: face normals and area or
+// angle weighted smooth vertex normals in one pass over the triangles
+//
+// Positions are copied into structure of arrays form so the SSE (4 triangles)
+// and AVX (8 triangles) kernels compute the face normals and corner weights
+// of a batch of triangles at once. The widest kernel the CPU supports is
+// picked at runtime; the scalar kernel is the reference and the fallback.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "meshgen.h"
+
+class MeshNormals
+{
+
+public:
+
+	// How much a triangle contributes to the normals of its corners
+	enum Weighting
+	{
+		WEIGHT_AREA,	// Triangle area: cheapest, favours large triangles
+		WEIGHT_ANGLE	// Corner angle: independent of how the surface is triangulated
+	};
+
+	// Implementation of the per triangle and per vertex work
+	enum Kernel
+	{
+		KERNEL_SCALAR,
+		KERNEL_SSE,
+		KERNEL_AVX,
+		KERNEL_AUTO		// Widest kernel the CPU supports
+	};
+
+public:
+	static void UComputeNormals(MeshGen::MeshData &data, Weighting weighting = WEIGHT_ANGLE, float creaseAngle = 0.0f, Kernel kernel = KERNEL_AUTO);
+	static void UBenchmark(GLuint nTriangles);
+
+	static bool UKernelSupported(Kernel kernel);
+	static const char *UKernelName(Kernel kernel);
+
+private:
+
+	// Positions or normals of a mesh as structure of arrays
+	struct Streams
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+	};
+
+	static void UAccumulate(const Streams &positions, const std::vector<GLuint> &indices, Weighting weighting, Kernel kernel, Streams &normals);
+	static void UMergeCreases(const Streams &positions, float creaseAngle, Streams &normals);
+	static void UNormalize(Kernel kernel, Streams &normals);
+};
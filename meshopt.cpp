@@ -0,0 +1,1390 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshopt.cpp
+// ========
+// post-process stages run on generated mesh data before it is uploaded:
+// vertex welding / index buffer conversion, post-transform vertex cache,
+// overdraw and vertex fetch ordering, vertex/index quantization,
+// LOD generation by quadric error edge collapse, meshlet clustering,
+// triangle winding orientation and validation
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshopt.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	const GLuint floatsPerVertexTotal = MeshGen::floatsPerVertexTotal;
+
+	// Bit pattern of one interleaved vertex, used as the welding key
+	typedef std::array<GLuint, floatsPerVertexTotal> VertexKey;
+
+	// Bit pattern of a vertex position, used to find seams
+	typedef std::array<GLuint, MeshGen::floatsPerVertex> PositionKey;
+
+	struct VertexKeyHash
+	{
+		template <size_t N>
+		size_t operator()(const std::array<GLuint, N>& key) const
+		{
+			// FNV-1a over the attribute bits
+			size_t hash = 2166136261u;
+			for (GLuint bits : key)
+			{
+				hash ^= bits;
+				hash *= 16777619u;
+			}
+			return hash;
+		}
+	};
+
+	// Forsyth vertex scoring constants
+	const int FORSYTH_CACHE_SIZE = 32;
+	const float FORSYTH_CACHE_DECAY = 1.5f;
+	const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	const float FORSYTH_VALENCE_SCALE = 2.0f;
+	const float FORSYTH_VALENCE_POWER = 0.5f;
+
+	float UForsythVertexScore(int cachePosition, GLuint remainingTriangles)
+	{
+		// vertices no longer used by any triangle are worthless
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// the last triangle's vertices get a fixed score so the
+			// next triangle does not simply reuse the same edge
+			if (cachePosition < 3)
+				score = FORSYTH_LAST_TRIANGLE_SCORE;
+			else
+				score = std::pow(1.0f - float(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY);
+		}
+
+		// boost vertices with few triangles left to finish them off
+		score += FORSYTH_VALENCE_SCALE * std::pow(float(remainingTriangles), -FORSYTH_VALENCE_POWER);
+		return score;
+	}
+
+	// Round a float to the nearest IEEE half float; values out of range become
+	// infinity and values below the smallest normal half flush to zero
+	GLushort UFloatToHalf(float value)
+	{
+		GLuint bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		GLuint sign = (bits >> 16) & 0x8000u;
+		GLuint magnitude = bits & 0x7fffffffu;
+
+		if (magnitude >= 0x7f800000u)
+			return GLushort(sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u));	// NaN / infinity
+		if (magnitude >= 0x477ff000u)
+			return GLushort(sign | 0x7c00u);	// rounds past the largest half (65504)
+		if (magnitude < 0x38800000u)
+			return GLushort(sign);	// below 2^-14
+
+		// rebias the exponent from 127 to 15 and round the mantissa to nearest even
+		GLuint half = (magnitude - 0x38000000u) >> 13;
+		GLuint rest = magnitude & 0x1fffu;
+		if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+			half++;
+		return GLushort(sign | half);
+	}
+
+	GLshort UFloatToSnorm16(float value)
+	{
+		value = std::max(-1.0f, std::min(1.0f, value));
+		return GLshort(std::lround(value * 32767.0f));
+	}
+
+	GLushort UFloatToUnorm16(float value)
+	{
+		value = std::max(0.0f, std::min(1.0f, value));
+		return GLushort(std::lround(value * 65535.0f));
+	}
+
+	// Octahedral normal encoding: project the unit vector onto the
+	// octahedron |x| + |y| + |z| = 1 and fold the lower half over the
+	// upper one, leaving two coordinates in [-1, 1]
+	void UOctEncode(const GLfloat* normal, GLshort* encoded)
+	{
+		float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+		if (length == 0.0f)
+		{
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+
+		float x = normal[0] / length;
+		float y = normal[1] / length;
+		if (normal[2] < 0.0f)
+		{
+			float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		encoded[0] = UFloatToSnorm16(x);
+		encoded[1] = UFloatToSnorm16(y);
+	}
+
+	// LOD chain: each LOD aims for half the triangles of the previous one and
+	// the chain ends once a LOD saves less than MIN_LOD_REDUCTION of them
+	const float LOD_TRIANGLE_RATIO = 0.5f;
+	const float MIN_LOD_REDUCTION = 0.1f;
+	const GLuint MIN_LOD_TRIANGLES = 16;
+
+	// Collapses may turn a triangle's normal by at most ~75 degrees
+	const float MAX_COLLAPSE_NORMAL_COS = 0.25f;
+
+	// A meshlet is closed early when a triangle faces more than ~60 degrees away
+	// from its average facing, otherwise the normal cone rarely rejects it
+	const float MESHLET_NORMAL_COS = 0.5f;
+
+	// Symmetric 4x4 error quadric of a set of planes, weighted by triangle area
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+	};
+
+	void UAddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+		q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+		q.c2 += other.c2; q.cd += other.cd; q.d2 += other.d2;
+		q.weight += other.weight;
+	}
+
+	Quadric UPlaneQuadric(const GLfloat* p0, const GLfloat* p1, const GLfloat* p2)
+	{
+		glm::dvec3 v0(p0[0], p0[1], p0[2]);
+		glm::dvec3 normal = glm::cross(glm::dvec3(p1[0], p1[1], p1[2]) - v0, glm::dvec3(p2[0], p2[1], p2[2]) - v0);
+		double area = glm::length(normal);
+
+		Quadric q = {};
+		if (area == 0.0)
+			return q;
+
+		// plane ax + by + cz + d = 0 scaled by the triangle's area
+		normal /= area;
+		double a = normal.x, b = normal.y, c = normal.z;
+		double d = -glm::dot(normal, v0);
+		q.a2 = a * a * area; q.ab = a * b * area; q.ac = a * c * area; q.ad = a * d * area;
+		q.b2 = b * b * area; q.bc = b * c * area; q.bd = b * d * area;
+		q.c2 = c * c * area; q.cd = c * d * area; q.d2 = d * d * area;
+		q.weight = area;
+		return q;
+	}
+
+	// Mean squared distance of a point to the planes of a quadric
+	double UQuadricError(const Quadric& q, const GLfloat* p)
+	{
+		double x = p[0], y = p[1], z = p[2];
+		double error = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z + q.d2
+			+ 2.0 * (q.ab * x * y + q.ac * x * z + q.bc * y * z + q.ad * x + q.bd * y + q.cd * z);
+		return q.weight > 0.0 ? std::max(error, 0.0) / q.weight : 0.0;
+	}
+
+	glm::vec3 UVertexPosition(const MeshGen::MeshData& data, GLuint vertex)
+	{
+		const GLfloat* position = &data.verts[vertex * floatsPerVertexTotal];
+		return glm::vec3(position[0], position[1], position[2]);
+	}
+
+	// Directed edge of a triangle between two positions; the triangles
+	// sharing an edge are adjacent once the edges are sorted by key
+	struct WindingEdge
+	{
+		uint64_t key;		// Lower position in the high bits
+		GLuint triangle;
+		bool forward;		// Runs from the lower to the higher position
+	};
+
+	// Positions closer than this fraction of the mesh size are one point when
+	// checking the winding: separately computed seam vertices often differ in the last bits
+	const float WINDING_POSITION_TOLERANCE = 1e-5f;
+
+	// Number every distinct vertex position, so triangles meeting at a seam
+	// (vertices with the same position but other normals or texture coords) connect.
+	// Positions are hashed on a grid of the tolerance and matched against the
+	// neighbouring cells too, so close points on either side of a cell border meet.
+	void UMapPositions(const MeshGen::MeshData& data, std::vector<GLuint>& positionOf)
+	{
+		const GLuint nVertices = data.VertexCount();
+		positionOf.resize(nVertices);
+		if (nVertices == 0)
+			return;
+
+		glm::vec3 boundsMin = UVertexPosition(data, 0);
+		glm::vec3 boundsMax = boundsMin;
+		for (GLuint v = 1; v < nVertices; v++)
+		{
+			boundsMin = glm::min(boundsMin, UVertexPosition(data, v));
+			boundsMax = glm::max(boundsMax, UVertexPosition(data, v));
+		}
+		float tolerance = std::max(glm::length(boundsMax - boundsMin), 1e-20f) * WINDING_POSITION_TOLERANCE;
+
+		std::unordered_map<PositionKey, std::vector<GLuint>, VertexKeyHash> cells;	// Cell -> first vertex of its points
+		for (GLuint v = 0; v < nVertices; v++)
+		{
+			// cells count from the bounds, not the origin: no coordinate is more than
+			// 1 / WINDING_POSITION_TOLERANCE cells in, however far the mesh is placed
+			glm::vec3 position = UVertexPosition(data, v);
+			glm::vec3 offset = glm::floor((position - boundsMin) / tolerance);
+			glm::ivec3 cell(int(offset.x), int(offset.y), int(offset.z));
+
+			GLuint found = v;
+			for (int i = 0; i < 27 && found == v; i++)
+			{
+				glm::ivec3 neighbour = cell + glm::ivec3(i % 3 - 1, i / 3 % 3 - 1, i / 9 - 1);
+				PositionKey key = { GLuint(neighbour.x), GLuint(neighbour.y), GLuint(neighbour.z) };
+				auto points = cells.find(key);
+				if (points == cells.end())
+					continue;
+				for (GLuint point : points->second)
+				{
+					if (glm::length(UVertexPosition(data, point) - position) <= tolerance)
+					{
+						found = point;
+						break;
+					}
+				}
+			}
+
+			if (found == v)
+			{
+				PositionKey key = { GLuint(cell.x), GLuint(cell.y), GLuint(cell.z) };
+				cells[key].push_back(v);
+				positionOf[v] = v;
+			}
+			else
+				positionOf[v] = positionOf[found];
+		}
+	}
+
+	void UCollectEdges(const std::vector<GLuint>& positionOf, const GLuint* indices, GLuint nTriangles, std::vector<WindingEdge>& edges)
+	{
+		edges.clear();
+		edges.reserve(nTriangles * 3);
+		for (GLuint t = 0; t < nTriangles; t++)
+		{
+			for (GLuint corner = 0; corner < 3; corner++)
+			{
+				GLuint a = positionOf[indices[t * 3 + corner]];
+				GLuint b = positionOf[indices[t * 3 + (corner + 1) % 3]];
+				WindingEdge edge;
+				edge.key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+				edge.triangle = t;
+				edge.forward = a < b;
+				edges.push_back(edge);
+			}
+		}
+		std::sort(edges.begin(), edges.end(), [](const WindingEdge& x, const WindingEdge& y) { return x.key < y.key; });
+	}
+
+	// Six times the volume the triangle encloses with the origin, positive when
+	// it winds counterclockwise seen from the side the origin is not on
+	double USignedVolume(const MeshGen::MeshData& data, const GLuint* triangle, const glm::dvec3& origin)
+	{
+		glm::dvec3 p0 = glm::dvec3(UVertexPosition(data, triangle[0])) - origin;
+		glm::dvec3 p1 = glm::dvec3(UVertexPosition(data, triangle[1])) - origin;
+		glm::dvec3 p2 = glm::dvec3(UVertexPosition(data, triangle[2])) - origin;
+		return glm::dot(p0, glm::cross(p1, p2));
+	}
+
+	VertexKey UMakeKey(const GLfloat* vertex)
+	{
+		VertexKey key;
+		for (GLuint i = 0; i < floatsPerVertexTotal; i++)
+		{
+			// -0.0 and 0.0 are the same value but not the same bits
+			GLfloat value = vertex[i] == 0.0f ? 0.0f : vertex[i];
+			std::memcpy(&key[i], &value, sizeof(GLfloat));
+		}
+		return key;
+	}
+}
+
+///////////////////////////////////////////////////
+//	UWeldVertices(MeshData&)
+//
+//	data: mesh data to weld in place
+//
+//	Merge vertices with identical position/normal/UV,
+//	drop degenerate triangles and unused vertices, and
+//	emit a compact vertex buffer plus an index buffer.
+//	Mesh data without indices is treated as a triangle
+//	soup (every 3 vertices form a triangle).
+///////////////////////////////////////////////////
+MeshOpt::WeldStats MeshOpt::UWeldVertices(MeshGen::MeshData& data)
+{
+	WeldStats stats;
+	stats.verticesBefore = data.VertexCount();
+
+	// a triangle soup gets an index per vertex
+	if (data.indices.empty())
+	{
+		data.indices.resize(stats.verticesBefore);
+		for (GLuint i = 0; i < stats.verticesBefore; i++)
+			data.indices[i] = i;
+	}
+	if (data.parts.empty())
+	{
+		MeshGen::MeshPart part = { 0, GLuint(data.indices.size()) };
+		data.parts.push_back(part);
+	}
+	stats.trianglesBefore = GLuint(data.indices.size() / 3);
+
+	// map every vertex to the first vertex with the same attributes
+	std::unordered_map<VertexKey, GLuint, VertexKeyHash> unique;
+	std::vector<GLuint> remap(stats.verticesBefore);
+	unique.reserve(stats.verticesBefore);
+	for (GLuint i = 0; i < stats.verticesBefore; i++)
+	{
+		VertexKey key = UMakeKey(&data.verts[i * floatsPerVertexTotal]);
+		remap[i] = unique.emplace(key, i).first->second;
+	}
+
+	// rebuild the index list part by part without degenerate triangles
+	std::vector<GLuint> indices;
+	indices.reserve(data.indices.size());
+	for (MeshGen::MeshPart& part : data.parts)
+	{
+		GLuint firstIndex = GLuint(indices.size());
+		for (GLuint i = part.firstIndex; i + 2 < part.firstIndex + part.nIndices; i += 3)
+		{
+			GLuint i0 = remap[data.indices[i]];
+			GLuint i1 = remap[data.indices[i + 1]];
+			GLuint i2 = remap[data.indices[i + 2]];
+			if (UIsDegenerate(data, i0, i1, i2))
+				continue;
+
+			indices.push_back(i0);
+			indices.push_back(i1);
+			indices.push_back(i2);
+		}
+		part.firstIndex = firstIndex;
+		part.nIndices = GLuint(indices.size()) - firstIndex;
+	}
+
+	data.indices.swap(indices);
+
+	// compact the vertex buffer to the vertices still referenced
+	UOptimizeVertexFetch(data);
+
+	stats.verticesAfter = data.VertexCount();
+	stats.trianglesAfter = GLuint(data.indices.size() / 3);
+	return stats;
+}
+
+///////////////////////////////////////////////////
+//	UOrientWinding(MeshData&)
+//
+//	data: indexed mesh data to fix in place
+//
+//	Wind every triangle counterclockwise seen from outside.
+//	Neighbours across an edge of two triangles must run it
+//	in opposite directions, which fixes the winding of each
+//	connected piece up to one choice: a closed piece must
+//	enclose a positive volume, an open one (a plane) faces
+//	the way most of its vertex normals point. Reversed
+//	triangles keep their vertices; normals left pointing
+//	against their triangles are turned around as well.
+//	Returns the validation of the result.
+///////////////////////////////////////////////////
+MeshOpt::WindingStats MeshOpt::UOrientWinding(MeshGen::MeshData& data)
+{
+	const GLuint nTriangles = GLuint(data.indices.size() / 3);
+	std::vector<GLuint> positionOf;
+	std::vector<WindingEdge> edges;
+	UMapPositions(data, positionOf);
+	UCollectEdges(positionOf, data.indices.data(), nTriangles, edges);
+
+	// neighbours across two-triangle edges, and the triangles of open edges
+	std::vector<std::vector<std::pair<GLuint, bool>>> neighbours(nTriangles);	// (triangle, same direction)
+	std::vector<bool> open(nTriangles, false);
+	for (size_t first = 0, last; first < edges.size(); first = last)
+	{
+		for (last = first + 1; last < edges.size() && edges[last].key == edges[first].key; last++)
+			;
+		if (last - first == 2)
+		{
+			bool same = edges[first].forward == edges[first + 1].forward;
+			neighbours[edges[first].triangle].push_back(std::make_pair(edges[first + 1].triangle, same));
+			neighbours[edges[first + 1].triangle].push_back(std::make_pair(edges[first].triangle, same));
+		}
+		else
+		{
+			for (size_t e = first; e < last; e++)
+				open[edges[e].triangle] = true;
+		}
+	}
+
+	// flood each piece from its first triangle, reversing neighbours that run an edge the same way
+	std::vector<int> reverse(nTriangles, -1);
+	std::vector<GLuint> piece;
+	for (GLuint seed = 0; seed < nTriangles; seed++)
+	{
+		if (reverse[seed] >= 0)
+			continue;
+
+		piece.clear();
+		piece.push_back(seed);
+		reverse[seed] = 0;
+		bool closed = true;
+		for (size_t next = 0; next < piece.size(); next++)
+		{
+			GLuint t = piece[next];
+			closed = closed && !open[t];
+			for (const std::pair<GLuint, bool>& neighbour : neighbours[t])
+			{
+				if (reverse[neighbour.first] >= 0)
+					continue;
+				reverse[neighbour.first] = reverse[t] ^ int(neighbour.second);
+				piece.push_back(neighbour.first);
+			}
+		}
+
+		// pick the outside: enclosed volume, or the vertex normals of an open piece
+		glm::dvec3 origin(UVertexPosition(data, data.indices[seed * 3]));
+		double facing = 0.0;
+		for (GLuint t : piece)
+		{
+			const GLuint* triangle = &data.indices[t * 3];
+			double side;
+			if (closed)
+				side = USignedVolume(data, triangle, origin);
+			else
+			{
+				glm::dvec3 p0(UVertexPosition(data, triangle[0]));
+				glm::dvec3 faceNormal = glm::cross(glm::dvec3(UVertexPosition(data, triangle[1])) - p0, glm::dvec3(UVertexPosition(data, triangle[2])) - p0);
+				glm::dvec3 vertexNormals(0.0);
+				for (GLuint corner = 0; corner < 3; corner++)
+				{
+					const GLfloat* normal = &data.verts[triangle[corner] * floatsPerVertexTotal + 3];
+					vertexNormals += glm::dvec3(normal[0], normal[1], normal[2]);
+				}
+				side = glm::dot(faceNormal, vertexNormals);
+			}
+			facing += reverse[t] ? -side : side;
+		}
+		if (facing < 0.0)
+		{
+			for (GLuint t : piece)
+				reverse[t] ^= 1;
+		}
+	}
+
+	GLuint nReversed = 0;
+	for (GLuint t = 0; t < nTriangles; t++)
+	{
+		if (!reverse[t])
+			continue;
+		std::swap(data.indices[t * 3 + 1], data.indices[t * 3 + 2]);
+		nReversed++;
+	}
+
+	// vertices of reversed triangles keep normals that agree with their triangles now
+	if (nReversed > 0)
+	{
+		std::vector<glm::vec3> faceNormalSums(data.VertexCount(), glm::vec3(0.0f));
+		for (GLuint t = 0; t < nTriangles; t++)
+		{
+			const GLuint* triangle = &data.indices[t * 3];
+			glm::vec3 p0 = UVertexPosition(data, triangle[0]);
+			glm::vec3 faceNormal = glm::cross(UVertexPosition(data, triangle[1]) - p0, UVertexPosition(data, triangle[2]) - p0);
+			for (GLuint corner = 0; corner < 3; corner++)
+				faceNormalSums[triangle[corner]] += faceNormal;
+		}
+		for (GLuint t = 0; t < nTriangles; t++)
+		{
+			if (!reverse[t])
+				continue;
+			for (GLuint corner = 0; corner < 3; corner++)
+			{
+				GLuint v = data.indices[t * 3 + corner];
+				GLfloat* normal = &data.verts[v * floatsPerVertexTotal + 3];
+				if (glm::dot(glm::vec3(normal[0], normal[1], normal[2]), faceNormalSums[v]) < 0.0f)
+				{
+					for (GLuint i = 0; i < 3; i++)
+						normal[i] = -normal[i];
+				}
+			}
+		}
+	}
+
+	WindingStats stats = UValidateWinding(data, 0, GLuint(data.indices.size()));
+	stats.nReversed = nReversed;
+	return stats;
+}
+
+///////////////////////////////////////////////////
+//	UValidateWinding(const MeshData&, GLuint, GLuint)
+//
+//	data: indexed mesh data
+//	firstIndex, nIndices: index range to check, e.g. one LOD
+//
+//	Check that the triangles of the range wind the same
+//	way as their neighbours and that closed pieces wind
+//	counterclockwise seen from outside (positive volume)
+///////////////////////////////////////////////////
+MeshOpt::WindingStats MeshOpt::UValidateWinding(const MeshGen::MeshData& data, GLuint firstIndex, GLuint nIndices)
+{
+	WindingStats stats = {};
+	stats.nTriangles = nIndices / 3;
+	const GLuint* indices = data.indices.data() + firstIndex;
+
+	std::vector<GLuint> positionOf;
+	std::vector<WindingEdge> edges;
+	UMapPositions(data, positionOf);
+	UCollectEdges(positionOf, indices, stats.nTriangles, edges);
+
+	// pieces joined over two-triangle edges (union-find with path halving)
+	std::vector<GLuint> parent(stats.nTriangles);
+	for (GLuint t = 0; t < stats.nTriangles; t++)
+		parent[t] = t;
+	auto root = [&parent](GLuint t)
+	{
+		while (parent[t] != t)
+			t = parent[t] = parent[parent[t]];
+		return t;
+	};
+
+	std::vector<bool> openTriangle(stats.nTriangles, false);
+	for (size_t first = 0, last; first < edges.size(); first = last)
+	{
+		for (last = first + 1; last < edges.size() && edges[last].key == edges[first].key; last++)
+			;
+		if (last - first == 2)
+		{
+			if (edges[first].forward == edges[first + 1].forward)
+				stats.nFlippedEdges++;
+			parent[root(edges[first].triangle)] = root(edges[first + 1].triangle);
+		}
+		else
+		{
+			stats.nOpenEdges++;
+			for (size_t e = first; e < last; e++)
+				openTriangle[edges[e].triangle] = true;
+		}
+	}
+	stats.closed = stats.nTriangles > 0 && stats.nOpenEdges == 0;
+
+	// volume and size of each closed piece, by its root triangle
+	std::vector<double> volume(stats.nTriangles, 0.0);
+	std::vector<GLuint> size(stats.nTriangles, 0);
+	std::vector<bool> closedPiece(stats.nTriangles, true);
+	glm::dvec3 origin = stats.nTriangles ? glm::dvec3(UVertexPosition(data, indices[0])) : glm::dvec3(0.0);
+	for (GLuint t = 0; t < stats.nTriangles; t++)
+	{
+		GLuint r = root(t);
+		if (size[r]++ == 0)
+			stats.nComponents++;
+		volume[r] += USignedVolume(data, indices + t * 3, origin);
+		closedPiece[r] = closedPiece[r] && !openTriangle[t];
+	}
+	for (GLuint t = 0; t < stats.nTriangles; t++)
+	{
+		if (size[t] > 0 && closedPiece[t] && volume[t] < 0.0)
+			stats.nInsideOut += size[t];
+	}
+	return stats;
+}
+
+///////////////////////////////////////////////////
+//	UOptimizeVertexCache(MeshData&)
+//
+//	data: indexed mesh data to reorder in place
+//
+//	Reorder the triangles of every part for post-transform
+//	vertex cache hits (Forsyth's linear-speed algorithm).
+//	Part ranges and vertex data are unchanged.
+///////////////////////////////////////////////////
+void MeshOpt::UOptimizeVertexCache(MeshGen::MeshData& data)
+{
+	for (const MeshGen::MeshPart& part : data.parts)
+		UOptimizeVertexCacheRange(data.indices.data() + part.firstIndex, part.nIndices, data.VertexCount());
+}
+
+///////////////////////////////////////////////////
+//	UOptimizeOverdraw(MeshData&)
+//
+//	data: cache optimized mesh data to reorder in place
+//
+//	Split the triangles of every part into clusters at the
+//	points where the vertex cache starts over anyway, then
+//	draw the outward facing clusters first so they occlude
+//	the rest of the mesh (Tipsify style overdraw sort).
+//	Run after UOptimizeVertexCache.
+///////////////////////////////////////////////////
+void MeshOpt::UOptimizeOverdraw(MeshGen::MeshData& data)
+{
+	for (const MeshGen::MeshPart& part : data.parts)
+		UOptimizeOverdrawRange(data, data.indices.data() + part.firstIndex, part.nIndices);
+}
+
+///////////////////////////////////////////////////
+//	UOptimizeVertexFetch(MeshData&)
+//
+//	data: indexed mesh data to reorder in place
+//
+//	Reorder vertices in the order the index buffer first
+//	uses them so vertex fetch walks memory linearly, and
+//	drop vertices no triangle references.
+///////////////////////////////////////////////////
+void MeshOpt::UOptimizeVertexFetch(MeshGen::MeshData& data)
+{
+	const GLuint unused = GLuint(-1);
+	std::vector<GLuint> remap(data.VertexCount(), unused);
+	std::vector<GLfloat> verts;
+	verts.reserve(data.verts.size());
+	for (GLuint& index : data.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = GLuint(verts.size() / floatsPerVertexTotal);
+			const GLfloat* vertex = &data.verts[index * floatsPerVertexTotal];
+			verts.insert(verts.end(), vertex, vertex + floatsPerVertexTotal);
+		}
+		index = remap[index];
+	}
+	data.verts.swap(verts);
+}
+
+///////////////////////////////////////////////////
+//	UGenerateLods(MeshData&, int)
+//
+//	data: indexed mesh data with a single LOD
+//	maxLods: maximum length of the LOD chain, including
+//		the full resolution mesh
+//
+//	Build progressively simplified LODs by collapsing
+//	edges in order of their quadric error. The LODs keep
+//	the vertex buffer: each collapse moves a vertex onto a
+//	neighbour, so every LOD is just another set of index
+//	ranges appended to the index list (one per part,
+//	vertex cache optimized). Vertices on seams (several
+//	vertices at one position, e.g. cap edges or texture
+//	seams) and open borders stay in place so parts and
+//	texture coords do not tear apart.
+///////////////////////////////////////////////////
+void MeshOpt::UGenerateLods(MeshGen::MeshData& data, int maxLods)
+{
+	const GLuint nVertices = data.VertexCount();
+	const GLuint nParts = GLuint(data.parts.size());
+	data.lodErrors.clear();
+
+	// vertices sharing a position form one point of the surface
+	std::unordered_map<PositionKey, GLuint, VertexKeyHash> positions;
+	std::vector<GLuint> positionOf(nVertices);
+	std::vector<GLuint> verticesAt;
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		PositionKey key;
+		std::memcpy(key.data(), &data.verts[v * floatsPerVertexTotal], sizeof(key));
+		auto found = positions.emplace(key, GLuint(verticesAt.size()));
+		if (found.second)
+			verticesAt.push_back(0);
+		positionOf[v] = found.first->second;
+		verticesAt[positionOf[v]]++;
+	}
+
+	// current triangles and the part each one belongs to
+	std::vector<GLuint> indices;
+	std::vector<GLuint> triangleParts;
+	for (GLuint p = 0; p < nParts; p++)
+	{
+		const MeshGen::MeshPart& part = data.parts[p];
+		indices.insert(indices.end(), data.indices.begin() + part.firstIndex, data.indices.begin() + part.firstIndex + part.nIndices);
+		triangleParts.insert(triangleParts.end(), part.nIndices / 3, p);
+	}
+
+	// edges not shared by exactly two triangles are borders (or non-manifold)
+	std::unordered_map<uint64_t, GLuint> edgeUse;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		GLuint a = positionOf[indices[i]];
+		GLuint b = positionOf[indices[i - i % 3 + (i + 1) % 3]];
+		edgeUse[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+	}
+	std::vector<bool> locked(nVertices, false);
+	for (GLuint v = 0; v < nVertices; v++)
+		locked[v] = verticesAt[positionOf[v]] > 1;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		GLuint a = positionOf[indices[i]];
+		GLuint b = positionOf[indices[i - i % 3 + (i + 1) % 3]];
+		if (edgeUse[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)] != 2)
+		{
+			locked[indices[i]] = true;
+			locked[indices[i - i % 3 + (i + 1) % 3]] = true;
+		}
+	}
+
+	// plane quadrics per surface point
+	std::vector<Quadric> quadrics(verticesAt.size(), Quadric());
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		Quadric q = UPlaneQuadric(&data.verts[indices[i] * floatsPerVertexTotal],
+			&data.verts[indices[i + 1] * floatsPerVertexTotal], &data.verts[indices[i + 2] * floatsPerVertexTotal]);
+		for (GLuint j = 0; j < 3; j++)
+			UAddQuadric(quadrics[positionOf[indices[i + j]]], q);
+	}
+
+	float lodError = 0.0f;
+	for (int lod = 1; lod < maxLods; lod++)
+	{
+		GLuint previousTriangles = GLuint(indices.size() / 3);
+		GLuint targetTriangles = GLuint(previousTriangles * LOD_TRIANGLE_RATIO);
+
+		while (indices.size() / 3 > targetTriangles)
+		{
+			GLuint nTriangles = GLuint(indices.size() / 3);
+
+			// triangles around each vertex
+			std::vector<GLuint> firstTriangle(nVertices + 1, 0);
+			for (GLuint index : indices)
+				firstTriangle[index + 1]++;
+			for (GLuint v = 0; v < nVertices; v++)
+				firstTriangle[v + 1] += firstTriangle[v];
+			std::vector<GLuint> vertexTriangles(indices.size());
+			std::vector<GLuint> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				vertexTriangles[fill[indices[i]]++] = GLuint(i / 3);
+
+			// every edge can collapse either way unless the moving vertex is locked
+			struct Collapse
+			{
+				GLuint from;
+				GLuint to;
+				double error;
+			};
+			std::vector<Collapse> collapses;
+			collapses.reserve(indices.size() * 2);
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				GLuint a = indices[i];
+				GLuint b = indices[i - i % 3 + (i + 1) % 3];
+				for (int direction = 0; direction < 2; direction++)
+				{
+					if (!locked[a])
+					{
+						Quadric q = quadrics[positionOf[a]];
+						UAddQuadric(q, quadrics[positionOf[b]]);
+						Collapse collapse = { a, b, UQuadricError(q, &data.verts[b * floatsPerVertexTotal]) };
+						collapses.push_back(collapse);
+					}
+					std::swap(a, b);
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+			// collapse the cheapest independent edges; the neighbourhood of a
+			// collapsed vertex is frozen for the rest of the pass so the flip
+			// tests of later collapses see the final triangles
+			std::vector<GLuint> remap(nVertices);
+			for (GLuint v = 0; v < nVertices; v++)
+				remap[v] = v;
+			std::vector<bool> frozen(nVertices, false);
+			GLuint needed = (nTriangles - targetTriangles + 1) / 2;
+			GLuint collapsed = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (frozen[collapse.from] || frozen[collapse.to])
+					continue;
+
+				const GLuint* triangles = &vertexTriangles[firstTriangle[collapse.from]];
+				GLuint count = firstTriangle[collapse.from + 1] - firstTriangle[collapse.from];
+				if (UCollapseFlips(data, indices, triangles, count, collapse.from, collapse.to))
+					continue;
+
+				remap[collapse.from] = collapse.to;
+				for (GLuint t = 0; t < count; t++)
+				{
+					for (GLuint j = 0; j < 3; j++)
+						frozen[indices[triangles[t] * 3 + j]] = true;
+				}
+				UAddQuadric(quadrics[positionOf[collapse.to]], quadrics[positionOf[collapse.from]]);
+				lodError = std::max(lodError, float(std::sqrt(collapse.error)));
+
+				if (++collapsed >= needed)
+					break;
+			}
+
+			if (collapsed == 0)
+				break;
+
+			// apply the collapses and drop the triangles that degenerated
+			GLuint kept = 0;
+			for (GLuint t = 0; t < nTriangles; t++)
+			{
+				GLuint i0 = remap[indices[t * 3]];
+				GLuint i1 = remap[indices[t * 3 + 1]];
+				GLuint i2 = remap[indices[t * 3 + 2]];
+				if (i0 == i1 || i1 == i2 || i2 == i0)
+					continue;
+
+				indices[kept * 3] = i0;
+				indices[kept * 3 + 1] = i1;
+				indices[kept * 3 + 2] = i2;
+				triangleParts[kept] = triangleParts[t];
+				kept++;
+			}
+			indices.resize(kept * 3);
+			triangleParts.resize(kept);
+		}
+
+		GLuint nTriangles = GLuint(indices.size() / 3);
+		if (nTriangles > previousTriangles * (1.0f - MIN_LOD_REDUCTION))
+			break;
+
+		// append the LOD's part ranges, the triangles are still grouped by part
+		if (data.lodErrors.empty())
+			data.lodErrors.push_back(0.0f);
+		data.lodErrors.push_back(lodError);
+
+		GLuint first = 0;
+		for (GLuint p = 0; p < nParts; p++)
+		{
+			GLuint last = first;
+			while (last < nTriangles && triangleParts[last] == p)
+				last++;
+
+			MeshGen::MeshPart part = { GLuint(data.indices.size()), (last - first) * 3 };
+			data.indices.insert(data.indices.end(), indices.begin() + first * 3, indices.begin() + last * 3);
+			if (part.nIndices > 0)
+				UOptimizeVertexCacheRange(&data.indices[part.firstIndex], part.nIndices, nVertices);
+			data.parts.push_back(part);
+			first = last;
+		}
+
+		if (nTriangles < MIN_LOD_TRIANGLES)
+			break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	UCollapseFlips(const MeshData&, const std::vector<GLuint>&, const GLuint*, GLuint, GLuint, GLuint)
+//
+//	Test whether moving vertex from onto vertex to turns
+//	one of the triangles around from over (or nearly)
+///////////////////////////////////////////////////
+bool MeshOpt::UCollapseFlips(const MeshGen::MeshData& data, const std::vector<GLuint>& indices,
+	const GLuint* triangles, GLuint nTriangles, GLuint from, GLuint to)
+{
+	const GLfloat* target = &data.verts[to * floatsPerVertexTotal];
+
+	for (GLuint t = 0; t < nTriangles; t++)
+	{
+		const GLuint* triangle = &indices[triangles[t] * 3];
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			continue;	// collapses away
+
+		glm::vec3 before[3];
+		glm::vec3 after[3];
+		for (GLuint j = 0; j < 3; j++)
+		{
+			const GLfloat* p = &data.verts[triangle[j] * floatsPerVertexTotal];
+			before[j] = glm::vec3(p[0], p[1], p[2]);
+			after[j] = triangle[j] == from ? glm::vec3(target[0], target[1], target[2]) : before[j];
+		}
+
+		glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+		glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+		if (glm::dot(normalBefore, normalAfter) < MAX_COLLAPSE_NORMAL_COS * glm::length(normalBefore) * glm::length(normalAfter))
+			return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////
+//	UBuildMeshlets(MeshData&)
+//
+//	data: indexed mesh data, all LODs generated
+//
+//	Split every part into meshlets of consecutive
+//	triangles with at most maxMeshletVertices unique
+//	vertices and maxMeshletTriangles triangles. The index
+//	order is kept (the cache optimizer already grouped
+//	neighbouring triangles), so each meshlet is a range
+//	that can be drawn on its own.
+///////////////////////////////////////////////////
+void MeshOpt::UBuildMeshlets(MeshGen::MeshData& data)
+{
+	data.meshlets.clear();
+
+	// meshlet that last used each vertex, to count the unique ones
+	std::vector<GLuint> usedBy(data.VertexCount(), GLuint(-1));
+
+	for (const MeshGen::MeshPart& part : data.parts)
+	{
+		GLuint end = part.firstIndex + part.nIndices;
+		GLuint first = part.firstIndex;
+		GLuint nVertices = 0;
+		glm::vec3 normalSum(0.0f);
+		for (GLuint i = part.firstIndex; i < end; i += 3)
+		{
+			const GLuint* triangle = &data.indices[i];
+			GLuint id = GLuint(data.meshlets.size());
+			GLuint added = 0;
+			for (int corner = 0; corner < 3; corner++)
+				added += usedBy[triangle[corner]] != id ? 1 : 0;	// welded triangles never repeat a vertex
+
+			glm::vec3 p0 = UVertexPosition(data, triangle[0]);
+			glm::vec3 normal = glm::cross(UVertexPosition(data, triangle[1]) - p0, UVertexPosition(data, triangle[2]) - p0);
+			float length = glm::length(normal);
+			normal = length > 0.0f ? normal / length : normal;
+			float sumLength = glm::length(normalSum);
+			bool turned = sumLength > 0.0f && glm::dot(normal, normalSum) < MESHLET_NORMAL_COS * sumLength;
+
+			if (nVertices + added > maxMeshletVertices || (i - first) / 3 + 1 > maxMeshletTriangles || turned)
+			{
+				MeshGen::Meshlet meshlet;
+				meshlet.firstIndex = first;
+				meshlet.nIndices = i - first;
+				UComputeMeshletBounds(data, meshlet);
+				data.meshlets.push_back(meshlet);
+
+				id++;
+				first = i;
+				nVertices = 0;
+				normalSum = glm::vec3(0.0f);
+			}
+			normalSum += normal;
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				if (usedBy[triangle[corner]] != id)
+				{
+					usedBy[triangle[corner]] = id;
+					nVertices++;
+				}
+			}
+		}
+
+		if (end > first)
+		{
+			MeshGen::Meshlet meshlet;
+			meshlet.firstIndex = first;
+			meshlet.nIndices = end - first;
+			UComputeMeshletBounds(data, meshlet);
+			data.meshlets.push_back(meshlet);
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	UAnalyzeVertexCache(const MeshData&)
+//
+//	data: indexed mesh data
+//
+//	Simulate a FIFO post-transform cache of cacheSize
+//	entries and report the ACMR and ATVR of the mesh
+///////////////////////////////////////////////////
+MeshOpt::CacheStats MeshOpt::UAnalyzeVertexCache(const MeshGen::MeshData& data)
+{
+	std::vector<GLuint> timestamps(data.VertexCount(), 0);
+	GLuint time = cacheSize + 1;
+	GLuint misses = 0;
+
+	for (GLuint index : data.indices)
+	{
+		// a vertex is in a FIFO cache when it was added less than cacheSize misses ago
+		if (time - timestamps[index] > GLuint(cacheSize))
+		{
+			timestamps[index] = time++;
+			misses++;
+		}
+	}
+
+	CacheStats stats;
+	GLuint triangles = GLuint(data.indices.size() / 3);
+	stats.acmr = triangles ? float(misses) / triangles : 0.0f;
+	stats.atvr = data.VertexCount() ? float(misses) / data.VertexCount() : 0.0f;
+	return stats;
+}
+
+///////////////////////////////////////////////////
+//	UPackVertices(const MeshData&, std::vector<PackedVertex>&)
+//
+//	data: mesh data to quantize
+//	packed: receives one PackedVertex per vertex
+//
+//	Quantize the interleaved float vertices to the packed
+//	layout. Returns true when the texture coords are stored
+//	as normalized unsigned shorts; when any of them falls
+//	outside [0, 1] (e.g. tiled textures) they are stored as
+//	half floats instead and false is returned.
+///////////////////////////////////////////////////
+bool MeshOpt::UPackVertices(const MeshGen::MeshData& data, std::vector<PackedVertex>& packed)
+{
+	const GLuint uvOffset = MeshGen::floatsPerVertex + MeshGen::floatsPerNormal;
+
+	bool normalizedUVs = true;
+	for (size_t i = uvOffset; i < data.verts.size(); i += floatsPerVertexTotal)
+	{
+		for (GLuint j = 0; j < MeshGen::floatsPerUV; j++)
+		{
+			if (data.verts[i + j] < 0.0f || data.verts[i + j] > 1.0f)
+				normalizedUVs = false;
+		}
+	}
+
+	packed.resize(data.VertexCount());
+	for (GLuint v = 0; v < packed.size(); v++)
+	{
+		const GLfloat* vertex = &data.verts[v * floatsPerVertexTotal];
+		PackedVertex& out = packed[v];
+
+		for (GLuint j = 0; j < MeshGen::floatsPerVertex; j++)
+			out.position[j] = UFloatToHalf(vertex[j]);
+		out.position[3] = 0;
+
+		UOctEncode(vertex + MeshGen::floatsPerVertex, out.normal);
+
+		for (GLuint j = 0; j < MeshGen::floatsPerUV; j++)
+			out.uv[j] = normalizedUVs ? UFloatToUnorm16(vertex[uvOffset + j]) : UFloatToHalf(vertex[uvOffset + j]);
+	}
+	return normalizedUVs;
+}
+
+///////////////////////////////////////////////////
+//	UPackIndices(const MeshData&, std::vector<GLushort>&)
+//
+//	data: indexed mesh data
+//	packed: receives the 16 bit index buffer
+//
+//	Narrow the index buffer to unsigned shorts. Returns
+//	false (and leaves packed empty) when the mesh has too
+//	many vertices to be addressed with 16 bits.
+///////////////////////////////////////////////////
+bool MeshOpt::UPackIndices(const MeshGen::MeshData& data, std::vector<GLushort>& packed)
+{
+	packed.clear();
+	if (data.VertexCount() > 0x10000u)
+		return false;
+
+	packed.reserve(data.indices.size());
+	for (GLuint index : data.indices)
+		packed.push_back(GLushort(index));
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UOptimizeVertexCacheRange(GLuint*, GLuint, GLuint)
+//
+//	Forsyth triangle reordering of one index range
+///////////////////////////////////////////////////
+void MeshOpt::UOptimizeVertexCacheRange(GLuint* indices, GLuint nIndices, GLuint nVertices)
+{
+	const GLuint nTriangles = nIndices / 3;
+	if (nTriangles < 2)
+		return;
+
+	// vertex -> triangle adjacency (compressed rows)
+	std::vector<GLuint> remaining(nVertices, 0);
+	for (GLuint i = 0; i < nTriangles * 3; i++)
+		remaining[indices[i]]++;
+
+	std::vector<GLuint> offsets(nVertices + 1, 0);
+	for (GLuint v = 0; v < nVertices; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<GLuint> adjacency(nTriangles * 3);
+	std::vector<GLuint> fill(offsets.begin(), offsets.end() - 1);
+	for (GLuint t = 0; t < nTriangles; t++)
+		for (GLuint k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = t;
+
+	// initial scores
+	std::vector<int> cachePosition(nVertices, -1);
+	std::vector<float> vertexScore(nVertices);
+	for (GLuint v = 0; v < nVertices; v++)
+		vertexScore[v] = UForsythVertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(nTriangles);
+	std::vector<bool> emitted(nTriangles, false);
+	for (GLuint t = 0; t < nTriangles; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	std::vector<GLuint> output;
+	output.reserve(nTriangles * 3);
+
+	// LRU cache, with room for the 3 vertices pushed in front of a full cache
+	std::vector<GLuint> cache;
+	std::vector<GLuint> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	GLuint scanPosition = 0;
+	GLuint bestTriangle = 0;
+	float bestScore = -1.0f;
+	for (GLuint t = 0; t < nTriangles; t++)
+	{
+		if (triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			bestTriangle = t;
+		}
+	}
+
+	for (GLuint emittedCount = 0; emittedCount < nTriangles; emittedCount++)
+	{
+		// nothing adjacent to the cache left: pick the next unemitted triangle
+		if (bestScore < 0.0f)
+		{
+			while (emitted[scanPosition])
+				scanPosition++;
+			bestTriangle = scanPosition;
+		}
+
+		const GLuint* triangle = indices + bestTriangle * 3;
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[bestTriangle] = true;
+
+		// remove the triangle from the adjacency of its vertices
+		for (GLuint k = 0; k < 3; k++)
+		{
+			GLuint v = triangle[k];
+			GLuint* begin = &adjacency[offsets[v]];
+			GLuint* end = begin + remaining[v];
+			*std::find(begin, end, bestTriangle) = *(end - 1);
+			remaining[v]--;
+		}
+
+		// move the triangle's vertices to the front of the LRU cache
+		newCache.assign(triangle, triangle + 3);
+		for (GLuint v : cache)
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+
+		for (GLuint i = 0; i < newCache.size(); i++)
+			cachePosition[newCache[i]] = i < GLuint(FORSYTH_CACHE_SIZE) ? int(i) : -1;
+
+		// rescore the touched vertices (including the ones just evicted) and their triangles
+		for (GLuint v : newCache)
+		{
+			float score = UForsythVertexScore(cachePosition[v], remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (GLuint a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+				triangleScore[adjacency[a]] += delta;
+		}
+
+		if (newCache.size() > GLuint(FORSYTH_CACHE_SIZE))
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		cache.swap(newCache);
+
+		// the next triangle is the best one touching the cache
+		bestScore = -1.0f;
+		for (GLuint v : cache)
+		{
+			for (GLuint a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+			{
+				GLuint t = adjacency[a];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+///////////////////////////////////////////////////
+//	UOptimizeOverdrawRange(const MeshData&, GLuint*, GLuint)
+//
+//	Cluster sort of one cache optimized index range
+///////////////////////////////////////////////////
+void MeshOpt::UOptimizeOverdrawRange(const MeshGen::MeshData& data, GLuint* indices, GLuint nIndices)
+{
+	struct Cluster
+	{
+		GLuint firstIndex;
+		GLuint nIndices;
+		float sortKey;
+	};
+
+	const GLuint nTriangles = nIndices / 3;
+	if (nTriangles < 2)
+		return;
+
+	// split where a triangle misses the cache with all three vertices:
+	// the cache restarts there, so reordering costs almost no hits
+	std::vector<GLuint> timestamps(data.VertexCount(), 0);
+	GLuint time = cacheSize + 1;
+	std::vector<Cluster> clusters;
+	for (GLuint t = 0; t < nTriangles; t++)
+	{
+		int misses = 0;
+		for (GLuint k = 0; k < 3; k++)
+		{
+			GLuint v = indices[t * 3 + k];
+			if (time - timestamps[v] > GLuint(cacheSize))
+			{
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3)
+		{
+			Cluster cluster = { t * 3, 0, 0.0f };
+			clusters.push_back(cluster);
+		}
+		clusters.back().nIndices += 3;
+	}
+	if (clusters.size() < 2)
+		return;
+
+	// area weighted centroid of the whole range and of each cluster
+	auto position = [&](GLuint v) {
+		const GLfloat* p = &data.verts[v * floatsPerVertexTotal];
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	std::vector<glm::vec3> clusterCentroid(clusters.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormal(clusters.size(), glm::vec3(0.0f));
+	std::vector<float> clusterArea(clusters.size(), 0.0f);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		for (GLuint i = clusters[c].firstIndex; i < clusters[c].firstIndex + clusters[c].nIndices; i += 3)
+		{
+			glm::vec3 p0 = position(indices[i]);
+			glm::vec3 p1 = position(indices[i + 1]);
+			glm::vec3 p2 = position(indices[i + 2]);
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+
+			clusterCentroid[c] += center * area;
+			clusterNormal[c] += normal;
+			clusterArea[c] += area;
+		}
+		meshCentroid += clusterCentroid[c];
+		meshArea += clusterArea[c];
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// clusters that face away from the center occlude the others: draw them first
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		glm::vec3 centroid = clusterArea[c] > 0.0f ? clusterCentroid[c] / clusterArea[c] : meshCentroid;
+		float normalLength = glm::length(clusterNormal[c]);
+		glm::vec3 normal = normalLength > 0.0f ? clusterNormal[c] / normalLength : glm::vec3(0.0f);
+		clusters[c].sortKey = glm::dot(centroid - meshCentroid, normal);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<GLuint> sorted;
+	sorted.reserve(nIndices);
+	for (const Cluster& cluster : clusters)
+		sorted.insert(sorted.end(), indices + cluster.firstIndex, indices + cluster.firstIndex + cluster.nIndices);
+	std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+///////////////////////////////////////////////////
+//	UIsDegenerate(const MeshData&, GLuint, GLuint, GLuint)
+//
+//	A triangle is degenerate when it repeats a vertex
+//	or its corners are collinear (zero area)
+///////////////////////////////////////////////////
+bool MeshOpt::UIsDegenerate(const MeshGen::MeshData& data, GLuint i0, GLuint i1, GLuint i2)
+{
+	if (i0 == i1 || i1 == i2 || i0 == i2)
+		return true;
+
+	const GLfloat* v0 = &data.verts[i0 * floatsPerVertexTotal];
+	const GLfloat* v1 = &data.verts[i1 * floatsPerVertexTotal];
+	const GLfloat* v2 = &data.verts[i2 * floatsPerVertexTotal];
+	glm::vec3 e1(v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]);
+	glm::vec3 e2(v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]);
+
+	float area = glm::length(glm::cross(e1, e2));
+	return area <= 1e-6f * glm::length(e1) * glm::length(e2);
+}
+
+///////////////////////////////////////////////////
+//	UComputeMeshletBounds(const MeshData&, Meshlet&)
+//
+//	Bounding sphere (around the box center) and normal
+//	cone of a meshlet. The cone axis is the average unit
+//	normal; when a triangle is 90 degrees or more off the
+//	axis the cluster always has front faces and the
+//	cutoff is 1 so the cone test never rejects it.
+///////////////////////////////////////////////////
+void MeshOpt::UComputeMeshletBounds(const MeshGen::MeshData& data, MeshGen::Meshlet& meshlet)
+{
+	const GLuint* indices = &data.indices[meshlet.firstIndex];
+
+	glm::vec3 lower(std::numeric_limits<float>::max());
+	glm::vec3 upper(-std::numeric_limits<float>::max());
+	for (GLuint i = 0; i < meshlet.nIndices; i++)
+	{
+		glm::vec3 position = UVertexPosition(data, indices[i]);
+		lower = glm::min(lower, position);
+		upper = glm::max(upper, position);
+	}
+
+	glm::vec3 center = (lower + upper) * 0.5f;
+	float radius = 0.0f;
+	for (GLuint i = 0; i < meshlet.nIndices; i++)
+		radius = std::max(radius, glm::distance(center, UVertexPosition(data, indices[i])));
+
+	// unit face normals, skipping degenerate triangles
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis(0.0f);
+	for (GLuint i = 0; i < meshlet.nIndices; i += 3)
+	{
+		glm::vec3 p0 = UVertexPosition(data, indices[i]);
+		glm::vec3 p1 = UVertexPosition(data, indices[i + 1]);
+		glm::vec3 p2 = UVertexPosition(data, indices[i + 2]);
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+		normals.push_back(normal / length);
+		axis += normals.back();
+	}
+
+	float cutoff = 1.0f;
+	float axisLength = glm::length(axis);
+	if (axisLength > 0.0f)
+	{
+		axis /= axisLength;
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+			minDot = std::min(minDot, glm::dot(normal, axis));
+		if (minDot > 0.0f)
+			cutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+
+	meshlet.center[0] = center.x;
+	meshlet.center[1] = center.y;
+	meshlet.center[2] = center.z;
+	meshlet.radius = radius;
+	meshlet.coneAxis[0] = axis.x;
+	meshlet.coneAxis[1] = axis.y;
+	meshlet.coneAxis[2] = axis.z;
+	meshlet.coneCutoff = cutoff;
+}
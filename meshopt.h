@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshopt.h
+// ========
+// post-process stages run on generated mesh data before it is uploaded:
+// vertex welding / index buffer conversion, post-transform vertex cache,
+// overdraw and vertex fetch ordering, vertex/index quantization,
+// LOD generation by quadric error edge collapse, meshlet clustering,
+// triangle winding orientation and validation
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "meshgen.h"
+
+class MeshOpt
+{
+
+public:
+
+	// Vertex and triangle counts before and after welding
+	struct WeldStats
+	{
+		GLuint verticesBefore;
+		GLuint verticesAfter;
+		GLuint trianglesBefore;
+		GLuint trianglesAfter;
+	};
+
+	// Post-transform vertex cache efficiency of an index buffer
+	struct CacheStats
+	{
+		float acmr;		// Average cache miss ratio: transformed vertices per triangle (0.5 - 3.0)
+		float atvr;		// Average transformed vertex ratio: transformed vertices per vertex (1.0 best)
+	};
+
+	// Triangle winding of a mesh, measured on positions so seams (several
+	// vertices at one point) do not split the surface
+	struct WindingStats
+	{
+		GLuint nTriangles;
+		GLuint nComponents;		// Edge connected pieces
+		GLuint nOpenEdges;		// Edges of one triangle, or of more than two
+		GLuint nFlippedEdges;	// Edges both of its triangles run the same way: the neighbours disagree
+		GLuint nInsideOut;		// Triangles of closed pieces that enclose a negative volume
+		GLuint nReversed;		// Triangles turned around by UOrientWinding
+		bool closed;			// No open edges, so back faces are only seen from inside
+
+		bool Consistent() const { return nFlippedEdges == 0 && nInsideOut == 0; }
+	};
+
+	// Size of the FIFO cache used to measure ACMR/ATVR
+	static const int cacheSize = 16;
+
+	// Limits of one meshlet
+	static const GLuint maxMeshletVertices = 64;
+	static const GLuint maxMeshletTriangles = 124;
+
+	// Compact 16 byte vertex for the packed layout: half float position
+	// (w unused), octahedral normal in two normalized shorts, texture
+	// coords in two normalized unsigned shorts (or half floats, see UPackVertices)
+	struct PackedVertex
+	{
+		GLushort position[4];
+		GLshort normal[2];
+		GLushort uv[2];
+	};
+
+public:
+	static WeldStats UWeldVertices(MeshGen::MeshData &data);
+	static WindingStats UOrientWinding(MeshGen::MeshData &data);
+	static WindingStats UValidateWinding(const MeshGen::MeshData &data, GLuint firstIndex, GLuint nIndices);
+	static void UOptimizeVertexCache(MeshGen::MeshData &data);
+	static void UOptimizeOverdraw(MeshGen::MeshData &data);
+	static void UOptimizeVertexFetch(MeshGen::MeshData &data);
+	static void UGenerateLods(MeshGen::MeshData &data, int maxLods);
+	static void UBuildMeshlets(MeshGen::MeshData &data);
+	static CacheStats UAnalyzeVertexCache(const MeshGen::MeshData &data);
+	static bool UPackVertices(const MeshGen::MeshData &data, std::vector<PackedVertex> &packed);
+	static bool UPackIndices(const MeshGen::MeshData &data, std::vector<GLushort> &packed);
+
+private:
+	static bool UIsDegenerate(const MeshGen::MeshData &data, GLuint i0, GLuint i1, GLuint i2);
+	static void UOptimizeVertexCacheRange(GLuint *indices, GLuint nIndices, GLuint nVertices);
+	static void UOptimizeOverdrawRange(const MeshGen::MeshData &data, GLuint *indices, GLuint nIndices);
+	static bool UCollapseFlips(const MeshGen::MeshData &data, const std::vector<GLuint> &indices,
+		const GLuint *triangles, GLuint nTriangles, GLuint from, GLuint to);
+	static void UComputeMeshletBounds(const MeshGen::MeshData &data, MeshGen::Meshlet &meshlet);
+};
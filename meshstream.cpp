@@ -0,0 +1,643 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshstream.cpp
+// ========
+// out-of-core meshes: a cluster hierarchy stored in a memory mapped file and
+// paged in and out of a fixed GPU budget by the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshstream.h"
+#include "meshes.h"
+#include "meshopt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+	// Bump whenever the file layout or the hierarchy UBuild produces changes
+	const uint32_t MESH_STREAM_VERSION = 1;
+	const char MESH_STREAM_MAGIC[4] = { 'M', 'S', 'T', 'R' };
+
+	const uint32_t NO_NODE = 0xffffffffu;
+
+	// LOD chain tried when simplifying the two children of an inner node
+	const int NODE_LODS = 4;
+
+	// Nodes uploaded per frame at most, so paging never stalls a frame for long
+	const GLuint MAX_UPLOADS_PER_FRAME = 16;
+
+	// A slot drawn this recently may still be read by the GPU and is not reused
+	const GLuint FRAMES_IN_FLIGHT = 3;
+
+	// Nearest view depth used to project errors, keeps nodes around the camera finite
+	const float MIN_PROJECTION_DEPTH = 0.1f;
+
+	const GLuint VERTEX_BINDING = 0;
+	const GLsizei VERTEX_STRIDE = sizeof(GLfloat) * MeshGen::floatsPerVertexTotal;
+	const GLuint SLOT_VERTEX_BYTES = MeshStream::maxNodeVertices * VERTEX_STRIDE;
+	const GLuint SLOT_INDEX_BYTES = MeshStream::maxNodeTriangles * 3 * sizeof(GLushort);
+
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t nNodes;
+		uint32_t root;
+		uint64_t tableOffset;	// Node table, after the node data
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	// One node of the hierarchy; its data at offset is its vertices (float
+	// layout) followed by its 16 bit indices. Nodes are stored children first.
+	struct FileNode
+	{
+		float center[3];		// Bounding sphere of the node's part of the mesh
+		float radius;
+		float error;			// Object space distance of the node's geometry from the source mesh
+		uint32_t children[2];	// NO_NODE for a leaf
+		uint32_t nVertices;		// 0 for an inner node without geometry
+		uint32_t nIndices;
+		uint32_t reserved;
+		uint64_t offset;
+	};
+
+	const FileNode& UNodeAt(const void* nodes, GLuint node)
+	{
+		return static_cast<const FileNode*>(nodes)[node];
+	}
+
+	uint64_t UAlign8(uint64_t value)
+	{
+		return (value + 7) & ~uint64_t(7);
+	}
+
+	// A node of a mapped file fits a slot, lies inside the file, links to
+	// children stored before it and only indexes its own vertices
+	bool UValidNode(const FileNode& node, GLuint index, const unsigned char* file, uint64_t fileSize)
+	{
+		if (node.nVertices > MeshStream::maxNodeVertices || node.nIndices > MeshStream::maxNodeTriangles * 3
+			|| node.offset + uint64_t(VERTEX_STRIDE) * node.nVertices + sizeof(GLushort) * node.nIndices > fileSize)
+			return false;
+
+		bool leaf = node.children[0] == NO_NODE && node.children[1] == NO_NODE;
+		if (!leaf && (node.children[0] >= index || node.children[1] >= index))
+			return false;
+
+		const unsigned char* indices = file + node.offset + size_t(VERTEX_STRIDE) * node.nVertices;
+		for (uint32_t i = 0; i < node.nIndices; i++)
+		{
+			GLushort vertex;
+			std::memcpy(&vertex, indices + sizeof(GLushort) * i, sizeof(GLushort));
+			if (vertex >= node.nVertices)
+				return false;
+		}
+		return true;
+	}
+
+	// State of one UBuild run
+	struct Builder
+	{
+		const MeshGen::MeshData& data;
+		std::vector<GLuint> triangles;		// Triangle order; every node owns a range of it
+		std::vector<glm::vec3> centroids;
+		std::ofstream& out;
+		uint64_t offset;					// Next node data in the file
+		std::vector<FileNode> nodes;
+		std::vector<glm::vec3> nodeMin;		// Bounds of each node's part of the mesh
+		std::vector<glm::vec3> nodeMax;
+		MeshStream::BuildStats& stats;
+	};
+
+	// Copy triangles [first, first + count) of the build order into mesh data of their own
+	void UExtractTriangles(const Builder& builder, GLuint first, GLuint count, MeshGen::MeshData& geometry)
+	{
+		std::unordered_map<GLuint, GLuint> local;
+		geometry = MeshGen::MeshData();
+		for (GLuint t = first; t < first + count; t++)
+		{
+			for (GLuint corner = 0; corner < 3; corner++)
+			{
+				GLuint vertex = builder.data.indices[builder.triangles[t] * 3 + corner];
+				auto found = local.emplace(vertex, geometry.VertexCount());
+				if (found.second)
+				{
+					const GLfloat* source = &builder.data.verts[vertex * MeshGen::floatsPerVertexTotal];
+					geometry.verts.insert(geometry.verts.end(), source, source + MeshGen::floatsPerVertexTotal);
+				}
+				geometry.indices.push_back(found.first->second);
+			}
+		}
+		MeshGen::MeshPart part = { 0, GLuint(geometry.indices.size()) };
+		geometry.parts.push_back(part);
+	}
+
+	// Keep one index range of mesh data and the vertices it uses
+	void UKeepRange(MeshGen::MeshData& geometry, const MeshGen::MeshPart& range)
+	{
+		std::vector<GLuint> indices(geometry.indices.begin() + range.firstIndex, geometry.indices.begin() + range.firstIndex + range.nIndices);
+		geometry.indices.swap(indices);
+		geometry.parts.assign(1, MeshGen::MeshPart{ 0, range.nIndices });
+		geometry.lodErrors.clear();
+		MeshOpt::UOptimizeVertexFetch(geometry);
+	}
+
+	// Simplified union of the children's geometry, empty when it does not fit a slot
+	float USimplifyChildren(const MeshGen::MeshData& left, const MeshGen::MeshData& right, MeshGen::MeshData& geometry)
+	{
+		geometry = left;
+		GLuint base = left.VertexCount();
+		geometry.verts.insert(geometry.verts.end(), right.verts.begin(), right.verts.end());
+		for (GLuint index : right.indices)
+			geometry.indices.push_back(base + index);
+		geometry.parts.assign(1, MeshGen::MeshPart{ 0, GLuint(geometry.indices.size()) });
+
+		// the children share their border vertices, welding joins them so the
+		// shared border can be simplified while the outer border stays in place
+		MeshOpt::UWeldVertices(geometry);
+		MeshOpt::UGenerateLods(geometry, NODE_LODS);
+
+		// the first LOD down to a leaf's size, else the coarsest one
+		GLuint lod = 0;
+		while (lod + 1 < geometry.LodCount() && geometry.parts[lod].nIndices / 3 > MeshStream::leafTriangles)
+			lod++;
+		float error = geometry.lodErrors.empty() ? 0.0f : geometry.lodErrors[lod];
+		UKeepRange(geometry, geometry.parts[lod]);
+
+		if (geometry.indices.size() / 3 > MeshStream::maxNodeTriangles || geometry.VertexCount() > MeshStream::maxNodeVertices)
+			geometry = MeshGen::MeshData();
+		return error;
+	}
+
+	// Write the node's geometry and add it to the table
+	uint32_t UWriteNode(Builder& builder, MeshGen::MeshData& geometry, float error, uint32_t left, uint32_t right, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		FileNode node = {};
+		glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+		std::memcpy(node.center, &center[0], sizeof(node.center));
+		node.radius = 0.5f * glm::length(boundsMax - boundsMin);
+		node.error = error;
+		node.children[0] = left;
+		node.children[1] = right;
+
+		if (!geometry.indices.empty())
+		{
+			MeshOpt::UOptimizeVertexCache(geometry);
+			MeshOpt::UOptimizeVertexFetch(geometry);
+
+			std::vector<GLushort> indices(geometry.indices.begin(), geometry.indices.end());
+			node.nVertices = geometry.VertexCount();
+			node.nIndices = GLuint(indices.size());
+			node.offset = builder.offset;
+
+			uint64_t bytes = uint64_t(VERTEX_STRIDE) * node.nVertices + sizeof(GLushort) * node.nIndices;
+			builder.out.write(reinterpret_cast<const char*>(geometry.verts.data()), std::streamsize(VERTEX_STRIDE) * node.nVertices);
+			builder.out.write(reinterpret_cast<const char*>(indices.data()), std::streamsize(sizeof(GLushort) * node.nIndices));
+			static const char padding[8] = {};
+			builder.out.write(padding, std::streamsize(UAlign8(bytes) - bytes));
+			builder.offset += UAlign8(bytes);
+		}
+		else
+			builder.stats.nEmpty++;
+
+		builder.nodes.push_back(node);
+		builder.nodeMin.push_back(boundsMin);
+		builder.nodeMax.push_back(boundsMax);
+		return uint32_t(builder.nodes.size() - 1);
+	}
+
+	// Build the subtree of triangles [first, first + count) of the build order,
+	// returning its root and that node's geometry for the parent to simplify
+	uint32_t UBuildNode(Builder& builder, GLuint first, GLuint count, GLuint depth, MeshGen::MeshData& geometry)
+	{
+		builder.stats.depth = std::max(builder.stats.depth, depth + 1);
+
+		if (count <= MeshStream::leafTriangles)
+		{
+			UExtractTriangles(builder, first, count, geometry);
+			if (geometry.VertexCount() <= MeshStream::maxNodeVertices || count == 1)
+			{
+				glm::vec3 boundsMin(geometry.verts[0], geometry.verts[1], geometry.verts[2]);
+				glm::vec3 boundsMax = boundsMin;
+				for (size_t v = 0; v < geometry.verts.size(); v += MeshGen::floatsPerVertexTotal)
+				{
+					glm::vec3 position(geometry.verts[v], geometry.verts[v + 1], geometry.verts[v + 2]);
+					boundsMin = glm::min(boundsMin, position);
+					boundsMax = glm::max(boundsMax, position);
+				}
+				builder.stats.nLeaves++;
+				MeshGen::MeshData written = geometry;
+				return UWriteNode(builder, written, 0.0f, NO_NODE, NO_NODE, boundsMin, boundsMax);
+			}
+		}
+
+		// split at the median centroid along the longest side of the centroids' bounds
+		glm::vec3 centroidMin = builder.centroids[builder.triangles[first]];
+		glm::vec3 centroidMax = centroidMin;
+		for (GLuint t = first; t < first + count; t++)
+		{
+			centroidMin = glm::min(centroidMin, builder.centroids[builder.triangles[t]]);
+			centroidMax = glm::max(centroidMax, builder.centroids[builder.triangles[t]]);
+		}
+		glm::vec3 extent = centroidMax - centroidMin;
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		GLuint half = count / 2;
+		std::vector<GLuint>::iterator begin = builder.triangles.begin() + first;
+		std::nth_element(begin, begin + half, begin + count, [&builder, axis](GLuint a, GLuint b)
+		{
+			return builder.centroids[a][axis] < builder.centroids[b][axis];
+		});
+
+		MeshGen::MeshData leftGeometry;
+		MeshGen::MeshData rightGeometry;
+		uint32_t left = UBuildNode(builder, first, half, depth + 1, leftGeometry);
+		uint32_t right = UBuildNode(builder, first + half, count - half, depth + 1, rightGeometry);
+
+		float error = 0.0f;
+		geometry = MeshGen::MeshData();
+		if (!leftGeometry.indices.empty() && !rightGeometry.indices.empty())
+		{
+			// errors add up along the chain of simplifications
+			error = USimplifyChildren(leftGeometry, rightGeometry, geometry);
+			error += std::max(builder.nodes[left].error, builder.nodes[right].error);
+		}
+
+		glm::vec3 boundsMin = glm::min(builder.nodeMin[left], builder.nodeMin[right]);
+		glm::vec3 boundsMax = glm::max(builder.nodeMax[left], builder.nodeMax[right]);
+		MeshGen::MeshData written = geometry;
+		return UWriteNode(builder, written, error, left, right, boundsMin, boundsMax);
+	}
+}
+
+///////////////////////////////////////////////////
+//	UBuild(MeshGen::MeshData&, const char*, BuildStats&)
+//
+//	data: source mesh, welded in place
+//	filename: stream file to write
+//	stats: receives the size of the hierarchy
+//
+//	Build the cluster hierarchy of a mesh and write it
+//	to a stream file. This is the offline step: the
+//	source mesh is in memory once, the viewer that
+//	streams the file never holds it.
+///////////////////////////////////////////////////
+bool MeshStream::UBuild(MeshGen::MeshData& data, const char* filename, BuildStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats = BuildStats();
+
+	MeshOpt::UWeldVertices(data);
+	const GLuint nTriangles = GLuint(data.indices.size() / 3);
+	if (nTriangles == 0)
+		return false;
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	FileHeader header = {};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	Builder builder = { data, std::vector<GLuint>(nTriangles), std::vector<glm::vec3>(nTriangles), out, UAlign8(sizeof(header)), {}, {}, {}, stats };
+	out.write("\0\0\0\0\0\0\0\0", std::streamsize(builder.offset - sizeof(header)));
+	for (GLuint t = 0; t < nTriangles; t++)
+	{
+		builder.triangles[t] = t;
+		glm::vec3 sum(0.0f);
+		for (GLuint corner = 0; corner < 3; corner++)
+		{
+			const GLfloat* position = &data.verts[data.indices[t * 3 + corner] * MeshGen::floatsPerVertexTotal];
+			sum += glm::vec3(position[0], position[1], position[2]);
+		}
+		builder.centroids[t] = sum / 3.0f;
+	}
+
+	MeshGen::MeshData rootGeometry;
+	header.root = UBuildNode(builder, 0, nTriangles, 0, rootGeometry);
+
+	std::memcpy(header.magic, MESH_STREAM_MAGIC, sizeof(MESH_STREAM_MAGIC));
+	header.version = MESH_STREAM_VERSION;
+	header.nNodes = uint32_t(builder.nodes.size());
+	header.tableOffset = builder.offset;
+	std::memcpy(header.boundsMin, &builder.nodeMin[header.root][0], sizeof(header.boundsMin));
+	std::memcpy(header.boundsMax, &builder.nodeMax[header.root][0], sizeof(header.boundsMax));
+	out.write(reinterpret_cast<const char*>(builder.nodes.data()), std::streamsize(sizeof(FileNode) * builder.nodes.size()));
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!out)
+		return false;
+
+	stats.nNodes = header.nNodes;
+	stats.bytes = header.tableOffset + sizeof(FileNode) * header.nNodes;
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	stats.milliseconds = elapsed.count();
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Open(const char*, GLuint)
+//
+//	filename: stream file written by UBuild()
+//	budgetBytes: GPU memory for resident nodes
+//
+//	Map the stream file and create the GPU slots.
+//	Returns false when the file is missing or damaged.
+///////////////////////////////////////////////////
+bool MeshStream::Open(const char* filename, GLuint budgetBytes)
+{
+	Close();
+	if (!file.Open(filename))
+		return false;
+
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(file.data);
+	if (file.size < sizeof(FileHeader)
+		|| std::memcmp(header->magic, MESH_STREAM_MAGIC, sizeof(MESH_STREAM_MAGIC)) != 0
+		|| header->version != MESH_STREAM_VERSION
+		|| header->tableOffset % 8 != 0
+		|| header->tableOffset + sizeof(FileNode) * uint64_t(header->nNodes) > file.size
+		|| header->root >= header->nNodes)
+	{
+		file.Close();
+		return false;
+	}
+
+	nodes = file.data + header->tableOffset;
+	nNodes = header->nNodes;
+	root = header->root;
+	boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	for (GLuint i = 0; i < nNodes; i++)
+	{
+		if (!UValidNode(UNodeAt(nodes, i), i, file.data, file.size))
+		{
+			Close();
+			return false;
+		}
+	}
+
+	// fixed slots: a node always fits one, so the budget never fragments
+	nSlots = std::max(1u, budgetBytes / (SLOT_VERTEX_BYTES + SLOT_INDEX_BYTES));
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(SLOT_VERTEX_BYTES) * nSlots, nullptr, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &ibo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+	glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(SLOT_INDEX_BYTES) * nSlots, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glBindVertexBuffer(VERTEX_BINDING, vbo, 0, VERTEX_STRIDE);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	Meshes::FloatLayout::USetup(VERTEX_BINDING);
+	glBindVertexArray(0);
+
+	NodeState empty = { -1, 0, 0 };
+	state.assign(nNodes, empty);
+	freeSlots.clear();
+	for (GLuint slot = nSlots; slot > 0; slot--)
+		freeSlots.push_back(slot - 1);
+	residentNodes.clear();
+	frame = 0;
+	stats = Stats();
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Close()
+//
+//	Delete the GPU slots and unmap the file
+///////////////////////////////////////////////////
+void MeshStream::Close()
+{
+	if (vao != 0)
+	{
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &ibo);
+		vao = vbo = ibo = 0;
+	}
+	file.Close();
+	nodes = nullptr;
+	nNodes = 0;
+	nSlots = 0;
+	state.clear();
+	freeSlots.clear();
+	residentNodes.clear();
+}
+
+///////////////////////////////////////////////////
+//	Update(const glm::mat4&, const glm::mat4&, const glm::mat4&, float, float)
+//
+//	model, view, projection: transforms of this frame
+//	viewportHeight: pixels
+//	pixelError: largest projected error of a drawn node
+//
+//	Pick the nodes to draw this frame and page nodes in.
+//	Walking down from the root, a node is refined while
+//	its error is over pixelError on the screen and all its
+//	visible children are resident; otherwise it is drawn
+//	and the missing children are requested. The requests
+//	are uploaded largest on screen first, evicting the
+//	nodes unused for longest when the budget is full.
+///////////////////////////////////////////////////
+void MeshStream::Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float pixelError)
+{
+	frame++;
+	counts.clear();
+	offsets.clear();
+	baseVertices.clear();
+	requests.clear();
+	stats.nodesDrawn = 0;
+	stats.trianglesDrawn = 0;
+	if (nNodes == 0)
+		return;
+
+	// frustum planes in object space, from the rows of the model-view-projection matrix
+	glm::mat4 clip = projection * view * model;
+	glm::vec4 planes[6];
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+		glm::vec4 w(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+		planes[2 * i] = w + row;
+		planes[2 * i + 1] = w - row;
+	}
+	auto visible = [&planes](const FileNode& node)
+	{
+		glm::vec3 center(node.center[0], node.center[1], node.center[2]);
+		for (int i = 0; i < 6; i++)
+		{
+			glm::vec3 normal(planes[i]);
+			if (glm::dot(normal, center) + planes[i].w < -node.radius * glm::length(normal))
+				return false;
+		}
+		return true;
+	};
+
+	// pixels per object space unit at the nearest point of a node
+	glm::mat4 modelView = view * model;
+	float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f * scale;
+	bool perspective = projection[3][3] == 0.0f;
+	auto pixelScale = [&](const FileNode& node)
+	{
+		if (!perspective)
+			return pixelsPerUnit;
+		glm::vec4 center = modelView * glm::vec4(node.center[0], node.center[1], node.center[2], 1.0f);
+		return pixelsPerUnit / glm::max(-center.z - node.radius * scale, MIN_PROJECTION_DEPTH);
+	};
+
+	std::vector<GLuint> stack(1, root);
+	while (!stack.empty())
+	{
+		GLuint index = stack.back();
+		stack.pop_back();
+		const FileNode& node = UNodeAt(nodes, index);
+		if (!visible(node))
+			continue;
+		state[index].lastUsed = frame;
+
+		float pixels = pixelScale(node);
+		bool leaf = node.children[0] == NO_NODE;
+		if (leaf || (node.nVertices > 0 && node.error * pixels <= pixelError))
+		{
+			if (UResident(index))
+				UAddDraw(index);
+			else
+				URequest(index, node.radius * pixels);
+			continue;
+		}
+
+		// refine once every visible child can be drawn or refined further
+		bool ready = true;
+		for (uint32_t child : node.children)
+		{
+			const FileNode& childNode = UNodeAt(nodes, child);
+			if (visible(childNode) && !UResident(child))
+			{
+				URequest(child, childNode.radius * pixelScale(childNode));
+				ready = false;
+			}
+		}
+
+		if (!ready && UResident(index) && node.nVertices > 0)
+			UAddDraw(index);
+		else
+		{
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+
+	UUpload();
+	stats.nodesResident = GLuint(residentNodes.size());
+	stats.requests = GLuint(requests.size());
+}
+
+///////////////////////////////////////////////////
+//	Draw()
+//
+//	Draw the nodes picked by Update() with one
+//	multi-draw; leaves the stream's VAO bound
+///////////////////////////////////////////////////
+void MeshStream::Draw()
+{
+	if (counts.empty())
+		return;
+
+	glBindVertexArray(vao);
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_SHORT, offsets.data(), GLsizei(counts.size()), baseVertices.data());
+}
+
+// A node can be drawn: it is in a slot, or has no geometry and is only refined
+bool MeshStream::UResident(GLuint node) const
+{
+	return state[node].slot >= 0 || UNodeAt(nodes, node).nVertices == 0;
+}
+
+// Ask for a node once per frame
+void MeshStream::URequest(GLuint node, float priority)
+{
+	if (state[node].requested == frame)
+		return;
+	state[node].requested = frame;
+	Request request = { priority, node };
+	requests.push_back(request);
+}
+
+void MeshStream::UAddDraw(GLuint node)
+{
+	const FileNode& fileNode = UNodeAt(nodes, node);
+	GLuint slot = GLuint(state[node].slot);
+	counts.push_back(GLsizei(fileNode.nIndices));
+	offsets.push_back((const void*)(size_t(SLOT_INDEX_BYTES) * slot));
+	baseVertices.push_back(GLint(slot * maxNodeVertices));
+	stats.nodesDrawn++;
+	stats.trianglesDrawn += fileNode.nIndices / 3;
+}
+
+// Copy the most wanted requested nodes from the mapping into GPU slots
+void MeshStream::UUpload()
+{
+	std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) { return a.priority > b.priority; });
+
+	GLuint uploads = 0;
+	for (const Request& request : requests)
+	{
+		if (uploads == MAX_UPLOADS_PER_FRAME)
+			break;
+
+		GLint slot;
+		if (!freeSlots.empty())
+		{
+			slot = GLint(freeSlots.back());
+			freeSlots.pop_back();
+		}
+		else
+			slot = UEvict();
+		if (slot < 0)
+			break;	// everything resident is in use, the drawn nodes stay coarser
+
+		const FileNode& node = UNodeAt(nodes, request.node);
+		const unsigned char* data = file.data + node.offset;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(SLOT_VERTEX_BYTES) * slot, GLsizeiptr(VERTEX_STRIDE) * node.nVertices, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(SLOT_INDEX_BYTES) * slot, GLsizeiptr(sizeof(GLushort)) * node.nIndices, data + size_t(VERTEX_STRIDE) * node.nVertices);
+
+		// counts as used so it stays until the traversal gets to it
+		state[request.node].slot = slot;
+		state[request.node].lastUsed = frame;
+		residentNodes.push_back(request.node);
+		uploads++;
+		stats.uploads++;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// Free the slot of the least recently used node the GPU is done with, -1 if none
+GLint MeshStream::UEvict()
+{
+	size_t oldest = residentNodes.size();
+	for (size_t i = 0; i < residentNodes.size(); i++)
+	{
+		GLuint lastUsed = state[residentNodes[i]].lastUsed;
+		if (lastUsed + FRAMES_IN_FLIGHT <= frame && (oldest == residentNodes.size() || lastUsed < state[residentNodes[oldest]].lastUsed))
+			oldest = i;
+	}
+	if (oldest == residentNodes.size())
+		return -1;
+
+	GLuint node = residentNodes[oldest];
+	residentNodes[oldest] = residentNodes.back();
+	residentNodes.pop_back();
+	GLint slot = state[node].slot;
+	state[node].slot = -1;
+	stats.evictions++;
+	return slot;
+}
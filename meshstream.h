@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshstream.h
+// ========
+// out-of-core meshes: a cluster hierarchy stored in a memory mapped file and
+// paged in and out of a fixed GPU budget by the camera
+//
+// UBuild() splits a mesh into spatially coherent clusters (leaves of a
+// binary tree split at the median of the longest axis) and gives every
+// inner node a simplified version of its two children, so the tree goes
+// from coarse (root) to fine (leaves). Each node fits one slot of the GPU
+// buffers. At run time Update() picks the coarsest nodes whose error stays
+// within a pixel budget, draws the resident ones and uploads the missing
+// ones straight from the mapping, evicting the least recently used. Only
+// the node table and the nodes' GPU slots stay in memory, whatever the size
+// of the source mesh.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mappedfile.h"
+#include "meshgen.h"
+
+class MeshStream
+{
+
+public:
+
+	// Size of one GPU slot: the most vertices and triangles of a node
+	static const GLuint maxNodeVertices = 2048;
+	static const GLuint maxNodeTriangles = 2048;
+
+	// Triangles a leaf is split down to
+	static const GLuint leafTriangles = 1024;
+
+	// Hierarchy made by UBuild
+	struct BuildStats
+	{
+		GLuint nNodes;
+		GLuint nLeaves;
+		GLuint nEmpty;			// Inner nodes whose simplification did not fit a slot, always refined
+		GLuint depth;
+		uint64_t bytes;			// File size
+		double milliseconds;
+	};
+
+	// Residency of the last Update and totals since Open
+	struct Stats
+	{
+		GLuint nodesResident;
+		GLuint nodesDrawn;
+		GLuint trianglesDrawn;
+		GLuint requests;		// Missing nodes wanted this frame
+		GLuint uploads;			// Total
+		GLuint evictions;		// Total
+	};
+
+	glm::vec3 boundsMin;	// Object space bounds of the whole mesh
+	glm::vec3 boundsMax;
+	Stats stats;
+
+public:
+	MeshStream() = default;
+	~MeshStream() { Close(); }
+
+	MeshStream(const MeshStream&) = delete;
+	MeshStream& operator=(const MeshStream&) = delete;
+
+	static bool UBuild(MeshGen::MeshData &data, const char *filename, BuildStats &stats);
+
+	bool Open(const char *filename, GLuint budgetBytes);
+	void Close();
+	void Update(const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &projection, float viewportHeight, float pixelError);
+	void Draw();
+
+	GLuint NodeCount() const { return nNodes; }
+	GLuint SlotCount() const { return nSlots; }
+
+private:
+
+	// Run time state of one node
+	struct NodeState
+	{
+		GLint slot;				// GPU slot, -1 when not resident
+		GLuint lastUsed;		// Frame that last visited the node
+		GLuint requested;		// Frame that last requested it
+	};
+
+	// Missing node wanted this frame, uploaded in order of priority
+	struct Request
+	{
+		float priority;			// Projected size in pixels
+		GLuint node;
+	};
+
+	MappedFile file;
+	const void *nodes = nullptr;	// Node table in the mapping
+	GLuint nNodes = 0;
+	GLuint root = 0;
+
+	GLuint vao = 0;
+	GLuint vbo = 0;
+	GLuint ibo = 0;
+	GLuint nSlots = 0;
+	GLuint frame = 0;
+	std::vector<NodeState> state;
+	std::vector<GLuint> freeSlots;
+	std::vector<GLuint> residentNodes;
+	std::vector<Request> requests;
+
+	// Multi-draw arguments of the nodes picked by Update
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+	std::vector<GLint> baseVertices;
+
+	bool UResident(GLuint node) const;
+	void URequest(GLuint node, float priority);
+	void UAddDraw(GLuint node);
+	void UUpload();
+	GLint UEvict();
+};
@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshtables.h
+// ========
+// layout of the round primitives (cylinder, tapered cylinder, cone, sphere)
+// written once as constexpr templates, so the default resolutions are built
+// into read-only vertex and index tables at compile time
+//
+// The layout functions write through a sink: MeshGen passes one that appends
+// to a MeshData at runtime, the templated table generators pass a Table whose
+// std::arrays are sized from the slice and stack counts. Both paths run the
+// same code with the same constexpr sine and cosine, so a table holds exactly
+// what the runtime generator would produce for the same parameters.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+
+#include "meshgen.h"
+
+class MeshTables
+{
+
+public:
+
+	// Fixed size mesh data filled at compile time, with the normals left zero
+	// like the runtime generators leave them for MeshNormals
+	template<GLuint NVertices, GLuint NIndices, GLuint NParts>
+	struct Table
+	{
+		std::array<GLfloat, NVertices * MeshGen::floatsPerVertexTotal> verts{};
+		std::array<GLuint, NIndices> indices{};
+		std::array<MeshGen::MeshPart, NParts> parts{};
+		GLuint nVertices = 0;
+		GLuint nIndices = 0;
+		GLuint nParts = 0;
+
+		// True once the layout filled exactly the sizes computed for it
+		constexpr bool Full() const { return nVertices == NVertices && nIndices == NIndices && nParts == NParts; }
+
+		constexpr GLuint VertexCount() const { return nVertices; }
+
+		constexpr GLuint AddVertex(float x, float y, float z, float u, float v)
+		{
+			GLuint offset = nVertices * MeshGen::floatsPerVertexTotal;
+			const GLfloat vertex[MeshGen::floatsPerVertexTotal] = { x, y, z, 0.0f, 0.0f, 0.0f, u, v };
+			for (GLuint i = 0; i < MeshGen::floatsPerVertexTotal; i++)
+				verts[offset + i] = vertex[i];
+			return nVertices++;
+		}
+
+		constexpr void AddTriangle(GLuint i0, GLuint i1, GLuint i2)
+		{
+			indices[nIndices++] = i0;
+			indices[nIndices++] = i1;
+			indices[nIndices++] = i2;
+		}
+
+		constexpr void BeginPart()
+		{
+			parts[nParts++] = MeshGen::MeshPart{ nIndices, 0 };
+		}
+
+		constexpr void EndPart()
+		{
+			parts[nParts - 1].nIndices = nIndices - parts[nParts - 1].firstIndex;
+		}
+	};
+
+	// Cylinder and tapered cylinder: two cap fans and the smooth sides
+	template<int Slices>
+	using CylinderTable = Table<4 * (Slices + 1), 12 * Slices, 3>;
+
+	// Cone: the bottom cap fan and the sides, one triangle per slice
+	template<int Slices>
+	using ConeTable = Table<3 * Slices + 3, 6 * Slices, 2>;
+
+	// Sphere: a grid of (Slices + 1) x (Stacks + 1) vertices with a single triangle per quad at the poles
+	template<int Slices, int Stacks>
+	using SphereTable = Table<(Slices + 1) * (Stacks + 1), 6 * Slices * (Stacks - 1), 1>;
+
+public:
+
+	template<int Slices>
+	static constexpr CylinderTable<Slices> UCylinderTable(float bottomRadius, float topRadius, float height)
+	{
+		static_assert(Slices >= 3, "a cylinder needs at least 3 slices");
+		CylinderTable<Slices> table;
+		ULayoutCylinder(table, Slices, bottomRadius, topRadius, height);
+		return table;
+	}
+
+	template<int Slices>
+	static constexpr ConeTable<Slices> UConeTable(float radius, float height)
+	{
+		static_assert(Slices >= 3, "a cone needs at least 3 slices");
+		ConeTable<Slices> table;
+		ULayoutCone(table, Slices, radius, height);
+		return table;
+	}
+
+	template<int Slices, int Stacks>
+	static constexpr SphereTable<Slices, Stacks> USphereTable(float radius)
+	{
+		static_assert(Slices >= 3 && Stacks >= 2, "a sphere needs at least 3 slices and 2 stacks");
+		SphereTable<Slices, Stacks> table;
+		ULayoutSphere(table, Slices, Stacks, radius);
+		return table;
+	}
+
+	///////////////////////////////////////////////////
+	//	ULayoutCylinder(Sink&, int, float, float, float)
+	//
+	//	Lay out a (tapered) cylinder standing on the XZ plane
+	//	Parts: CYLINDER_BOTTOM, CYLINDER_TOP, CYLINDER_SIDES
+	///////////////////////////////////////////////////
+	template<class Sink>
+	static constexpr void ULayoutCylinder(Sink& sink, int slices, float bottomRadius, float topRadius, float height)
+	{
+		sink.BeginPart();
+		ULayoutCap(sink, slices, bottomRadius, 0.0f, 0.0f, false);
+		sink.EndPart();
+
+		sink.BeginPart();
+		ULayoutCap(sink, slices, topRadius, height, 0.0f, true);
+		sink.EndPart();
+
+		sink.BeginPart();
+		ULayoutFrustumSides(sink, slices, bottomRadius, topRadius, 0.0f, height, 0.0f, true);
+		sink.EndPart();
+	}
+
+	///////////////////////////////////////////////////
+	//	ULayoutCone(Sink&, int, float, float)
+	//
+	//	Lay out a cone standing on the XZ plane
+	//	Parts: CYLINDER_BOTTOM, CONE_SIDES
+	///////////////////////////////////////////////////
+	template<class Sink>
+	static constexpr void ULayoutCone(Sink& sink, int slices, float radius, float height)
+	{
+		sink.BeginPart();
+		ULayoutCap(sink, slices, radius, 0.0f, 0.0f, false);
+		sink.EndPart();
+
+		sink.BeginPart();
+		ULayoutFrustumSides(sink, slices, radius, 0.0f, 0.0f, height, 0.0f, true);
+		sink.EndPart();
+	}
+
+	///////////////////////////////////////////////////
+	//	ULayoutSphere(Sink&, int, int, float)
+	//
+	//	Lay out a UV sphere centered on the origin
+	///////////////////////////////////////////////////
+	template<class Sink>
+	static constexpr void ULayoutSphere(Sink& sink, int slices, int stacks, float radius)
+	{
+		sink.BeginPart();
+		GLuint first = sink.VertexCount();
+		for (int s = 0; s <= stacks; s++)
+		{
+			float phi = PI * s / stacks;
+			float sinPhi = s == 0 || s == stacks ? 0.0f : USin(phi);	// exact poles
+			float cosPhi = UCos(phi);
+			for (int i = 0; i <= slices; i++)
+			{
+				float theta = TWO_PI * (i % slices) / slices;
+				sink.AddVertex(sinPhi * UCos(theta) * radius, cosPhi * radius, sinPhi * USin(theta) * radius, float(i) / slices, 1.0f - float(s) / stacks);
+			}
+		}
+
+		GLuint row = slices + 1;
+		for (int s = 0; s < stacks; s++)
+		{
+			for (int i = 0; i < slices; i++)
+			{
+				GLuint a = first + s * row + i;
+				GLuint b = a + row;
+				GLuint c = a + 1;
+				GLuint d = b + 1;
+
+				// the pole rows collapse to a point, so only one triangle per quad there
+				if (s != 0)
+					sink.AddTriangle(a, c, b);
+				if (s != stacks - 1)
+					sink.AddTriangle(c, d, b);
+			}
+		}
+		sink.EndPart();
+	}
+
+	///////////////////////////////////////////////////
+	//	ULayoutCap(Sink&, int, float, float, float, bool)
+	//
+	//	Add a flat disk facing up (top) or down (bottom)
+	//	at height y, as a fan of triangles around its center
+	///////////////////////////////////////////////////
+	template<class Sink>
+	static constexpr void ULayoutCap(Sink& sink, int slices, float radius, float y, float angleOffset, bool top)
+	{
+		GLuint center = sink.AddVertex(0.0f, y, 0.0f, 0.5f, 0.5f);
+
+		for (int i = 0; i < slices; i++)
+		{
+			float angle = angleOffset + TWO_PI * i / slices;
+			float c = UCos(angle);
+			float s = USin(angle);
+			sink.AddVertex(radius * c, y, radius * s, 0.5f + 0.5f * c, top ? 0.5f - 0.5f * s : 0.5f + 0.5f * s);
+		}
+
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint i0 = center + 1 + i;
+			GLuint i1 = center + 1 + (i + 1) % slices;
+			if (top)
+				sink.AddTriangle(center, i1, i0);
+			else
+				sink.AddTriangle(center, i0, i1);
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	ULayoutFrustumSides(Sink&, int, float, float, float, float, float, bool)
+	//
+	//	Add the sides of a (possibly tapered) cylinder starting at height y0.
+	//	Smooth sides share vertices around the ring, flat sides get
+	//	their own vertices per face so their edges stay hard.
+	//	A top radius of zero closes the sides to a point.
+	///////////////////////////////////////////////////
+	template<class Sink>
+	static constexpr void ULayoutFrustumSides(Sink& sink, int slices, float bottomRadius, float topRadius, float y0, float height, float angleOffset, bool smooth)
+	{
+		float y1 = y0 + height;
+
+		if (smooth)
+		{
+			GLuint first = sink.VertexCount();
+			for (int i = 0; i <= slices; i++)
+			{
+				float angle = angleOffset + TWO_PI * (i % slices) / slices;
+				float c = UCos(angle);
+				float s = USin(angle);
+				float u = float(i) / slices;
+				sink.AddVertex(bottomRadius * c, y0, bottomRadius * s, u, 0.0f);
+				sink.AddVertex(topRadius * c, y1, topRadius * s, u, 1.0f);
+			}
+
+			for (int i = 0; i < slices; i++)
+			{
+				GLuint b0 = first + 2 * i;
+				GLuint t0 = b0 + 1;
+				GLuint b1 = b0 + 2;
+				GLuint t1 = b0 + 3;
+				sink.AddTriangle(b0, t0, b1);
+				if (topRadius != 0.0f)
+					sink.AddTriangle(b1, t0, t1);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < slices; i++)
+			{
+				float a0 = angleOffset + TWO_PI * i / slices;
+				float a1 = angleOffset + TWO_PI * (i + 1) / slices;
+				float c0 = UCos(a0);
+				float s0 = USin(a0);
+				float c1 = UCos(a1);
+				float s1 = USin(a1);
+				GLuint ib0 = sink.AddVertex(bottomRadius * c0, y0, bottomRadius * s0, 0.0f, 0.0f);
+				GLuint it0 = sink.AddVertex(topRadius * c0, y1, topRadius * s0, 0.0f, 1.0f);
+				GLuint ib1 = sink.AddVertex(bottomRadius * c1, y0, bottomRadius * s1, 1.0f, 0.0f);
+				GLuint it1 = sink.AddVertex(topRadius * c1, y1, topRadius * s1, 1.0f, 1.0f);
+				sink.AddTriangle(ib0, it0, ib1);
+				sink.AddTriangle(ib1, it0, it1);
+			}
+		}
+	}
+
+	// sine and cosine usable in constant expressions (std::sin is not constexpr);
+	// evaluated in double and rounded once to float
+	static constexpr float USin(float angle)
+	{
+		return float(USeriesSin(angle));
+	}
+
+	static constexpr float UCos(float angle)
+	{
+		return float(USeriesSin(double(angle) + HALF_PI_D));
+	}
+
+private:
+
+	static constexpr float PI = 3.14159265358979323846f;
+	static constexpr float TWO_PI = 6.28318530717958647692f;
+	static constexpr double PI_D = 3.14159265358979323846;
+	static constexpr double HALF_PI_D = 1.57079632679489661923;
+	static constexpr double TWO_PI_D = 6.28318530717958647692;
+
+	// Taylor series of sin after reducing x to [-pi/2, pi/2], where
+	// 12 terms are well below double precision
+	static constexpr double USeriesSin(double x)
+	{
+		double turns = x / TWO_PI_D;
+		long long n = (long long)(turns >= 0.0 ? turns + 0.5 : turns - 0.5);
+		x -= double(n) * TWO_PI_D;
+		if (x > HALF_PI_D)
+			x = PI_D - x;
+		else if (x < -HALF_PI_D)
+			x = -PI_D - x;
+
+		double x2 = x * x;
+		double term = x;
+		double sum = x;
+		for (int k = 1; k < 12; k++)
+		{
+			term *= -x2 / double((2 * k) * (2 * k + 1));
+			sum += term;
+		}
+		return sum;
+	}
+};
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ========
+// the draws of a frame as 64 bit sort keys, radix sorted so draws sharing GL
+// state run back to back
+///////////////////////////////////////////////////////////////////////////////
+
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	// Bits sorted per radix pass
+	const int RADIX_BITS = 8;
+	const GLuint RADIX_SIZE = 1u << RADIX_BITS;
+
+	static_assert(RenderQueue::programBits + RenderQueue::vertexArrayBits + RenderQueue::textureBits
+		+ RenderQueue::materialBits + RenderQueue::depthBits + RenderQueue::itemBits == 64, "sort key fields fill 64 bits");
+	static_assert(RenderQueue::itemBits % RADIX_BITS == 0, "radix passes start above the item index");
+
+	// Append a field to a key, masked to its bits
+	uint64_t UPack(uint64_t key, uint64_t value, int bits)
+	{
+		return (key << bits) | (value & ((uint64_t(1) << bits) - 1));
+	}
+}
+
+///////////////////////////////////////////////////
+//	Submit(const DrawState&)
+//
+//	state: sort fields of the draw
+//
+//	Add a draw; the nth draw submitted since Clear() is
+//	item n. Returns false, dropping the draw, once the
+//	queue holds maxItems draws.
+///////////////////////////////////////////////////
+bool RenderQueue::Submit(const DrawState& state)
+{
+	if (keys.size() >= maxItems)
+	{
+		std::cout << "ERROR: Render queue full, draw dropped" << std::endl;
+		return false;
+	}
+
+	keys.push_back(UKey(state, GLuint(keys.size())));
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Sort()
+//
+//	Put the submitted draws in the order selected by
+//	order. Draws with equal keys keep their submission
+//	order.
+///////////////////////////////////////////////////
+void RenderQueue::Sort()
+{
+	if (order == SORT_NONE || keys.size() < 2)
+		return;
+
+	// least significant digit first: the keys start in item order, which the
+	// stable passes keep between equal states, so the item bits need no pass
+	scratch.resize(keys.size());
+	for (int shift = itemBits; shift < 64; shift += RADIX_BITS)
+	{
+		GLuint counts[RADIX_SIZE] = {};
+		for (uint64_t key : keys)
+			counts[(key >> shift) & (RADIX_SIZE - 1)]++;
+
+		// a digit all the keys share leaves their order as it is
+		if (counts[(keys[0] >> shift) & (RADIX_SIZE - 1)] == keys.size())
+			continue;
+
+		GLuint offset = 0;
+		for (GLuint& count : counts)
+		{
+			GLuint digitCount = count;
+			count = offset;
+			offset += digitCount;
+		}
+		for (uint64_t key : keys)
+			scratch[counts[(key >> shift) & (RADIX_SIZE - 1)]++] = key;
+		keys.swap(scratch);
+	}
+}
+
+// Pack the fields of a draw into its key, in the order of the sort
+uint64_t RenderQueue::UKey(const DrawState& state, GLuint item) const
+{
+	const uint64_t depthSteps = (uint64_t(1) << depthBits) - 1;
+	uint64_t depth = uint64_t(std::min(std::max(state.depth, 0.0f), 1.0f) * depthSteps);
+
+	uint64_t key = UPack(0, state.program, programBits);
+	if (order == SORT_FRONT_TO_BACK)
+		key = UPack(key, depth, depthBits);
+	key = UPack(key, state.vertexArray, vertexArrayBits);
+	key = UPack(key, state.texture, textureBits);
+	key = UPack(key, state.material, materialBits);
+	if (order != SORT_FRONT_TO_BACK)
+		key = UPack(key, depth, depthBits);
+	return UPack(key, item, itemBits);
+}
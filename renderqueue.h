@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ========
+// the draws of a frame as 64 bit sort keys, radix sorted so draws sharing GL
+// state run back to back
+//
+// A key packs, from the most significant bits: the program, the vertex array,
+// the texture, the material, the depth and the index of the draw in the
+// caller's own array of draws. Executing the sorted draws in order, only the
+// state that differs from the previous draw has to change. SORT_FRONT_TO_BACK
+// puts the depth right after the program instead, so opaque draws reach the
+// depth test nearest first and hidden fragments are rejected early, at the
+// cost of more state changes.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+class RenderQueue
+{
+
+public:
+
+	// Bits of each field of a key. Values wider than their field are masked:
+	// draws may then sort less well, but each draw still sets its own state.
+	static const int programBits = 3;
+	static const int vertexArrayBits = 8;
+	static const int textureBits = 5;
+	static const int materialBits = 8;
+	static const int depthBits = 16;
+	static const int itemBits = 24;
+
+	// Most draws a frame can submit
+	static const GLuint maxItems = 1u << itemBits;
+
+	// Order Sort() puts the draws in
+	enum SortOrder
+	{
+		SORT_NONE,			// Submission order
+		SORT_STATE,			// Program, vertex array, texture, material, then front to back
+		SORT_FRONT_TO_BACK	// Program, then front to back, then the rest of the state
+	};
+
+	// Sort fields of one draw, small ids chosen by the caller
+	struct DrawState
+	{
+		GLuint program;
+		GLuint vertexArray;
+		GLuint texture;
+		GLuint material;
+		float depth;		// [0, 1] from the nearest to the farthest
+	};
+
+	SortOrder order = SORT_STATE;
+
+public:
+	void Clear() { keys.clear(); }
+	bool Submit(const DrawState &state);
+	void Sort();
+
+	GLuint Size() const { return GLuint(keys.size()); }
+	GLuint Item(GLuint i) const { return GLuint(keys[i] & (maxItems - 1)); }
+
+private:
+	uint64_t UKey(const DrawState &state, GLuint item) const;
+
+	std::vector<uint64_t> keys;
+	std::vector<uint64_t> scratch;
+};
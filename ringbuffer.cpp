@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// ringbuffer.cpp
+// ========
+// streaming buffer for data rewritten every frame: immutable storage mapped
+// once, persistently and coherently, split into FRAMES_IN_FLIGHT regions
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ringbuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+namespace
+{
+	// Regions start at multiples of this, the largest offset alignment common
+	// GL implementations require for uniform and storage buffer ranges; owners
+	// add the alignments of the actual implementation with Align()
+	const GLsizeiptr REGION_ALIGNMENT = 256;
+
+	// Nanoseconds of a single fence wait before it is repeated
+	const GLuint64 FENCE_WAIT_NS = 1000000000;
+
+	const GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+///////////////////////////////////////////////////
+//	Align(GLsizeiptr)
+//
+//	offsetAlignment: alignment GL requires of the
+//		offsets of the ranges bound from the regions,
+//		more than 0
+//
+//	Make the regions start at multiples of it too.
+//	Call before the first Claim().
+///////////////////////////////////////////////////
+void RingBuffer::Align(GLsizeiptr offsetAlignment)
+{
+	alignment = std::lcm(alignment, offsetAlignment);
+}
+
+///////////////////////////////////////////////////
+//	Claim(GLsizeiptr)
+//
+//	bytes: size of this frame's data, more than 0
+//
+//	Fence the region of the last frame, move to the
+//	next one and wait until the GPU is done reading
+//	it. The buffer is recreated larger when bytes do
+//	not fit a region. Returns the mapped memory of
+//	the region, at Offset() in Buffer().
+///////////////////////////////////////////////////
+void* RingBuffer::Claim(GLsizeiptr bytes)
+{
+	// the commands of the last frame are all submitted now
+	if (buffer != 0)
+	{
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region = (region + 1) % FRAMES_IN_FLIGHT;
+	}
+
+	if (bytes > regionBytes)
+		UCreate(bytes);
+	else
+		UWait(region);
+	stats.claims++;
+	return mapped + Offset();
+}
+
+// Block until the commands fenced for a region completed, counting the time
+// as a stall unless they already had
+void RingBuffer::UWait(GLuint waited)
+{
+	if (fences[waited] == 0)
+		return;
+
+	GLenum status = glClientWaitSync(fences[waited], 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+	{
+		auto start = std::chrono::steady_clock::now();
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fences[waited], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NS);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		stats.stalls++;
+		stats.stallMs += elapsed.count();
+	}
+	glDeleteSync(fences[waited]);
+	fences[waited] = 0;
+}
+
+// Replace the buffer with one whose regions hold bytes, at least doubling them,
+// once the GPU is done with all of the old one
+void RingBuffer::UCreate(GLsizeiptr bytes)
+{
+	for (GLuint i = 0; i < FRAMES_IN_FLIGHT; i++)
+		UWait(i);
+	GLsizeiptr grown = std::max(bytes, regionBytes * 2);
+	Destroy();
+
+	GLsizeiptr granularity = std::lcm(REGION_ALIGNMENT, alignment);
+	regionBytes = (grown + granularity - 1) / granularity * granularity;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, regionBytes * FRAMES_IN_FLIGHT, nullptr, MAP_FLAGS);
+	mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionBytes * FRAMES_IN_FLIGHT, MAP_FLAGS));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	region = 0;
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Unmap and delete the buffer and its fences. The
+//	stats are kept.
+///////////////////////////////////////////////////
+void RingBuffer::Destroy()
+{
+	for (GLsync& fence : fences)
+	{
+		glDeleteSync(fence);
+		fence = 0;
+	}
+	if (buffer != 0)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	mapped = nullptr;
+	regionBytes = 0;
+	region = 0;
+}
@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// ringbuffer.h
+// ========
+// streaming buffer for data rewritten every frame: immutable storage mapped
+// once, persistently and coherently, split into FRAMES_IN_FLIGHT regions
+//
+// Each frame claims the next region and writes its data straight into the
+// mapping, with no glBufferSubData copy and no orphaning. A fence after the
+// frame's commands guards its region; the region is only written again once
+// that fence signaled, FRAMES_IN_FLIGHT frames later, and the time spent
+// waiting on it is counted in Stats. The owner claims one region per frame
+// and points its bindings at Buffer() / Offset() after each claim; owners
+// binding ranges pass the offset alignments GL requires to Align() first.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+class RingBuffer
+{
+
+public:
+
+	// Regions of the buffer: the frame being written and those the GPU may still read
+	static const GLuint FRAMES_IN_FLIGHT = 3;
+
+	// Fence waits since the buffer was created
+	struct Stats
+	{
+		GLuint claims;		// Regions claimed
+		GLuint stalls;		// Claims whose region the GPU was still reading
+		double stallMs;		// Time spent waiting for those
+	};
+
+	Stats stats = {};
+
+public:
+	void Align(GLsizeiptr offsetAlignment);
+	void* Claim(GLsizeiptr bytes);
+	void Destroy();
+
+	GLuint Buffer() const { return buffer; }
+	GLintptr Offset() const { return GLintptr(region) * regionBytes; }	// Of the claimed region in Buffer()
+
+private:
+	void UWait(GLuint waited);
+	void UCreate(GLsizeiptr bytes);
+
+	GLuint buffer = 0;
+	unsigned char* mapped = nullptr;
+	GLsizeiptr alignment = 1;		// Regions start at multiples of this, besides REGION_ALIGNMENT
+	GLsizeiptr regionBytes = 0;
+	GLuint region = 0;
+	GLsync fences[FRAMES_IN_FLIGHT] = {};
+};
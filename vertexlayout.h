@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexlayout.h
+// ========
+// compile time description of a vertex layout: the vertex struct and its
+// attributes (shader location, component type and count, normalization,
+// byte offset)
+//
+// The stride, offsets and the separate attribute format setup
+// (glVertexAttribFormat / glVertexAttribBinding) are generated from the
+// type, and static_asserts check the attributes against the vertex struct
+// and against the inputs a shader declares. Changing the layout of a mesh
+// is changing its layout type.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+// Size of one component of an attribute type in bytes
+constexpr size_t UComponentSize(GLenum type)
+{
+	return type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT ? 4
+		: type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT ? 2
+		: 1;
+}
+
+// One attribute of a vertex, read by the shader input at Location
+template<GLuint Location, GLenum Type, GLint Count, bool Normalized, size_t Offset>
+struct VertexAttribute
+{
+	static constexpr GLuint location = Location;
+	static constexpr GLenum type = Type;
+	static constexpr GLint count = Count;
+	static constexpr bool normalized = Normalized;
+	static constexpr size_t offset = Offset;
+
+	static_assert(Count >= 1 && Count <= 4, "vertex attributes have 1 to 4 components");
+	static_assert(Type == GL_FLOAT || Type == GL_HALF_FLOAT || Normalized,
+		"integer attributes must be normalized, the shader inputs are floating point");
+
+	static constexpr size_t size = Count * UComponentSize(Type);
+
+	// Describe the attribute on the bound VAO and source it from binding
+	static void USetup(GLuint binding)
+	{
+		glEnableVertexAttribArray(Location);
+		glVertexAttribFormat(Location, Count, Type, Normalized, GLuint(Offset));
+		glVertexAttribBinding(Location, binding);
+	}
+};
+
+// An integer attribute, read unconverted by the int / uint shader input at Location
+template<GLuint Location, GLenum Type, GLint Count, size_t Offset>
+struct VertexIntegerAttribute
+{
+	static constexpr GLuint location = Location;
+	static constexpr GLenum type = Type;
+	static constexpr GLint count = Count;
+	static constexpr bool normalized = false;
+	static constexpr size_t offset = Offset;
+
+	static_assert(Count >= 1 && Count <= 4, "vertex attributes have 1 to 4 components");
+	static_assert(Type != GL_FLOAT && Type != GL_HALF_FLOAT, "integer attributes have an integer type");
+
+	static constexpr size_t size = Count * UComponentSize(Type);
+
+	// Describe the attribute on the bound VAO and source it from binding
+	static void USetup(GLuint binding)
+	{
+		glEnableVertexAttribArray(Location);
+		glVertexAttribIFormat(Location, Count, Type, GLuint(Offset));
+		glVertexAttribBinding(Location, binding);
+	}
+};
+
+// An input a shader declares: location and number of components (vec3 = 3)
+template<GLuint Location, GLint Components>
+struct ShaderInput
+{
+	static constexpr GLuint location = Location;
+	static constexpr GLint components = Components;
+};
+
+// Attributes lie inside the vertex and do not overlap each other
+template<class Vertex, class... Attributes>
+constexpr bool UVertexAttributesValid()
+{
+	size_t begin[] = { 0, Attributes::offset... };
+	size_t end[] = { 0, (Attributes::offset + Attributes::size)... };
+	GLuint location[] = { 0, Attributes::location... };
+	for (size_t i = 1; i < sizeof(begin) / sizeof(begin[0]); i++)
+	{
+		if (end[i] > sizeof(Vertex))
+			return false;
+		for (size_t j = 1; j < i; j++)
+		{
+			if (location[i] == location[j] || (begin[i] < end[j] && begin[j] < end[i]))
+				return false;
+		}
+	}
+	return true;
+}
+
+// Interleaved layout of Vertex with the given attributes
+template<class Vertex, class... Attributes>
+struct VertexLayout
+{
+	typedef Vertex VertexType;
+
+	static constexpr GLsizei stride = GLsizei(sizeof(Vertex));
+	static constexpr GLuint nAttributes = GLuint(sizeof...(Attributes));
+
+	///////////////////////////////////////////////////
+	//	USetup(GLuint)
+	//
+	//	binding: vertex buffer binding index the attributes read from
+	//
+	//	Enable and describe every attribute on the bound VAO;
+	//	the buffer is attached with glBindVertexBuffer(binding, ..., stride)
+	///////////////////////////////////////////////////
+	static void USetup(GLuint binding)
+	{
+		int expand[] = { 0, (Attributes::USetup(binding), 0)... };
+		(void)expand;
+	}
+
+	// True when an attribute feeds location
+	static constexpr bool UHasLocation(GLuint location)
+	{
+		bool found[] = { false, (Attributes::location == location)... };
+		for (bool f : found)
+			if (f)
+				return true;
+		return false;
+	}
+
+	// Components of the attribute at location, 0 when there is none
+	static constexpr GLint UCount(GLuint location)
+	{
+		GLint counts[] = { 0, (Attributes::location == location ? Attributes::count : 0)... };
+		GLint count = 0;
+		for (GLint c : counts)
+			count += c;
+		return count;
+	}
+
+	///////////////////////////////////////////////////
+	//	UFeeds<Inputs...>()
+	//
+	//	True when the layout feeds exactly the shader's input
+	//	locations: none is left reading the constant default
+	//	and no attribute is fetched for nothing. The component
+	//	counts may differ, e.g. for inputs the shader decodes.
+	///////////////////////////////////////////////////
+	template<class... Inputs>
+	static constexpr bool UFeeds()
+	{
+		bool fed[] = { true, UHasLocation(Inputs::location)... };
+		for (bool f : fed)
+			if (!f)
+				return false;
+		return sizeof...(Inputs) == sizeof...(Attributes);
+	}
+
+	// UFeeds() with the component counts matching as well
+	template<class... Inputs>
+	static constexpr bool UMatches()
+	{
+		bool matched[] = { true, (UCount(Inputs::location) == Inputs::components)... };
+		for (bool m : matched)
+			if (!m)
+				return false;
+		return UFeeds<Inputs...>();
+	}
+
+	static_assert(sizeof...(Attributes) > 0, "a vertex layout needs at least one attribute");
+	static_assert(UVertexAttributesValid<Vertex, Attributes...>(), "vertex attributes overlap, share a location or lie outside the vertex");
+};